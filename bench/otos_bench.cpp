@@ -0,0 +1,277 @@
+/*******************************************************************************
+    otos_bench.cpp - On-target benchmark of the OTOS driver hot paths.
+
+    Times the register conversions and the fusion filter in CPU cycles and the
+    bus reads in microseconds over many iterations, then the sample rate reachable at several
+    I2C baud rates, and prints min/median/p99 of each over USB serial. Build
+    with `make otos_bench` and flash otos_bench.uf2 with the sensor on the CONFIG
+    pins of utils.h.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <algorithm>
+
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "hardware/structs/systick.h"
+#include "QwiicOtos.h"
+#include "QwiicOtosFusion.h"
+
+// Iterations of every measurement
+#define BENCH_ITERATIONS 2000
+
+// Reads per baud rate in the sample rate sweep
+#define BENCH_RATE_READS 500
+
+// SysTick is a 24-bit down counter
+#define SYSTICK_MASK 0xFFFFFF
+
+static uint32_t samples[BENCH_ITERATIONS];
+
+// Keeps the conversion results alive so they are not optimized out
+static volatile float sink;
+
+// Exposes the protected conversions and the owned bus to the benchmark
+class BenchOtos : public QwiicOTOS
+{
+  public:
+    using QwiicOTOS::QwiicOTOS;
+    using sfeQwiicOtos::poseToRegs;
+    using sfeQwiicOtos::regsToPose;
+    using sfeQwiicOtos::conversion;
+
+    OtosBus &bus()
+    {
+        return _i2c;
+    }
+};
+
+static BenchOtos myOtos;
+
+static void startCycleCounter()
+{
+    // Count processor clock cycles with the full reload range
+    systick_hw->rvr = SYSTICK_MASK;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;
+}
+
+static inline uint32_t cycleCount()
+{
+    return systick_hw->cvr;
+}
+
+static inline uint32_t cyclesSince(uint32_t start)
+{
+    return (start - systick_hw->cvr) & SYSTICK_MASK;
+}
+
+static void report(const char *name, size_t count, const char *unit, uint32_t overhead)
+{
+    std::sort(samples, samples + count);
+
+    for(size_t i = 0; i < count; i++)
+        samples[i] = (samples[i] > overhead) ? samples[i] - overhead : 0;
+
+    printf("%-28s min %7lu  median %7lu  p99 %7lu %s\n", name, (unsigned long)samples[0],
+           (unsigned long)samples[count / 2], (unsigned long)samples[(count * 99) / 100], unit);
+}
+
+// Cost of reading the counter itself, subtracted from the cycle measurements
+static uint32_t measureCycleOverhead()
+{
+    uint32_t minimum = UINT32_MAX;
+    for(int i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        uint32_t start = cycleCount();
+        uint32_t cycles = cyclesSince(start);
+        minimum = std::min(minimum, cycles);
+    }
+    return minimum;
+}
+
+static void benchConversions(uint32_t overhead)
+{
+    uint8_t rawData[6] = {0x34, 0x12, 0x78, 0x56, 0xBC, 0x0A};
+    sfe_otos_pose2d_t pose = {1.0f, -2.0f, 45.0f};
+    const sfe_otos_conversion_t &conversion = myOtos.conversion(0);
+
+    for(int i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        uint32_t start = cycleCount();
+        myOtos.regsToPose(rawData, pose, conversion);
+        samples[i] = cyclesSince(start);
+        sink = pose.x;
+    }
+    report("regsToPose", BENCH_ITERATIONS, "cycles", overhead);
+
+    for(int i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        uint32_t start = cycleCount();
+        myOtos.poseToRegs(rawData, pose, conversion);
+        samples[i] = cyclesSince(start);
+        sink = rawData[0];
+    }
+    report("poseToRegs", BENCH_ITERATIONS, "cycles", overhead);
+
+    // 64 position frames out of pos/vel/acc blocks, as drained from a log
+    static uint8_t frames[64 * 18];
+    static float xs[64], ys[64], hs[64];
+    for(size_t i = 0; i < sizeof(frames); i++)
+        frames[i] = i * 37;
+
+    for(int i = 0; i < BENCH_ITERATIONS / 10; i++)
+    {
+        uint32_t start = cycleCount();
+        for(int n = 0; n < 64; n++)
+        {
+            myOtos.regsToPose(frames + n * 18, pose, conversion);
+            xs[n] = pose.x;
+            ys[n] = pose.y;
+            hs[n] = pose.h;
+        }
+        samples[i] = cyclesSince(start);
+        sink = xs[63];
+    }
+    report("regsToPose x64", BENCH_ITERATIONS / 10, "cycles", overhead);
+
+    for(int i = 0; i < BENCH_ITERATIONS / 10; i++)
+    {
+        uint32_t start = cycleCount();
+        myOtos.decodeFrames(frames, 64, xs, ys, hs, kSfeOtosGroupPos, 18);
+        samples[i] = cyclesSince(start);
+        sink = xs[63];
+    }
+    report("decodeFrames x64", BENCH_ITERATIONS / 10, "cycles", overhead);
+
+    static int32_t qxs[64], qys[64], qhs[64];
+    for(int i = 0; i < BENCH_ITERATIONS / 10; i++)
+    {
+        uint32_t start = cycleCount();
+        myOtos.decodeFramesQ(frames, 64, qxs, qys, qhs, kSfeOtosGroupPos, 18);
+        samples[i] = cyclesSince(start);
+        sink = qxs[63];
+    }
+    report("decodeFramesQ x64", BENCH_ITERATIONS / 10, "cycles", overhead);
+}
+
+static void benchFusion(uint32_t overhead)
+{
+    QwiicOTOSFusion fusion;
+    sfe_otos_pose2d_t delta = {0.01f, 0.0f, 0.05f};
+    sfe_otos_pose2d_t pos = {0.0f, 0.0f, 0.0f};
+    sfe_otos_pose2d_t posStdDev = {0.02f, 0.02f, 0.5f};
+    fusion.reset(pos, posStdDev);
+
+    for(int i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        uint32_t start = cycleCount();
+        fusion.predict(delta);
+        samples[i] = cyclesSince(start);
+    }
+    report("QwiicOTOSFusion::predict", BENCH_ITERATIONS, "cycles", overhead);
+
+    for(int i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        pos.x = i * 0.01f;
+        uint32_t start = cycleCount();
+        fusion.update(pos, posStdDev);
+        samples[i] = cyclesSince(start);
+    }
+    report("QwiicOTOSFusion::update", BENCH_ITERATIONS, "cycles", overhead);
+
+    fusion.getPose(pos);
+    sink = pos.x;
+}
+
+static void benchReads()
+{
+    sfe_otos_pose2d_t pos, vel, acc, posStdDev, velStdDev, accStdDev;
+    int errors = 0;
+
+    for(int i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        uint32_t start = time_us_32();
+        errors += (myOtos.getPosition(pos) != kSTkErrOk);
+        samples[i] = time_us_32() - start;
+    }
+    report("getPosition", BENCH_ITERATIONS, "us", 0);
+
+    for(int i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        uint32_t start = time_us_32();
+        errors += (myOtos.getPosVelAcc(pos, vel, acc) != kSTkErrOk);
+        samples[i] = time_us_32() - start;
+    }
+    report("getPosVelAcc", BENCH_ITERATIONS, "us", 0);
+
+    for(int i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        uint32_t start = time_us_32();
+        errors += (myOtos.getPosVelAccAndStdDev(pos, vel, acc, posStdDev, velStdDev, accStdDev) != kSTkErrOk);
+        samples[i] = time_us_32() - start;
+    }
+    report("getPosVelAccAndStdDev", BENCH_ITERATIONS, "us", 0);
+
+    if(errors)
+        printf("%d reads failed\n", errors);
+}
+
+static void benchSampleRates()
+{
+    static const uint baudRates[] = {100 * 1000, CONFIG::I2C_BAUD_RATE, 400 * 1000, 1000 * 1000};
+    sfe_otos_pose2d_t pos, vel, acc;
+
+    for(uint baudRate : baudRates)
+    {
+        uint actual = myOtos.bus().setBaudRate(baudRate);
+
+        int errors = 0;
+        uint32_t begin = time_us_32();
+        for(int i = 0; i < BENCH_RATE_READS; i++)
+        {
+            uint32_t start = time_us_32();
+            errors += (myOtos.getPosVelAcc(pos, vel, acc) != kSTkErrOk);
+            samples[i] = time_us_32() - start;
+        }
+        uint32_t elapsed = time_us_32() - begin;
+
+        char name[32];
+        snprintf(name, sizeof(name), "getPosVelAcc @ %u kHz", actual / 1000);
+        report(name, BENCH_RATE_READS, "us", 0);
+        printf("%-28s %lu samples/s, %d errors\n", "", (unsigned long)(BENCH_RATE_READS * 1000000ull / elapsed),
+               errors);
+    }
+
+    myOtos.bus().setBaudRate(CONFIG::I2C_BAUD_RATE);
+}
+
+int main()
+{
+    stdio_init_all();
+    while(!stdio_usb_connected())
+        sleep_ms(100);
+
+    myOtos.initI2C();
+    while(myOtos.isConnected() != kSTkErrOk)
+    {
+        printf("OTOS not connected, retrying\n");
+        sleep_ms(1000);
+    }
+
+    startCycleCounter();
+    uint32_t overhead = measureCycleOverhead();
+
+    while(true)
+    {
+        printf("\nOTOS benchmark, %d iterations, clk_sys cycles and microseconds\n", BENCH_ITERATIONS);
+        benchConversions(overhead);
+        benchFusion(overhead);
+        benchReads();
+        benchSampleRates();
+
+        printf("Press any key to run again\n");
+        while(getchar_timeout_us(1000 * 1000) == PICO_ERROR_TIMEOUT)
+            tight_loop_contents();
+    }
+}
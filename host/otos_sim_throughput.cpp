@@ -0,0 +1,597 @@
+/*******************************************************************************
+    otos_sim_throughput.cpp - Host-side load test of the OTOS driver against the
+    simulated sensor.
+
+    Measures the wall-clock throughput of the decode paths, the group reads,
+    the background read path, the sample ring buffer, the fusion filter and
+    the telemetry encoding, checks the decoded
+    position against the simulated trajectory, round-trips samples through
+    the flight recorder, including positions from continuous tracking past
+    the register range, steps the sampler through its idle rate and batched
+    wakeups on a simulated timer, counts injected faults, and
+    reports the sample rate the modeled bus could sustain.
+
+    Usage: otos_sim_throughput [iterations]
+*******************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "QwiicOtosFusion.h"
+#include "QwiicOtosRecorder.h"
+#include "QwiicOtosSampler.h"
+#include "QwiicOtosTelemetry.h"
+#include "sfeOtosRingBuffer.h"
+#include "sfeOtosSimTransport.h"
+#include "pico_shim.h"
+
+// Driver on the simulated sensor, delays only advance the simulated clock
+template <class Driver>
+class SimDriver : public Driver
+{
+  public:
+    SimDriver(sfeOtosSimTransport &sim) : _sim{sim}
+    {
+        this->setBus(sim);
+    }
+
+  protected:
+    void delayMs(uint32_t ms)
+    {
+        _sim.advanceUs(ms * 1000ull);
+    }
+
+    sfeOtosSimTransport &_sim;
+};
+
+typedef SimDriver<sfeQwiicOtos> SimOtos;
+typedef SimDriver<sfeQwiicOtosT<kSfeOtosLinearUnitMeters, kSfeOtosAngularUnitRadians, sfeOtosSimTransport>>
+    SimOtosFixed;
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void report(const char *name, size_t count, double seconds, int errors)
+{
+    printf("%-40s %8.2f Msamples/s  %6.1f ns/sample  %d errors\n", name, count / seconds * 1e-6,
+           seconds / count * 1e9, errors);
+}
+
+// Keeps the decoded values alive so the loops are not optimized out
+static volatile float sink;
+
+template <class Driver>
+static void benchPosVelAcc(const char *name, Driver &otos, size_t count)
+{
+    sfe_otos_pose2d_t pos{}, vel{}, acc{};
+    int errors = 0;
+
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < count; i++)
+    {
+        errors += (otos.getPosVelAcc(pos, vel, acc) != 0);
+        sink = pos.x;
+    }
+    report(name, count, secondsSince(start), errors);
+}
+
+template <class Driver>
+static void benchGroups(const char *name, Driver &otos, uint8_t groups, size_t count)
+{
+    sfe_otos_pose_groups_t out;
+    int errors = 0;
+
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < count; i++)
+    {
+        errors += (otos.read(groups, out) != 0);
+        sink = out.pos.x;
+    }
+    report(name, count, secondsSince(start), errors);
+}
+
+template <class Driver>
+static void benchAsync(const char *name, Driver &otos, size_t count)
+{
+    sfe_otos_pose2d_t pos{}, vel{}, acc{};
+    int errors = 0;
+
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < count; i++)
+    {
+        errors += (otos.startPosVelAccAsync() != 0);
+
+        int err;
+        while((err = otos.pollPosVelAccAsync(pos, vel, acc)) == kSTkErrBusBusy)
+            ;
+        errors += (err != 0);
+        sink = pos.x;
+    }
+    report(name, count, secondsSince(start), errors);
+}
+
+// Largest distance between the decoded position and the trajectory
+template <class Driver>
+static void checkAccuracy(Driver &otos, sfeOtosSimTransport &sim, size_t count)
+{
+    float maxError = 0;
+    float maxHeadingError = 0;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        sfe_otos_pose2d_t pos, truth;
+        if(otos.getPosition(pos) != 0)
+            continue;
+        sim.getTruePosition(truth);
+
+        maxError = std::fmax(maxError, std::hypot(pos.x - truth.x, pos.y - truth.y));
+        float headingError = std::fabs(pos.h - truth.h);
+        maxHeadingError = std::fmax(maxHeadingError, std::fmin(headingError, (float)(2 * M_PI) - headingError));
+    }
+
+    printf("%-40s %.6f m, %.6f rad max error\n", "decoded position vs trajectory", maxError, maxHeadingError);
+}
+
+static void benchRingBuffer(size_t count)
+{
+    static sfeOtosRingBuffer<sfe_otos_sample_t, 64> buffer;
+    sfe_otos_sample_t sample = {};
+
+    // Producer and consumer on separate threads, like the timer and the main
+    // loop on the Pico
+    Clock::time_point start = Clock::now();
+    std::thread producer([count]() {
+        sfe_otos_sample_t item = {};
+        for(size_t i = 0; i < count; i++)
+        {
+            item.timestampUs = i;
+            while(!buffer.push(item))
+                std::this_thread::yield();
+        }
+    });
+
+    int errors = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        while(!buffer.pop(sample))
+            std::this_thread::yield();
+        errors += (sample.timestampUs != i);
+    }
+    producer.join();
+
+    report("ring buffer push/pop (2 threads)", count, secondsSince(start), errors);
+}
+
+// Filter fed with the group read it is meant for, odometry from the true motion
+static void benchFusion(SimOtos &otos, sfeOtosSimTransport &sim, size_t count)
+{
+    QwiicOTOSFusion fusion(kSfeOtosAngularUnitRadians);
+    sfe_otos_pose_groups_t groups;
+    sfe_otos_pose2d_t truth, last, delta, pose;
+    int errors = 0;
+
+    sim.getTruePosition(truth);
+    fusion.reset(truth, {0, 0, 0});
+    last = truth;
+
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < count; i++)
+    {
+        errors += (otos.read(kSfeOtosGroupPos | kSfeOtosGroupPosStdDev, groups) != 0);
+        sim.getTruePosition(truth);
+
+        float c = std::cos(last.h);
+        float s = std::sin(last.h);
+        float dx = truth.x - last.x;
+        float dy = truth.y - last.y;
+        float dh = truth.h - last.h;
+        delta = {c * dx + s * dy, c * dy - s * dx, std::remainder(dh, (float)(2 * M_PI))};
+        last = truth;
+
+        fusion.predict(delta);
+        errors += !fusion.update(groups);
+    }
+    report("read + QwiicOTOSFusion predict/update", count, secondsSince(start), errors);
+
+    fusion.getPose(pose);
+    printf("%-40s %.6f m from the trajectory\n", "fused position", std::hypot(pose.x - truth.x, pose.y - truth.y));
+}
+
+// Encodes driver samples, decodes them again and counts any that differ.
+// The units name the driver units in the labels
+template <class Driver>
+static void benchTelemetry(const char *units, Driver &otos, sfeOtosSimTransport &sim, size_t count)
+{
+    QwiicOTOSTelemetryEncoder encoder(otos.getLinearUnit(), otos.getAngularUnit());
+    QwiicOTOSTelemetryDecoder decoder;
+    uint8_t frames[kOtosTelemetryMaxEncodeBytes];
+    size_t numBytes = 0;
+    size_t numDecoded = 0;
+    int errors = 0;
+
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < count; i++)
+    {
+        sfe_otos_sample_t sample = {}, decoded = {};
+        sample.timestampUs = sim.getTimeUs();
+        errors += (otos.getPosVelAcc(sample.pos, sample.vel, sample.acc) != 0);
+
+        size_t length = encoder.encode(sample, frames);
+        numBytes += length;
+        for(size_t j = 0; j < length; j++)
+        {
+            if(!decoder.push(frames[j], decoded))
+                continue;
+
+            numDecoded++;
+            errors += (decoded.timestampUs != sample.timestampUs) || !sfeOtosSameReading(decoded, sample);
+        }
+    }
+    errors += (numDecoded != count);
+
+    char label[64];
+    snprintf(label, sizeof(label), "getPosVelAcc + telemetry (%s)", units);
+    report(label, count, secondsSince(start), errors);
+    snprintf(label, sizeof(label), "telemetry stream (%s)", units);
+    printf("%-40s %.1f bytes/sample, %u CRC errors\n", label, (double)numBytes / count,
+           (unsigned)decoder.getNumCrcErrors());
+}
+
+// Recorder able to tear its newest sample, like a reset in the middle of an
+// append
+class TornRecorder : public QwiicOTOSRecorder
+{
+  public:
+    using QwiicOTOSRecorder::QwiicOTOSRecorder;
+
+    // Cuts the last delta short, as if its last byte was never written
+    bool tearLastSample()
+    {
+        recorder_block_t *b = block((_header->first + _header->count - 1) % _header->numBlocks);
+        if(b->numSamples < 2)
+            return false;
+        b->used--;
+        return true;
+    }
+};
+
+// Plays a recording back and counts the samples that differ from the recorded
+// ones, the last numSamples of which should be held
+static int checkPlayback(QwiicOTOSRecorder &recorder, const std::vector<sfe_otos_sample_t> &recorded,
+                         size_t numSamples)
+{
+    int errors = (recorder.getNumSamples() != numSamples) || (numSamples > recorded.size());
+    size_t index = recorded.size() - std::min(numSamples, recorded.size());
+
+    sfe_otos_sample_t decoded = {};
+    recorder.rewind();
+    while(recorder.next(decoded))
+    {
+        if(index == recorded.size())
+            return errors + 1;
+        const sfe_otos_sample_t &sample = recorded[index++];
+        errors += (decoded.timestampUs != sample.timestampUs) || (decoded.isRepeat != sample.isRepeat) ||
+                  !sfeOtosSameReading(decoded, sample);
+    }
+    return errors + (index != recorded.size());
+}
+
+// Records driver samples into an arena small enough to wrap around, plays them
+// back against what was recorded and the trajectory, then resumes the arena
+// after a torn append
+static void checkRecorder(SimOtos &otos, sfeOtosSimTransport &sim, size_t count)
+{
+    static uint64_t arena[(16 * OTOS_RECORDER_BLOCK_SIZE + 64) / 8];
+    TornRecorder recorder(arena, sizeof(arena));
+    int errors = (recorder.begin(otos.getLinearUnit(), otos.getAngularUnit()) != 0);
+
+    std::vector<sfe_otos_sample_t> recorded;
+    std::vector<sfe_otos_pose2d_t> truths;
+    recorded.reserve(count);
+    truths.reserve(count);
+
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < count; i++)
+    {
+        sfe_otos_sample_t sample = {};
+        sample.timestampUs = sim.getTimeUs();
+        sample.isRepeat = (i % 7 == 0);
+        errors += (otos.getPosVelAcc(sample.pos, sample.vel, sample.acc) != 0);
+
+        sfe_otos_pose2d_t truth;
+        sim.getTruePosition(truth);
+
+        recorder.record(sample);
+        recorded.push_back(sample);
+        truths.push_back(truth);
+    }
+
+    // The arena only holds the most recent samples once it wrapped
+    size_t numSamples = recorder.getNumSamples();
+    errors += (numSamples == 0) || (numSamples >= count);
+    errors += checkPlayback(recorder, recorded, numSamples);
+    report("QwiicOTOSRecorder record/playback", count, secondsSince(start), errors);
+
+    float maxError = 0;
+    sfe_otos_sample_t decoded = {};
+    size_t index = count - numSamples;
+    recorder.rewind();
+    while(recorder.next(decoded) && index < count)
+    {
+        const sfe_otos_pose2d_t &truth = truths[index++];
+        maxError = std::fmax(maxError, std::hypot(decoded.pos.x - truth.x, decoded.pos.y - truth.y));
+    }
+    printf("%-40s %.1f bytes/sample, %zu of %zu samples kept, %.6f m max error\n", "recorder arena",
+           (double)recorder.getUsedBytes() / numSamples, numSamples, count, maxError);
+
+    // Deltas wrapping around the int16 range, and a 64-bit timestamp jump
+    static const int16_t kExtremes[] = {32767, -32768, 0, -32768, 32767, 1, -1, 32767};
+    size_t numExtremes = sizeof(kExtremes) / sizeof(kExtremes[0]);
+    int wrapErrors = 0;
+    recorder.clear();
+    for(size_t i = 0; i < numExtremes; i++)
+    {
+        int16_t raw[9];
+        for(int r = 0; r < 9; r++)
+            raw[r] = kExtremes[(i + r) % numExtremes];
+        recorder.recordRaw(i * (1ull << 40), raw, i & 1);
+    }
+
+    uint64_t timestampUs;
+    int16_t raw[9];
+    bool isRepeat;
+    size_t numRead = 0;
+    recorder.rewind();
+    while(recorder.nextRaw(timestampUs, raw, isRepeat))
+    {
+        wrapErrors += (timestampUs != numRead * (1ull << 40)) || (isRepeat != (numRead & 1));
+        for(int r = 0; r < 9; r++)
+            wrapErrors += (raw[r] != kExtremes[(numRead + r) % numExtremes]);
+        numRead++;
+    }
+    wrapErrors += (numRead != numExtremes);
+    printf("%-40s %d errors\n", "recorder int16 delta wrap", wrapErrors);
+
+    // A reset in the middle of an append loses only the torn sample, and the
+    // recording carries on after it
+    recorder.clear();
+    for(const sfe_otos_sample_t &sample : recorded)
+        recorder.record(sample);
+    numSamples = recorder.getNumSamples();
+    int resumeErrors = !recorder.tearLastSample();
+
+    TornRecorder resumed(arena, sizeof(arena));
+    resumeErrors += (resumed.begin(otos.getLinearUnit(), otos.getAngularUnit(), true) != 0);
+    recorded.pop_back();
+    resumeErrors += checkPlayback(resumed, recorded, numSamples - 1);
+
+    sfe_otos_sample_t sample = recorded.back();
+    sample.timestampUs += 1000;
+    resumed.record(sample);
+    recorded.push_back(sample);
+    resumeErrors += checkPlayback(resumed, recorded, numSamples);
+
+    // Without resume the arena starts empty
+    resumeErrors += (resumed.begin(otos.getLinearUnit(), otos.getAngularUnit(), false) != 0);
+    resumeErrors += (resumed.getNumSamples() != 0);
+    printf("%-40s %d errors\n", "recorder resume after a torn append", resumeErrors);
+}
+
+// Runs the sampler timer for a while, keeping the simulated sensor in step, and
+// drains the samples whenever a consumer would be woken. Returns the number of
+// ticks, and the time idle mode last changed, if it did
+static int runSampler(QwiicOTOSSampler &sampler, sfeOtosSimTransport &sim, uint64_t durationUs, size_t &numSamples,
+                      uint64_t &changedUs)
+{
+    uint64_t end = time_us_64() + durationUs;
+    uint32_t releases = picoShimNumReleases();
+    bool idle = sampler.isIdle();
+    int ticks = 0;
+
+    while(time_us_64() < end)
+    {
+        sim.advanceUs(picoShimTimerDelayUs());
+        if(!picoShimRunTimer())
+            break;
+        ticks++;
+
+        if(sampler.isIdle() != idle)
+        {
+            idle = sampler.isIdle();
+            changedUs = time_us_64();
+        }
+
+        if(picoShimNumReleases() != releases)
+        {
+            releases = picoShimNumReleases();
+            sfe_otos_sample_t sample;
+            while(sampler.getSample(sample))
+                numSamples++;
+        }
+    }
+    return ticks;
+}
+
+// Sampler at 100 Hz in batches of 4, idling at 5 Hz once still. Checks that
+// consumers wake once per batch while moving, that the sampler idles after
+// the still samples, and that motion wakes it within one idle period
+static void checkSampler()
+{
+    static constexpr uint32_t kPeriodUs = 10000;
+    static constexpr uint32_t kIdlePeriodUs = 200000;
+    static constexpr size_t kBatchSize = 4;
+    static constexpr uint16_t kStillSamples = 5;
+    static constexpr uint64_t kPhaseUs = 2000000;
+
+    sfeOtosSimTransport sim;
+    sim.setLatency(0, 0);
+    sim.setAsyncPolls(0);
+    SimOtos otos(sim);
+    otos.setLinearUnit(kSfeOtosLinearUnitMeters);
+    otos.setAngularUnit(kSfeOtosAngularUnitRadians);
+
+    QwiicOTOSSampler sampler(otos);
+    int errors = (sampler.setIdleRate(kIdlePeriodUs, 0.01f, 0.02f, kStillSamples) != 0);
+    errors += (sampler.setBatchSize(kBatchSize) != 0);
+    errors += (sampler.start(kPeriodUs) != 0);
+
+    // Moving: every tick samples, consumers wake once per batch
+    size_t numSamples = 0;
+    uint64_t changedUs = 0;
+    uint32_t releases = picoShimNumReleases();
+    int ticks = runSampler(sampler, sim, kPhaseUs, numSamples, changedUs);
+    uint32_t wakeups = picoShimNumReleases() - releases;
+    errors += sampler.isIdle() || (changedUs != 0) || (ticks != (int)(kPhaseUs / kPeriodUs));
+    errors += (wakeups > ticks / kBatchSize + 1) || (numSamples + kBatchSize < (size_t)ticks);
+    printf("%-40s %d ticks, %u wakeups, %zu samples\n", "sampler moving (100 Hz, batches of 4)", ticks,
+           (unsigned)wakeups, numSamples);
+
+    // Still: drops to the idle rate after the still samples
+    sim.setCircle(1.0f, 0.0f);
+    uint64_t stillUs = time_us_64();
+    ticks = runSampler(sampler, sim, kPhaseUs, numSamples, changedUs);
+    uint64_t idleAfterUs = changedUs - stillUs;
+    errors += !sampler.isIdle() || (changedUs < stillUs) || (idleAfterUs > (kStillSamples + 2) * kPeriodUs);
+    // Idle ticks alternate between starting a read and collecting it
+    errors += (ticks > (int)(kStillSamples + 2 + 2 * kPhaseUs / kIdlePeriodUs));
+    printf("%-40s idle after %.0f ms, %d ticks in %.0f s\n", "sampler still (5 Hz idle rate)", idleAfterUs * 1e-3,
+           ticks, kPhaseUs * 1e-6);
+
+    // Moving again: back to the full rate within an idle period
+    sim.setCircle(1.0f, 1.0f);
+    uint64_t movingUs = time_us_64();
+    runSampler(sampler, sim, kPhaseUs, numSamples, changedUs);
+    uint64_t awakeAfterUs = changedUs - movingUs;
+    errors += sampler.isIdle() || (changedUs < movingUs) || (awakeAfterUs > kIdlePeriodUs + kPeriodUs);
+    errors += (sampler.getNumErrors() != 0);
+    sampler.stop();
+
+    printf("%-40s awake after %.0f ms, %d errors\n", "sampler motion resumed", awakeAfterUs * 1e-3, errors);
+}
+
+// Telemetry and recorder round trips of continuous positions, on a circle
+// reaching past the +/-10 m of the registers
+static void checkContinuous(size_t count)
+{
+    sfeOtosSimTransport sim;
+    sim.setCircle(15.0f, 0.3f);
+    SimOtos otos(sim);
+    otos.setLinearUnit(kSfeOtosLinearUnitMeters);
+    otos.setAngularUnit(kSfeOtosAngularUnitRadians);
+    otos.setContinuousTracking(true);
+
+    QwiicOTOSTelemetryEncoder encoder(otos.getLinearUnit(), otos.getAngularUnit());
+    QwiicOTOSTelemetryDecoder decoder;
+    static uint64_t arena[(64 * OTOS_RECORDER_BLOCK_SIZE + 64) / 8];
+    QwiicOTOSRecorder recorder(arena, sizeof(arena));
+    int errors = (recorder.begin(otos.getLinearUnit(), otos.getAngularUnit()) != 0);
+
+    std::vector<sfe_otos_sample_t> recorded;
+    float maxDistance = 0;
+    uint8_t frames[kOtosTelemetryMaxEncodeBytes];
+    for(size_t i = 0; i < count; i++)
+    {
+        sfe_otos_sample_t sample = {}, decoded = {};
+        sample.timestampUs = sim.getTimeUs();
+        errors += (otos.getPosVelAcc(sample.pos, sample.vel, sample.acc) != 0);
+        maxDistance = std::fmax(maxDistance, std::fmax(std::fabs(sample.pos.x), std::fabs(sample.pos.y)));
+
+        size_t length = encoder.encode(sample, frames);
+        size_t numDecoded = 0;
+        for(size_t j = 0; j < length; j++)
+        {
+            if(decoder.push(frames[j], decoded))
+            {
+                numDecoded++;
+                errors += !sfeOtosSameReading(decoded, sample);
+            }
+        }
+        errors += (numDecoded != 1);
+
+        recorder.record(sample);
+        recorded.push_back(sample);
+    }
+    errors += checkPlayback(recorder, recorded, std::min(recorder.getNumSamples(), recorded.size()));
+
+    printf("%-40s %d errors, up to %.1f m\n", "telemetry and recorder, continuous", errors, maxDistance);
+}
+
+static void faultInjection(size_t count)
+{
+    sfeOtosSimTransport sim;
+    sim.setErrorRate(10000, 1000);
+    SimOtos otos(sim);
+
+    sfe_otos_pose2d_t pos{}, vel{}, acc{};
+    int failed = 0;
+    for(size_t i = 0; i < count; i++)
+        failed += (otos.getPosVelAcc(pos, vel, acc) != 0);
+
+    printf("%-40s %u injected, %d reads failed out of %zu\n", "fault injection (1% NAK, 0.1% short)",
+           (unsigned)sim.getNumInjectedErrors(), failed, count);
+}
+
+// Sample rate the modeled bus sustains, in simulated time
+static void modeledRate(const char *name, uint32_t transferUs, uint32_t byteUs, size_t count)
+{
+    sfeOtosSimTransport sim;
+    sim.setLatency(transferUs, byteUs);
+    SimOtos otos(sim);
+
+    sfe_otos_pose2d_t pos{}, vel{}, acc{};
+    uint64_t start = sim.getTimeUs();
+    for(size_t i = 0; i < count; i++)
+        otos.getPosVelAcc(pos, vel, acc);
+
+    double seconds = (sim.getTimeUs() - start) * 1e-6;
+    printf("%-40s %8.0f samples/s of simulated bus time\n", name, count / seconds);
+}
+
+int main(int argc, char **argv)
+{
+    size_t count = (argc > 1) ? strtoul(argv[1], nullptr, 0) : 2000000;
+
+    sfeOtosSimTransport sim;
+    sim.setLatency(0, 0);
+    sim.setUpdatePeriodUs(0);
+    sim.setAsyncPolls(0);
+
+    SimOtos otos(sim);
+    otos.setLinearUnit(kSfeOtosLinearUnitMeters);
+    otos.setAngularUnit(kSfeOtosAngularUnitRadians);
+    SimOtosFixed otosFixed(sim);
+
+    printf("OTOS simulated sensor, %zu iterations\n", count);
+    benchPosVelAcc("getPosVelAcc (run-time units)", otos, count);
+    benchPosVelAcc("getPosVelAcc (fixed units, direct bus)", otosFixed, count);
+    benchGroups("read(pos | vel)", otos, kSfeOtosGroupPos | kSfeOtosGroupVel, count);
+    benchGroups("read(pos | accStdDev)", otos, kSfeOtosGroupPos | kSfeOtosGroupAccStdDev, count);
+    benchAsync("start/pollPosVelAccAsync", otos, count);
+    benchRingBuffer(count);
+
+    sim.setLatency(75, 23);
+    checkAccuracy(otos, sim, count / 10);
+    checkRecorder(otos, sim, count / 10);
+    benchFusion(otos, sim, count / 10);
+    benchTelemetry("m, rad", otos, sim, count / 10);
+    otos.setLinearUnit(kSfeOtosLinearUnitInches);
+    otos.setAngularUnit(kSfeOtosAngularUnitDegrees);
+    benchTelemetry("in, deg", otos, sim, count / 10);
+    checkSampler();
+    checkContinuous(count / 10);
+    faultInjection(count / 10);
+
+    modeledRate("getPosVelAcc @ 400 kHz model", 75, 23, 10000);
+    modeledRate("getPosVelAcc @ 1 MHz model", 30, 9, 10000);
+
+    return 0;
+}
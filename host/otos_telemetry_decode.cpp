@@ -0,0 +1,53 @@
+/*******************************************************************************
+    otos_telemetry_decode.cpp - Converts a binary OTOS telemetry capture, as
+    streamed by QwiicOTOSTelemetrySink, to CSV.
+
+    Every float is printed with 9 significant digits, enough to round trip, so
+    the values match the ones the driver decoded on the Pico bit for bit.
+
+    Usage: otos_telemetry_decode [capture.bin] > samples.csv
+    Reads stdin without a file, eg. straight from the serial port.
+*******************************************************************************/
+
+#include <cstdio>
+
+#include "QwiicOtosTelemetry.h"
+
+int main(int argc, char **argv)
+{
+    FILE *in = (argc > 1) ? fopen(argv[1], "rb") : stdin;
+    if(!in)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    QwiicOTOSTelemetryDecoder decoder;
+    sfe_otos_sample_t sample;
+    unsigned long numSamples = 0;
+
+    printf("timestamp_us,repeat,pos_x,pos_y,pos_h,vel_x,vel_y,vel_h,acc_x,acc_y,acc_h\n");
+
+    int c;
+    while((c = fgetc(in)) != EOF)
+    {
+        if(!decoder.push(c, sample))
+            continue;
+
+        printf("%llu,%d,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n", (unsigned long long)sample.timestampUs,
+               sample.isRepeat, sample.pos.x, sample.pos.y, sample.pos.h, sample.vel.x, sample.vel.y, sample.vel.h,
+               sample.acc.x, sample.acc.y, sample.acc.h);
+        numSamples++;
+    }
+
+    const char *linear = (decoder.getLinearUnit() == kSfeOtosLinearUnitMeters) ? "meters" : "inches";
+    const char *angular = (decoder.getAngularUnit() == kSfeOtosAngularUnitRadians) ? "radians" : "degrees";
+    fprintf(stderr, "%lu samples in %s and %s, %u CRC errors, %u samples before a time frame, %u frames of an "
+            "unsupported version\n",
+            numSamples, linear, angular, (unsigned)decoder.getNumCrcErrors(), (unsigned)decoder.getNumUnsynced(),
+            (unsigned)decoder.getNumUnsupported());
+
+    if(in != stdin)
+        fclose(in);
+    return 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// Host stand-in for the Pico SDK semaphores. Nothing runs concurrently, so an
+// acquire never waits
+
+#include <stdint.h>
+
+typedef struct
+{
+    int16_t permits;
+    int16_t max_permits;
+} semaphore_t;
+
+void sem_init(semaphore_t *sem, int16_t initial_permits, int16_t max_permits);
+bool sem_release(semaphore_t *sem);
+void sem_reset(semaphore_t *sem, int16_t permits);
+bool sem_acquire_timeout_us(semaphore_t *sem, uint32_t timeout_us);
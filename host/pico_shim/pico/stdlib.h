@@ -0,0 +1,9 @@
+#pragma once
+
+// Host stand-in for the parts of pico/stdlib.h the portable classes use
+
+#include "pico/time.h"
+
+inline void tight_loop_contents()
+{
+}
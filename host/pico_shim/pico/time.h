@@ -0,0 +1,23 @@
+#pragma once
+
+// Host stand-in for the Pico SDK timer API, on the simulated clock of
+// pico_shim.h. Only one repeating timer can run at a time
+
+#include <stdint.h>
+
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *rt);
+
+struct repeating_timer
+{
+    int64_t delay_us;
+    repeating_timer_callback_t callback;
+    void *user_data;
+};
+
+uint64_t time_us_64();
+uint32_t time_us_32();
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data,
+                            repeating_timer_t *out);
+bool cancel_repeating_timer(repeating_timer_t *timer);
@@ -0,0 +1,106 @@
+/*******************************************************************************
+    pico_shim.cpp - Simulated clock, repeating timer and semaphores standing in
+    for the Pico SDK on the host.
+*******************************************************************************/
+
+#include "pico_shim.h"
+#include "pico/sem.h"
+#include "pico/time.h"
+
+static uint64_t shimTimeUs = 0;
+static repeating_timer_t *shimTimer = nullptr;
+static uint32_t shimNumReleases = 0;
+
+uint64_t time_us_64()
+{
+    return shimTimeUs;
+}
+
+uint32_t time_us_32()
+{
+    return (uint32_t)shimTimeUs;
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data,
+                            repeating_timer_t *out)
+{
+    if(shimTimer || delay_us == 0)
+        return false;
+
+    out->delay_us = delay_us;
+    out->callback = callback;
+    out->user_data = user_data;
+    shimTimer = out;
+    return true;
+}
+
+bool cancel_repeating_timer(repeating_timer_t *timer)
+{
+    if(timer != shimTimer)
+        return false;
+
+    shimTimer = nullptr;
+    return true;
+}
+
+void picoShimAdvanceUs(uint64_t us)
+{
+    shimTimeUs += us;
+}
+
+uint64_t picoShimTimerDelayUs()
+{
+    if(!shimTimer)
+        return 0;
+
+    // Callbacks take no simulated time, so both signs mean the same period
+    return (shimTimer->delay_us < 0) ? -shimTimer->delay_us : shimTimer->delay_us;
+}
+
+bool picoShimRunTimer()
+{
+    if(!shimTimer)
+        return false;
+
+    shimTimeUs += picoShimTimerDelayUs();
+    repeating_timer_t *timer = shimTimer;
+    if(!timer->callback(timer) && shimTimer == timer)
+        shimTimer = nullptr;
+    return true;
+}
+
+uint32_t picoShimNumReleases()
+{
+    return shimNumReleases;
+}
+
+void sem_init(semaphore_t *sem, int16_t initial_permits, int16_t max_permits)
+{
+    sem->permits = initial_permits;
+    sem->max_permits = max_permits;
+}
+
+bool sem_release(semaphore_t *sem)
+{
+    shimNumReleases++;
+    if(sem->permits >= sem->max_permits)
+        return false;
+
+    sem->permits++;
+    return true;
+}
+
+void sem_reset(semaphore_t *sem, int16_t permits)
+{
+    sem->permits = permits;
+}
+
+bool sem_acquire_timeout_us(semaphore_t *sem, uint32_t timeout_us)
+{
+    (void)timeout_us;
+    if(sem->permits == 0)
+        return false;
+
+    sem->permits--;
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+// Simulated clock behind the Pico SDK stand-ins of this directory, so classes
+// driven by a repeating timer, like QwiicOTOSSampler, can be stepped on the
+// host. Time only moves when advanced, and timer callbacks run when asked
+
+#include <stdint.h>
+
+/// @brief Advances the simulated clock
+/// @param us Microseconds to advance by
+void picoShimAdvanceUs(uint64_t us);
+
+/// @brief Gets the time to the next firing of the repeating timer
+/// @return Delay in microseconds, 0 if no timer is running
+uint64_t picoShimTimerDelayUs();
+
+/// @brief Advances the clock to the next firing of the repeating timer and
+/// runs its callback, which cancels the timer by returning false
+/// @return False if no timer is running
+bool picoShimRunTimer();
+
+/// @brief Gets the number of semaphore releases, ie. consumer wakeups
+uint32_t picoShimNumReleases();
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Bus instrumentation is compiled in with the OTOS_BUS_STATS CMake option.
+// Without it OtosBusStats is empty and every call folds away
+#ifndef OTOS_BUS_STATS
+#define OTOS_BUS_STATS 0
+#endif
+
+#if OTOS_BUS_STATS
+#include "pico/time.h"
+#endif
+
+/// @brief Register groups the bus statistics are kept for, by the first
+/// register of each transfer
+typedef enum
+{
+    kOtosStatsGroupConfig = 0,
+    kOtosStatsGroupPos,
+    kOtosStatsGroupVel,
+    kOtosStatsGroupAcc,
+    kOtosStatsGroupPosStdDev,
+    kOtosStatsGroupVelStdDev,
+    kOtosStatsGroupAccStdDev,
+    kOtosStatsNumGroups
+} otos_bus_stats_group_id_t;
+
+/// @brief Number of latency histogram buckets. Every power of two of
+/// microseconds is split into four linear sub-buckets, like an HDR histogram,
+/// so a bucket never spans more than 25% of its values. Latencies above about
+/// two seconds share the last bucket
+static constexpr int kOtosStatsNumBuckets = 80;
+
+/// @brief Statistics of the transfers starting in one register group
+typedef struct
+{
+    /// @brief Completed transfers, including failed ones
+    uint32_t transactions;
+
+    /// @brief Bytes transferred, not counting the register address
+    uint32_t bytes;
+
+    /// @brief Transfers that failed, mostly NAKs
+    uint32_t errors;
+
+    /// @brief Transfers that returned fewer bytes than requested
+    uint32_t underReads;
+
+    /// @brief Transfers refused because a DMA read owned the bus
+    uint32_t busy;
+
+    /// @brief Shortest, longest, and total latency in microseconds
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint64_t totalUs;
+
+    /// @brief Latency histogram, see kOtosStatsNumBuckets
+    uint32_t histogram[kOtosStatsNumBuckets];
+} otos_bus_stats_group_t;
+
+/// @brief Per-transport transaction statistics. Each transport times its
+/// transfers with now() and passes the result through record(), which returns
+/// it unchanged. Recording is not synchronized, so the statistics of a bus
+/// used from an interrupt can be slightly off while it is being dumped
+class OtosBusStats
+{
+  public:
+#if OTOS_BUS_STATS
+    OtosBusStats();
+
+    /// @brief Timestamp to pass to record()
+    static uint32_t now()
+    {
+        return time_us_32();
+    }
+
+    /// @brief Records a finished transfer
+    /// @param reg First register of the transfer
+    /// @param bytes Bytes transferred
+    /// @param result Result of the transfer
+    /// @param startUs now() when the transfer started
+    /// @return result
+    int record(uint8_t reg, size_t bytes, int result, uint32_t startUs);
+
+    /// @brief Clears every statistic
+    void reset();
+
+    /// @brief Prints the statistics of every group used so far to stdout
+    void dump() const;
+
+    /// @brief Gets the statistics of one register group
+    /// @param group otos_bus_stats_group_id_t value
+    const otos_bus_stats_group_t &getGroup(int group) const
+    {
+        return _groups[group];
+    }
+
+    /// @brief Estimates a latency percentile of one register group
+    /// @param group otos_bus_stats_group_id_t value
+    /// @param perMille Percentile in tenths of a percent, eg. 990 for p99
+    /// @return Upper bound of the histogram bucket holding the percentile, in
+    /// microseconds, or 0 without transfers
+    uint32_t getPercentileUs(int group, uint32_t perMille) const;
+
+  private:
+    static int groupOf(uint8_t reg);
+    static int bucketOf(uint32_t us);
+    static uint32_t bucketUpperUs(int bucket);
+
+    otos_bus_stats_group_t _groups[kOtosStatsNumGroups];
+#else
+    static uint32_t now()
+    {
+        return 0;
+    }
+
+    int record(uint8_t, size_t, int result, uint32_t)
+    {
+        return result;
+    }
+
+    void reset()
+    {
+    }
+
+    void dump() const
+    {
+    }
+#endif
+};
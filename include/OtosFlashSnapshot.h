@@ -0,0 +1,47 @@
+#pragma once
+
+#include "sfeQwiicOtos.h"
+
+// Flash offset of the snapshot sector of slot 0, from the start of flash.
+// Defaults to the last sector of flash, slot n uses the n-th sector below it.
+// The sectors must not overlap the program image
+#ifndef OTOS_SNAPSHOT_FLASH_OFFSET
+#define OTOS_SNAPSHOT_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#endif
+
+/// @brief Captures the tuned state of an OTOS with getSnapshot() and stores it
+/// in flash. Erasing a sector pauses both cores for tens of milliseconds and
+/// wears the flash, so save after tuning or before shutdown, not periodically.
+/// If core1 runs code from flash, it must have called
+/// flash_safe_execute_core_init() (QwiicOTOSDualCore does), otherwise the
+/// save fails when it cannot pause core1
+/// @param otos Driver of the sensor
+/// @param slot Snapshot slot, eg. one per sensor
+/// @return 0 for succuss, negative for errors, positive for warnings
+int otosSnapshotSave(sfeQwiicOtosBase &otos, uint8_t slot = 0);
+
+/// @brief Restores the state stored by otosSnapshotSave() in a few transfers,
+/// for a warm start without re-tuning the sensor
+/// @param otos Driver of the sensor
+/// @param slot Snapshot slot
+/// @return 0 for succuss, negative for errors, positive for warnings. Fails
+/// if the slot holds no valid snapshot, in which case nothing is written
+int otosSnapshotRestore(sfeQwiicOtosBase &otos, uint8_t slot = 0);
+
+/// @brief Stores a snapshot in flash, with a CRC. Skips the erase when the
+/// slot already holds the same snapshot
+/// @param snapshot Snapshot to store
+/// @param slot Snapshot slot
+/// @return 0 for succuss, negative for errors, positive for warnings
+int otosSnapshotWrite(const sfe_otos_snapshot_t &snapshot, uint8_t slot = 0);
+
+/// @brief Reads a snapshot from flash and checks its CRC
+/// @param snapshot Stored snapshot
+/// @param slot Snapshot slot
+/// @return 0 for succuss, negative if the slot holds no valid snapshot
+int otosSnapshotRead(sfe_otos_snapshot_t &snapshot, uint8_t slot = 0);
+
+/// @brief Erases a snapshot slot, forcing a cold start on the next restore
+/// @param slot Snapshot slot
+/// @return 0 for succuss, negative for errors, positive for warnings
+int otosSnapshotErase(uint8_t slot = 0);
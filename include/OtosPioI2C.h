@@ -0,0 +1,126 @@
+#pragma once
+
+#include "utils.h"
+#include "hardware/pio.h"
+
+/// @brief Maximum number of 16 bit PIO records of one DMA register read: the
+/// START, address, register, repeated START, address and STOP records around
+/// the data bytes
+static constexpr size_t kMaxPioI2CCommands = kMaxDmaReadLength + 15;
+
+/// @brief I2C connection to one device driven by a PIO state machine instead
+/// of the hardware I2C block, with the same interface as OtosI2C. The state
+/// machine supports clock stretching and baud rates up to Fast-mode Plus
+/// (1 MHz), and leaves both hardware I2C blocks free for other devices. SCL
+/// must be the pin after SDA. Instances on the same PIO block and pins share a
+/// state machine, so several devices with different addresses can sit on one
+/// bus; the program is loaded once per PIO block
+class OtosPioI2C final : public sfeOtosTransport {
+  public:
+    OtosPioI2C(PIO pio = pio0, uint sdaPin = CONFIG::I2C_SDA_PIN,
+               uint sclPin = CONFIG::I2C_SCL_PIN, uint baudRate = CONFIG::I2C_BAUD_RATE,
+               uint8_t address = kDefaultAddress);
+
+    // Loads the program and claims a state machine, optionally clocking out a
+    // stuck device first. Every transfer returns kSTkErrBusNotInit if SCL is
+    // not SDA + 1 or no state machine is free
+    void init(bool force_recovery);
+
+    // Changes the clock divider of the state machine, returning the baud rate
+    // requested. Must not be called while a transfer is in progress, and
+    // applies to every instance sharing the state machine
+    uint setBaudRate(uint baudRate);
+
+    int ping() override;
+    int readRegisterByte(uint8_t devReg, uint8_t &dataToRead) override;
+    int readRegisterRegionAnyAddress(uint8_t *devReg, size_t regLength, uint8_t *data, size_t numBytes, size_t &readBytes);
+    int readRegisterRegion(uint8_t devReg, uint8_t *data, size_t numBytes, size_t &readBytes) override;
+    int writeRegisterByte(uint8_t devReg, uint8_t dataToWrite) override;
+    int writeRegisterRegionAddress(uint8_t *devReg, size_t regLength, const uint8_t *data, size_t length);
+    int writeRegisterRegion(uint8_t devReg, const uint8_t *data, size_t length) override;
+
+    // Non-blocking register reads. The whole transaction, including the START,
+    // repeated START and STOP conditions, is streamed into the state machine by
+    // one DMA channel while a second one drains the received bytes.
+    // pollReadRegisterRegionDma() returns kSTkErrBusBusy until the STOP has
+    // been sent. Every other transfer on the same state machine returns
+    // kSTkErrBusBusy in the meantime
+    int startReadRegisterRegionDma(uint8_t devReg, uint8_t *data, size_t numBytes) override;
+    int pollReadRegisterRegionDma(size_t &readBytes) override;
+
+    PIO getPio() const { return _pio; }
+    uint8_t getAddress() const { return _address; }
+
+    // Transfer statistics, only collected when built with OTOS_BUS_STATS
+    OtosBusStats &getStats() { return _stats; }
+
+    // Worst-case time of every transfer, including the DMA reads, and whether
+    // a stalled one clocks out the device holding the bus, see
+    // otos_i2c_retry_policy_t. PIO transfers are not retried, so maxAttempts
+    // is ignored. Defaults to 5 ms
+    void setRetryPolicy(const otos_i2c_retry_policy_t &policy) { _policy = policy; }
+    const otos_i2c_retry_policy_t &getRetryPolicy() const { return _policy; }
+
+  private:
+    // Whether a DMA read owns the state machine
+    bool smBusy() const;
+    void setSmBusy(bool busy);
+
+    // Blocking helpers feeding the TX FIFO from the CPU
+    bool checkError() const;
+    void resumeAfterError();
+    void put(uint16_t record);
+    void putCondition(const uint8_t *sequence, size_t length);
+    bool waitStall();
+    int waitIdle();
+
+    // Starts the budget of a blocking transfer, which put() and waitStall()
+    // give up on
+    void beginTransfer();
+
+    // Restarts a state machine stalled past its deadline, eg. on a device
+    // stretching SCL forever, clocking the device out first if the policy
+    // allows. Returns kSTkErrBusStuck if a line is still held low, otherwise
+    // kSTkErrBusTimeout
+    int recoverStall();
+
+    // Whether a device holds SDA or SCL low
+    bool linesStuck() const;
+
+    // Builds the record stream of a register read into _dmaCommands and starts
+    // the DMA channels. startReadDma() times the read into _stats
+    int startReadDma(const uint8_t *devReg, size_t regLength, uint8_t *data, size_t numBytes);
+    int beginReadDma(const uint8_t *devReg, size_t regLength, uint8_t *data, size_t numBytes);
+
+    // Write behind writeRegisterRegionAddress(), which times it into _stats
+    int writeRegion(uint8_t *devReg, size_t regLength, const uint8_t *data, size_t length);
+
+    PIO _pio;
+    uint _sdaPin;
+    uint _sclPin;
+    uint _baudRate;
+    uint8_t _address;
+    int _sm;
+
+    // DMA state for the register reads. The state machine pushes one RX byte
+    // for every data record, so the address and register bytes echoed back
+    // ahead of the data land in _dmaRxData and are skipped when copying out
+    int _dmaTxChannel;
+    int _dmaRxChannel;
+    uint16_t _dmaCommands[kMaxPioI2CCommands];
+    uint8_t _dmaRxData[kMaxDmaReadLength + 3];
+    uint8_t *_dmaData;
+    size_t _dmaLength;
+    size_t _dmaSkip;
+    bool _dmaDraining;
+    volatile bool _dmaActive;
+
+    OtosBusStats _stats;
+    uint32_t _dmaStartUs;
+    uint8_t _dmaReg;
+
+    otos_i2c_retry_policy_t _policy;
+    uint32_t _deadlineUs;
+    bool _timedOut;
+    uint32_t _dmaDeadlineUs;
+};
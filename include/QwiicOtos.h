@@ -2,12 +2,106 @@
 
 #include "sfeQwiicOtos.h"
 #include "utils.h"
+#if OTOS_USE_PIO_I2C
+#include "OtosPioI2C.h"
+#endif
+
+// Transport owned by each QwiicOTOSPico, chosen at build time: the hardware I2C
+// block by default, or a PIO state machine with OTOS_USE_PIO_I2C
+#if OTOS_USE_PIO_I2C
+typedef OtosPioI2C OtosBus;
+#else
+typedef OtosI2C OtosBus;
+#endif
 #include "pico/stdlib.h"
+#if OTOS_FREERTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
 
-class QwiicOTOS : public sfeQwiicOtos
+/// @brief Binds an OTOS driver to the Pico SDK: owns the I2C bus of the sensor
+/// and implements the delay function
+/// @tparam Driver sfeQwiicOtos or one of the sfeQwiicOtosT variants
+template <class Driver>
+class QwiicOTOSPico : public Driver
 {
+  public:
+#if OTOS_USE_PIO_I2C
+    /// @brief Constructor, defaults to the CONFIG pins in utils.h
+    /// @param pio PIO block running the I2C state machine
+    /// @param sdaPin SDA pin
+    /// @param sclPin SCL pin, must be sdaPin + 1
+    /// @param baudRate I2C baud rate, up to 1 MHz
+    /// @param address I2C address of the sensor
+    QwiicOTOSPico(PIO pio = pio0, uint sdaPin = CONFIG::I2C_SDA_PIN,
+                  uint sclPin = CONFIG::I2C_SCL_PIN, uint baudRate = CONFIG::I2C_BAUD_RATE,
+                  uint8_t address = kDefaultAddress)
+        : _i2c(pio, sdaPin, sclPin, baudRate, address)
+    {
+        this->setBus(_i2c);
+    }
+#else
+    /// @brief Constructor, defaults to the CONFIG bus in utils.h
+    /// @param port I2C hardware block the sensor is connected to
+    /// @param sdaPin SDA pin
+    /// @param sclPin SCL pin
+    /// @param baudRate I2C baud rate
+    /// @param address I2C address of the sensor
+    QwiicOTOSPico(i2c_inst_t *port = CONFIG::i2c_port, uint sdaPin = CONFIG::I2C_SDA_PIN,
+                  uint sclPin = CONFIG::I2C_SCL_PIN, uint baudRate = CONFIG::I2C_BAUD_RATE,
+                  uint8_t address = kDefaultAddress)
+        : _i2c(port, sdaPin, sclPin, baudRate, address)
+    {
+        this->setBus(_i2c);
+    }
+#endif
+
+    // The driver points at the bus it owns, so copies would share it
+    QwiicOTOSPico(const QwiicOTOSPico &) = delete;
+    QwiicOTOSPico &operator=(const QwiicOTOSPico &) = delete;
+
+    /// @brief Sets up the pins and the hardware block or state machine of this
+    /// sensor's bus
+    /// @param forceRecovery Whether to clock out a stuck device first
+    void initI2C(bool forceRecovery = false) {
+        _i2c.init(forceRecovery);
+    }
+
+    /// @brief Gets the bus of this sensor, eg. to tune it or read its fault
+    /// counters
+    OtosBus &getI2C() {
+        return _i2c;
+    }
+
   protected:
     void delayMs(uint32_t ms) {
-        sleep_ms(ms); 
+#if OTOS_FREERTOS
+        // Let the other tasks run meanwhile. vTaskDelay() counts the current
+        // partial tick, so one more guarantees at least ms
+        if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+            vTaskDelay((TickType_t)(((uint64_t)ms * configTICK_RATE_HZ + 999) / 1000) + 1);
+            return;
+        }
+#endif
+        sleep_ms(ms);
     }
-};
\ No newline at end of file
+
+    OtosBus _i2c;
+};
+
+class QwiicOTOS : public QwiicOTOSPico<sfeQwiicOtos>
+{
+  public:
+    using QwiicOTOSPico<sfeQwiicOtos>::QwiicOTOSPico;
+};
+
+/// @brief QwiicOTOS with the linear and angular units fixed at compile time,
+/// eg. QwiicOTOST<kSfeOtosLinearUnitMeters, kSfeOtosAngularUnitRadians>. The
+/// pose reads are also bound to OtosBus, so they call the transport directly
+/// instead of through sfeOtosTransport
+template <sfe_otos_linear_unit_t LinearUnit, sfe_otos_angular_unit_t AngularUnit>
+class QwiicOTOST : public QwiicOTOSPico<sfeQwiicOtosT<LinearUnit, AngularUnit, OtosBus>>
+{
+  public:
+    using QwiicOTOSPico<sfeQwiicOtosT<LinearUnit, AngularUnit, OtosBus>>::QwiicOTOSPico;
+};
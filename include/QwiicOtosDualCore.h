@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include "sfeQwiicOtos.h"
+
+/// @brief Runs OTOS acquisition on core1. The acquisition loop owns the driver
+/// and reads the position, velocity, and acceleration at a fixed rate with the
+/// blocking burst read, then publishes the latest sample through a seqlock.
+/// Core0 reads the latest sample without ever touching the bus.
+/// @note The driver must not be used from core0 while running. Core1 and the
+/// inter-core FIFO are reserved for the acquisition loop until stop() is called
+class QwiicOTOSDualCore
+{
+  public:
+    /// @brief Constructor
+    /// @param otos Driver handed over to core1
+    QwiicOTOSDualCore(sfeQwiicOtos &otos);
+
+    /// @brief Launches the acquisition loop on core1
+    /// @param periodUs Time between samples in microseconds
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int start(uint32_t periodUs);
+
+    /// @brief Stops the acquisition loop and resets core1. The driver can be
+    /// used from core0 again afterwards
+    void stop();
+
+    /// @brief Checks whether the acquisition loop is running
+    /// @return True if running
+    bool isRunning();
+
+    /// @brief Gets the most recent sample published by core1. Never blocks on
+    /// the bus; only retries the copy in the rare case core1 is publishing at
+    /// the same moment
+    /// @param sample Most recent sample
+    /// @return True if a sample has been published since start()
+    bool getLatest(sfe_otos_sample_t &sample);
+
+    /// @brief Gets the number of samples published since start(), which can be
+    /// used to check whether a new sample is available
+    /// @return Number of published samples
+    uint32_t getNumSamples();
+
+    /// @brief Gets the number of reads that failed on core1
+    /// @return Number of failed reads
+    uint32_t getNumErrors();
+
+  protected:
+    // Core1 entry point, receives the instance through the inter-core FIFO
+    static void core1Entry();
+
+    // Acquisition loop running on core1
+    void acquisitionLoop();
+
+    // Publishes a sample for core0
+    void publish(const sfe_otos_sample_t &sample);
+
+    sfeQwiicOtos &_otos;
+    uint32_t _periodUs;
+    bool _running;
+    std::atomic<bool> _stopRequested;
+
+    // Seqlock protecting _latest. Odd while core1 is writing, and bumped by
+    // two for every published sample
+    std::atomic<uint32_t> _sequence;
+    sfe_otos_sample_t _latest;
+
+    std::atomic<uint32_t> _numErrors;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "sfeQwiicOtos.h"
+
+/// @brief Fuses the OTOS pose with wheel odometry in a 3-state extended
+/// Kalman filter over x, y and heading. Odometry deltas propagate the estimate
+/// and its covariance, and every OTOS pose corrects it, weighted by the
+/// standard deviations the OTOS reports for it. Everything is fixed size, with
+/// no heap, and the covariance is kept as the 6 unique terms so an update costs
+/// a bounded number of float operations, see bench/otos_bench.cpp.
+/// @note The OTOS and the odometry must share the field frame, so set the
+/// OTOS position and reset() the filter to the same pose. Linear values are in
+/// whatever unit the driver and the odometry use, angles in the angular unit
+/// given to the constructor
+class QwiicOTOSFusion
+{
+  public:
+    /// @brief Constructor, starts at the origin with zero uncertainty
+    /// @param angularUnit Angular unit of the poses, the angular unit of the
+    /// driver they come from
+    QwiicOTOSFusion(sfe_otos_angular_unit_t angularUnit = kSfeOtosAngularUnitDegrees);
+
+    /// @brief Restarts the filter
+    /// @param pose Initial pose
+    /// @param stdDev Standard deviation of the initial pose
+    void reset(const sfe_otos_pose2d_t &pose, const sfe_otos_pose2d_t &stdDev);
+
+    /// @brief Sets the odometry noise, as the standard deviation of the error
+    /// per unit of motion. The defaults, 5% of the distance and of the turn,
+    /// suit typical wheel encoders
+    /// @param linearNoise Position error per unit of distance travelled
+    /// @param angularNoise Heading error per unit of heading turned
+    void setOdometryNoise(float linearNoise, float angularNoise);
+
+    /// @brief Propagates the estimate with an odometry delta
+    /// @param delta Motion since the previous delta, in the robot frame: x
+    /// forward, y to the left, h the heading change. A differential drive has
+    /// y = 0, x the mean of the wheel distances, and h their difference over
+    /// the track width
+    void predict(const sfe_otos_pose2d_t &delta);
+
+    /// @brief Corrects the estimate with an OTOS pose
+    /// @param pos Position measured by the OTOS
+    /// @param posStdDev Standard deviation of the position measured by the OTOS
+    /// @return False if the measurement was rejected, when the filter and the
+    /// measurement both claim zero uncertainty
+    bool update(const sfe_otos_pose2d_t &pos, const sfe_otos_pose2d_t &posStdDev);
+
+    /// @brief Corrects the estimate with the result of a selective read, eg.
+    /// read(kSfeOtosGroupPos | kSfeOtosGroupPosStdDev, groups)
+    /// @param groups Read result, with the pos and posStdDev groups
+    /// @return See update(pos, posStdDev)
+    bool update(const sfe_otos_pose_groups_t &groups)
+    {
+        return update(groups.pos, groups.posStdDev);
+    }
+
+    /// @brief Gets the fused pose
+    /// @param pose Fused pose
+    void getPose(sfe_otos_pose2d_t &pose) const;
+
+    /// @brief Gets the standard deviation of the fused pose
+    /// @param stdDev Standard deviation of x, y, and the heading
+    void getStdDev(sfe_otos_pose2d_t &stdDev) const;
+
+  protected:
+    // Indices of the unique covariance terms
+    enum
+    {
+        kXX = 0,
+        kXY,
+        kXH,
+        kYY,
+        kYH,
+        kHH,
+        kNumCovariances
+    };
+
+    float _unitToRad;
+    float _halfTurn;
+    float _linearNoise;
+    float _angularNoise;
+
+    sfe_otos_pose2d_t _pose;
+    float _p[kNumCovariances];
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "sfeQwiicOtos.h"
+#include "utils.h"
+#include "pico/time.h"
+
+// Default time the group waits for a sensor's I2C block to free up
+#ifndef OTOS_GROUP_TIMEOUT_US
+#define OTOS_GROUP_TIMEOUT_US 20000
+#endif
+
+/// @brief Reads the position, velocity, and acceleration of several sensors
+/// at once. Each read is started in the background, so sensors on different
+/// I2C hardware blocks transfer at the same time and the whole group costs
+/// about the latency of one read. Sensors sharing a block are read one after
+/// the other as the block frees up
+/// @param sensors Sensors to read, at most 32
+/// @param count Number of sensors
+/// @param pos Position measured by each sensor
+/// @param vel Velocity measured by each sensor
+/// @param acc Acceleration measured by each sensor
+/// @param timeoutUs Time to get every read started. A sensor whose block is
+/// still busy then, eg. with a background read of a driver outside the group,
+/// fails with kSTkErrBusTimeout. Reads already started are still collected,
+/// the retry policy of their transport bounds them
+/// @return 0 for succuss, otherwise the first error reported by a sensor. Every
+/// sensor is read even if an earlier one fails
+template <class Driver>
+int getPosVelAccGroup(Driver *const sensors[], size_t count, sfe_otos_pose2d_t pos[], sfe_otos_pose2d_t vel[],
+                      sfe_otos_pose2d_t acc[], uint32_t timeoutUs = OTOS_GROUP_TIMEOUT_US)
+{
+    if(count > 32)
+        return kSTkErrFail;
+
+    // One bit per sensor for reads that are on the bus, and for sensors that
+    // are finished
+    uint32_t started = 0;
+    uint32_t finished = 0;
+    uint32_t all = (count == 32) ? 0xFFFFFFFF : ((1u << count) - 1);
+    int result = kSTkErrOk;
+    uint32_t startUs = time_us_32();
+
+    while(finished != all)
+    {
+        bool expired = (time_us_32() - startUs) >= timeoutUs;
+
+        for(size_t i = 0; i < count; i++)
+        {
+            uint32_t bit = 1u << i;
+            if(finished & bit)
+                continue;
+
+            int err;
+            if(!(started & bit))
+            {
+                // The block may still be in use by another sensor of the group
+                err = sensors[i]->startPosVelAccAsync();
+                if(err == kSTkErrBusBusy && !expired)
+                    continue;
+                if(err == kSTkErrBusBusy)
+                    err = kSTkErrBusTimeout;
+                if(err == kSTkErrOk)
+                {
+                    started |= bit;
+                    continue;
+                }
+            }
+            else
+            {
+                err = sensors[i]->pollPosVelAccAsync(pos[i], vel[i], acc[i]);
+                if(err == kSTkErrBusBusy)
+                    continue;
+            }
+
+            // Done with this sensor, one way or another
+            finished |= bit;
+            if(err != kSTkErrOk && result == kSTkErrOk)
+                result = err;
+        }
+    }
+
+    return result;
+}
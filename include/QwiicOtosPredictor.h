@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include "sfeQwiicOtos.h"
+
+/// @brief Extrapolates the pose between OTOS samples, so a fast control loop
+/// gets a pose at any time without touching the bus. Each sample, eg. from
+/// getPosVelAcc() or the background sampler, resets the estimate; in between
+/// the pose is integrated from the last velocity and acceleration, rotating
+/// the velocity with the turn rate so arcs stay on the arc.
+/// @note The velocity and acceleration must be in the field frame, which is
+/// what the OTOS reports with the rotation of signal processing enabled, the
+/// default. update() and predictPose() need no locking between each other,
+/// either may run on another core or interrupt the other, but only one context
+/// may call update()
+class QwiicOTOSPredictor
+{
+  public:
+    /// @brief Constructor
+    /// @param angularUnit Angular unit of the samples, the angular unit of the
+    /// driver they come from
+    QwiicOTOSPredictor(sfe_otos_angular_unit_t angularUnit = kSfeOtosAngularUnitDegrees);
+
+    /// @brief Corrects the estimate with a new measurement
+    /// @param sample Measurement and the time it was acquired
+    void update(const sfe_otos_sample_t &sample);
+
+    /// @brief Predicts the pose at a given time from the last measurement
+    /// @param nowUs Time to predict the pose at, on the clock of the sample
+    /// timestamps, eg. time_us_64()
+    /// @param pose Predicted pose
+    /// @return True if a measurement has been given since reset()
+    bool predictPose(uint64_t nowUs, sfe_otos_pose2d_t &pose) const;
+
+    /// @brief Forgets every measurement
+    void reset();
+
+    /// @brief Sets how far past the last measurement the pose is extrapolated.
+    /// Later predictions hold the pose at the limit, rather than running away
+    /// when samples stop
+    /// @param horizonUs Longest extrapolation in microseconds, 20 ms by default
+    void setMaxHorizonUs(uint32_t horizonUs);
+
+    /// @brief Sets how the difference between the prediction and a new
+    /// measurement is removed. By default the pose jumps to the measurement;
+    /// otherwise the difference fades out linearly, so the pose stays
+    /// continuous for the controller
+    /// @param correctionUs Fade time in microseconds, 0 to jump
+    void setCorrectionTimeUs(uint32_t correctionUs);
+
+    /// @brief Sets whether the acceleration is integrated too. It follows
+    /// speed changes better, but adds the accelerometer noise. Only its
+    /// tangential part is used, the arc already bends the velocity
+    /// @param useAcceleration True to integrate it (default)
+    void setUseAcceleration(bool useAcceleration);
+
+  protected:
+    // Last measurement and the correction still being faded out
+    typedef struct
+    {
+        sfe_otos_sample_t sample;
+        sfe_otos_pose2d_t correction;
+    } predictor_state_t;
+
+    // Integrates a state dt seconds past its measurement
+    void extrapolate(const sfe_otos_sample_t &sample, float dt, sfe_otos_pose2d_t &pose) const;
+
+    // Consistent copy of the published state
+    bool loadState(predictor_state_t &state) const;
+
+    float _unitToRad;
+    float _halfTurn;
+    uint32_t _maxHorizonUs;
+    uint32_t _correctionUs;
+    bool _useAcceleration;
+
+    // Two states, update() writes the one not published. _sequence counts the
+    // published states, its low bit selects the current one, and 0 means none
+    // yet
+    predictor_state_t _state[2];
+    std::atomic<uint32_t> _sequence;
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "sfeQwiicOtos.h"
+
+#ifndef OTOS_RECORDER_BLOCK_SIZE
+#define OTOS_RECORDER_BLOCK_SIZE 512
+#endif
+
+/// @brief Flight recorder keeping a long history of samples in a fixed RAM
+/// arena, without any allocation. Samples are stored as their raw registers,
+/// widened to 32 bits so continuous positions beyond the register range are
+/// kept exactly: each block starts with a full sample, and every following
+/// sample only holds the zig-zag varint deltas of its timestamp and its 9
+/// registers to the previous one, typically 10 to 14 bytes instead of 44. When
+/// the arena is full the oldest block is dropped, so the most recent history
+/// is kept. Samples are decoded only on playback.
+///
+/// All the state lives in the arena, so one placed in uninitialized RAM, eg.
+/// with __uninitialized_ram(), survives a watchdog reset and can be resumed
+/// and dumped after a crash
+/// @note Recording and playback must not run at the same time
+class QwiicOTOSRecorder : protected sfeOtosRuntimeUnits
+{
+  public:
+    /// @brief Constructor
+    /// @param arena Memory holding the recording, aligned to 8 bytes, eg. a
+    /// uint64_t array
+    /// @param size Size of the arena in bytes, at least two blocks
+    QwiicOTOSRecorder(void *arena, size_t size);
+
+    /// @brief Prepares the arena
+    /// @param linearUnit Linear unit of the samples, the one of their driver
+    /// @param angularUnit Angular unit of the samples, the one of their driver
+    /// @param resume True to keep a valid recording already in the arena, eg.
+    /// from before a reset, false to start empty
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int begin(sfe_otos_linear_unit_t linearUnit = kSfeOtosLinearUnitInches,
+              sfe_otos_angular_unit_t angularUnit = kSfeOtosAngularUnitDegrees, bool resume = false);
+
+    /// @brief Drops every sample
+    void clear();
+
+    /// @brief Appends a sample
+    /// @param sample Sample, eg. from QwiicOTOSSampler::getSample()
+    void record(const sfe_otos_sample_t &sample);
+
+    /// @brief Appends a sample from its raw registers
+    /// @param timestampUs Time the sample was acquired
+    /// @param raw Registers, as from getPosVelAccRaw()
+    /// @param isRepeat True if the registers had not changed
+    void recordRaw(uint64_t timestampUs, const int16_t raw[9], bool isRepeat = false);
+
+    /// @brief Restarts playback from the oldest sample
+    void rewind();
+
+    /// @brief Decodes the next sample of the playback
+    /// @param sample Decoded sample, in the units given to begin()
+    /// @return True if a sample was left
+    bool next(sfe_otos_sample_t &sample);
+
+    /// @brief Decodes the raw registers of the next sample of the playback
+    /// @param timestampUs Time the sample was acquired
+    /// @param raw Registers, ordered like getPosVelAccRaw(). Positions beyond
+    /// the register range wrap like the registers do, next() has them whole
+    /// @param isRepeat True if the registers had not changed
+    /// @return True if a sample was left
+    bool nextRaw(uint64_t &timestampUs, int16_t raw[9], bool &isRepeat);
+
+    /// @brief Gets the number of samples held
+    size_t getNumSamples() const;
+
+    /// @brief Gets the number of bytes holding samples, out of the arena
+    size_t getUsedBytes() const;
+
+  protected:
+    // Start of the arena, identifying a prepared recorder
+    typedef struct
+    {
+        uint32_t magic;
+        uint16_t blockSize;
+        uint16_t numBlocks;
+
+        // Oldest block and number of blocks in use
+        uint16_t first;
+        uint16_t count;
+        uint32_t reserved;
+    } recorder_header_t;
+
+    // Start of every block, the full first sample
+    typedef struct
+    {
+        uint64_t timestampUs;
+        int32_t raw[9];
+        uint16_t numSamples;
+        uint16_t used;
+        uint8_t isRepeat;
+        uint8_t reserved;
+    } recorder_block_t;
+
+    static constexpr size_t kBlockData = OTOS_RECORDER_BLOCK_SIZE - sizeof(recorder_block_t);
+
+    // Longest encoded sample, a 64-bit timestamp delta and 9 32-bit deltas
+    static constexpr size_t kMaxDeltaBytes = 10 + 9 * 5;
+
+    recorder_block_t *block(size_t index) const;
+    uint8_t *blockData(recorder_block_t *block) const;
+
+    // Starts a new block with a full sample, dropping the oldest when full
+    void startBlock(uint64_t timestampUs, const int32_t raw[9], bool isRepeat);
+
+    // Appends a sample of 32-bit registers
+    void append(uint64_t timestampUs, const int32_t raw[9], bool isRepeat);
+
+    // Decodes the 32-bit registers of the next sample of the playback
+    bool nextCounts(uint64_t &timestampUs, int32_t raw[9], bool &isRepeat);
+
+    // Decodes one delta record, returns its length
+    static size_t decodeDelta(const uint8_t *data, uint64_t &timestampUs, int32_t raw[9], bool &isRepeat);
+
+    // Rebuilds the counters and the last sample from the arena
+    void scan();
+
+    uint8_t *_arena;
+    size_t _size;
+    recorder_header_t *_header;
+
+    size_t _numSamples;
+    uint64_t _lastTimestampUs;
+    int32_t _lastRaw[9];
+
+    // Playback position: block, offset in its data, and sample within it
+    size_t _readBlock;
+    size_t _readOffset;
+    size_t _readSample;
+    uint64_t _readTimestampUs;
+    int32_t _readRaw[9];
+};
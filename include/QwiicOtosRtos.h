@@ -0,0 +1,176 @@
+#pragma once
+
+#include "sfeQwiicOtos.h"
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
+
+#ifndef OTOS_RTOS_QUEUE_LENGTH
+#define OTOS_RTOS_QUEUE_LENGTH 8
+#endif
+
+#ifndef OTOS_RTOS_STACK_DEPTH
+#define OTOS_RTOS_STACK_DEPTH 512
+#endif
+
+// Task notification slot used to wake the tasks waiting on QwiicOTOSRtos
+#ifndef OTOS_RTOS_NOTIFY_INDEX
+#define OTOS_RTOS_NOTIFY_INDEX 0
+#endif
+
+/// @brief Lock of one I2C hardware block, shared by the OtosRtosBus of every
+/// device on it. It is a FreeRTOS mutex, so a low priority task holding the
+/// bus inherits the priority of a higher one waiting for it, and runs at that
+/// priority until the transfer is done
+/// @note Before the scheduler starts, locking always succeeds
+class OtosRtosBusLock
+{
+  public:
+    OtosRtosBusLock();
+    ~OtosRtosBusLock();
+
+    OtosRtosBusLock(const OtosRtosBusLock &) = delete;
+    OtosRtosBusLock &operator=(const OtosRtosBusLock &) = delete;
+
+    /// @brief Takes the lock
+    /// @param timeout Ticks to wait for it
+    /// @return True if taken
+    bool lock(TickType_t timeout = portMAX_DELAY);
+
+    /// @brief Releases the lock taken by the calling task
+    void unlock();
+
+  protected:
+    SemaphoreHandle_t _mutex;
+};
+
+/// @brief Transport holding a bus lock for every transfer of another one, so
+/// drivers on several tasks, or on both cores with the SMP port, can share an
+/// I2C block. The retry policy of the wrapped transport bounds how long the
+/// lock is held
+/// @note The lock is only held while a DMA read is started and polled, other
+/// transfers on the block return kSTkErrBusBusy in between. The lock cannot be
+/// taken from an interrupt, so QwiicOTOSSampler cannot run on this transport
+class OtosRtosBus final : public sfeOtosTransport
+{
+  public:
+    /// @brief Constructor
+    /// @param bus Transport to the device, eg. QwiicOTOS::getI2C()
+    /// @param lock Lock of the I2C block the device is on
+    /// @param timeout Ticks to wait for the lock before failing with
+    /// kSTkErrBusBusy
+    OtosRtosBus(sfeOtosTransport &bus, OtosRtosBusLock &lock, TickType_t timeout = portMAX_DELAY);
+
+    int ping() override;
+    int readRegisterByte(uint8_t devReg, uint8_t &dataToRead) override;
+    int readRegisterRegion(uint8_t devReg, uint8_t *data, size_t numBytes, size_t &readBytes) override;
+    int writeRegisterByte(uint8_t devReg, uint8_t dataToWrite) override;
+    int writeRegisterRegion(uint8_t devReg, const uint8_t *data, size_t length) override;
+    int startReadRegisterRegionDma(uint8_t devReg, uint8_t *data, size_t numBytes) override;
+    int pollReadRegisterRegionDma(size_t &readBytes) override;
+
+  protected:
+    sfeOtosTransport &_bus;
+    OtosRtosBusLock &_lock;
+    TickType_t _timeout;
+};
+
+/// @brief Serves the requests of several tasks to one OTOS driver from a
+/// single task. Pose reads queued while the previous transaction is running
+/// are merged into one selective read of every group they ask for, see
+/// sfeQwiicOtosPose::read(), so ten tasks asking for the position cost one
+/// transfer. Any other driver call is queued with execute() and runs in order.
+/// The server temporarily takes the priority of the highest task waiting on
+/// it, so a busy medium priority task cannot delay a high priority request
+/// @note Once started, the driver must only be used through this class
+class QwiicOTOSRtos
+{
+  public:
+    /// @brief Constructor
+    /// @param otos Driver served, eg. on an OtosRtosBus
+    QwiicOTOSRtos(sfeQwiicOtos &otos);
+
+    /// @brief Stops the server
+    ~QwiicOTOSRtos();
+
+    /// @brief Creates the server task and its queue
+    /// @param priority Base priority of the server task
+    /// @param stackDepth Stack of the server task, in words
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int start(UBaseType_t priority, configSTACK_DEPTH_TYPE stackDepth = OTOS_RTOS_STACK_DEPTH);
+
+    /// @brief Serves the requests already queued, then deletes the server
+    /// task
+    void stop();
+
+    /// @brief Reads any combination of register groups, possibly merged with
+    /// the reads of other tasks. Blocks the calling task until done
+    /// @param groups Bitmask of sfe_otos_group_t values to read
+    /// @param out Destination of the requested groups
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int read(uint8_t groups, sfe_otos_pose_groups_t &out);
+
+    /// @brief Gets the position, velocity, and acceleration in a single
+    /// burst, possibly merged with the reads of other tasks
+    /// @param pos Position measured by the OTOS
+    /// @param vel Velocity measured by the OTOS
+    /// @param acc Acceleration measured by the OTOS
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int getPosVelAcc(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc);
+
+    /// @brief Runs any driver call on the server task, eg. a configuration
+    /// change, in order with the reads. Blocks the calling task until done
+    /// @param function Call to run, must not use this server itself
+    /// @param context Passed to the function
+    /// @return Result of the function
+    int execute(int (*function)(sfeQwiicOtos &otos, void *context), void *context);
+
+    /// @brief Gets the number of reads requested since start()
+    uint32_t getNumRequests();
+
+    /// @brief Gets the number of driver transactions serving them, fewer than
+    /// the requests when reads were merged
+    uint32_t getNumTransactions();
+
+  protected:
+    // Request living on the stack of the waiting task. A stop request has
+    // neither groups nor function
+    typedef struct
+    {
+        uint8_t groups;
+        sfe_otos_pose_groups_t *out;
+        int (*function)(sfeQwiicOtos &otos, void *context);
+        void *context;
+        TaskHandle_t task;
+        int result;
+    } otos_rtos_request_t;
+
+    // Queues a request and waits for the server to answer it
+    int submit(otos_rtos_request_t &request);
+
+    // Server task entry point, receives the instance as its parameter
+    static void serverEntry(void *parameter);
+
+    // Server loop, returns on a stop request
+    void serve();
+
+    // Reads the union of a batch of merged reads and answers each
+    void serveReads(otos_rtos_request_t **batch, size_t count);
+
+    // Answers a request, waking its task
+    static void reply(otos_rtos_request_t *request, int result);
+
+    sfeQwiicOtos &_otos;
+    TaskHandle_t _task;
+    QueueHandle_t _queue;
+    UBaseType_t _priority;
+
+    // Guards the priority of the server against the requests being queued:
+    // requests queued but not yet received
+    SemaphoreHandle_t _state;
+    uint32_t _pending;
+
+    uint32_t _numRequests;
+    uint32_t _numTransactions;
+};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "sfeQwiicOtos.h"
+#include "sfeOtosRingBuffer.h"
+#include "pico/time.h"
+#include "pico/sem.h"
+
+#ifndef OTOS_SAMPLER_BUFFER_SIZE
+#define OTOS_SAMPLER_BUFFER_SIZE 64
+#endif
+
+/// @brief What the sampler does with the status register
+typedef enum
+{
+    /// @brief Read the pose unconditionally, without the status
+    kOtosSamplerReadAlways = 0,
+
+    /// @brief Read the status with every pose, and drop invalid samples before
+    /// they reach the buffer
+    kOtosSamplerDropInvalid,
+
+    /// @brief Like kOtosSamplerDropInvalid, but once a sample is invalid only
+    /// the status register is read, until tracking is back. Saves the pose
+    /// transfers while the robot is lifted off the surface
+    kOtosSamplerSkipWhenLost
+} otos_sampler_policy_t;
+
+/// @brief Background sampler for the OTOS. A repeating timer reads the
+/// position, velocity, and acceleration at a fixed rate using the non-blocking
+/// DMA reads, and stores each sample in a lock-free ring buffer that the
+/// application drains without touching the bus.
+/// @note Each timer tick collects the read started by the previous tick, so a
+/// sample becomes available one period after it was acquired. The sampler
+/// owns the bus while running, the driver must not be used directly until
+/// stop() is called
+class QwiicOTOSSampler
+{
+  public:
+    /// @brief Constructor
+    /// @param otos Driver used to read the sensor
+    QwiicOTOSSampler(sfeQwiicOtos &otos);
+
+    /// @brief Stops the sampler if it is still running
+    ~QwiicOTOSSampler();
+
+    /// @brief Starts sampling in the background
+    /// @param periodUs Time between samples in microseconds, must be longer
+    /// than one burst read (about 0.5ms at 350kHz)
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int start(uint32_t periodUs);
+
+    /// @brief Sets what the sampler does with the status register, see
+    /// otos_sampler_policy_t. Can only be changed while stopped
+    /// @param policy Status policy, kOtosSamplerReadAlways by default
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int setPolicy(otos_sampler_policy_t policy);
+
+    /// @brief Sets whether repeated samples are kept. A sample is a repeat when
+    /// it was read before the OTOS produced a new measurement, so its
+    /// registers are identical to the previous sample. Kept repeats have
+    /// isRepeat set. Can only be changed while stopped
+    /// @param drop True to drop repeats before they reach the buffer, false to
+    /// keep them (default)
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int setDropRepeats(bool drop);
+
+    /// @brief Enables the low power mode for robots idling for long periods.
+    /// After stillSamples consecutive samples below both velocity thresholds,
+    /// the sampler only wakes every idlePeriodUs. Each wake starts one read,
+    /// which is collected one regular period later, and the core is free to
+    /// sleep in between. The first sample over a threshold switches straight
+    /// back to the regular period. Motion starting during an idle period is
+    /// only seen by the next wake, so the switch back takes up to
+    /// idlePeriodUs plus one regular period. Can only be changed while stopped
+    /// @param idlePeriodUs Time between samples while idle, longer than the
+    /// period given to start(), or 0 to disable (default)
+    /// @param linearThreshold Speed below which x and y count as still, in the
+    /// driver's linear unit per second
+    /// @param angularThreshold Speed below which h counts as still, in the
+    /// driver's angular unit per second
+    /// @param stillSamples Consecutive still samples before going idle
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int setIdleRate(uint32_t idlePeriodUs, float linearThreshold, float angularThreshold, uint16_t stillSamples = 16);
+
+    /// @brief Sets how many new samples are queued before waitForSample()
+    /// returns and the sample callback runs, so a consumer sleeping in between
+    /// wakes once per batch. Only the wakeups are batched: the OTOS has no
+    /// sample FIFO, so the reads are still made one per period, and
+    /// back-to-back reads would just return the same pose. The consumers are
+    /// still woken right away while idle and when motion resumes. Can only be
+    /// changed while stopped
+    /// @param numSamples Samples per wake, 1 by default
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int setBatchSize(size_t numSamples);
+
+    /// @brief Checks whether the sampler is at the idle rate, see setIdleRate()
+    /// @return True if idle
+    bool isIdle();
+
+    /// @brief Sets a function called from the timer interrupt whenever a new,
+    /// non-repeated sample has been queued, or a batch of them, see
+    /// setBatchSize(), eg. to notify a task. It must be short and interrupt
+    /// safe. Can only be changed while stopped
+    /// @param callback Function to call, or nullptr for none
+    /// @param context Argument passed to the callback
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int setSampleCallback(void (*callback)(void *context), void *context);
+
+    /// @brief Stops sampling and waits for any read still on the bus. Samples
+    /// already in the buffer are kept
+    void stop();
+
+    /// @brief Runs a rebase flagged by the background reads, see
+    /// sfeQwiicOtosBase::setAutoRebase(). The reads run from the timer
+    /// interrupt, where the blocking write cannot, so call this from the main
+    /// loop, eg. after each wake. The sampler is stopped for the write and
+    /// restarted, losing about one period of samples, so it only stops when a
+    /// rebase is due
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int serviceRebase();
+
+    /// @brief Checks whether the sampler is running
+    /// @return True if running
+    bool isRunning();
+
+    /// @brief Removes the oldest sample from the buffer
+    /// @param sample Oldest sample
+    /// @return True if a sample was available
+    bool getSample(sfe_otos_sample_t &sample);
+
+    /// @brief Blocks until a new, non-repeated sample, or a batch of them, see
+    /// setBatchSize(), has been queued since the previous wait returned, or the
+    /// timeout expires. The core sleeps in WFE meanwhile. Several samples
+    /// queued in between wake the caller only once, so drain the buffer with
+    /// getSample() after each wake
+    /// @param timeoutUs Longest time to wait in microseconds
+    /// @return True if a new sample was queued, false on timeout
+    bool waitForSample(uint32_t timeoutUs);
+
+    /// @brief Gets the number of samples waiting in the buffer
+    /// @return Number of samples
+    size_t getNumSamples();
+
+    /// @brief Gets the number of samples lost because the buffer was full
+    /// @return Number of dropped samples
+    uint32_t getNumDropped();
+
+    /// @brief Gets the number of reads that failed, or were not started because
+    /// the previous one was still in progress
+    /// @return Number of failed reads
+    uint32_t getNumErrors();
+
+    /// @brief Gets the number of samples dropped or skipped because the status
+    /// register showed tracking was lost or the sensor failed
+    /// @return Number of invalid samples
+    uint32_t getNumInvalid();
+
+    /// @brief Gets the number of repeated samples, whether kept or dropped
+    /// @return Number of repeated samples
+    uint32_t getNumRepeats();
+
+  protected:
+    // Timer callback, forwards to onTimer()
+    static bool timerCallback(repeating_timer_t *rt);
+
+    // Collects the previous read and starts the next one
+    void onTimer();
+
+    // Kinds of read that can be on the bus, by the call that started it
+    enum
+    {
+        kPendingNone = 0,
+        kPendingPose,
+        kPendingChecked,
+        kPendingStatus
+    };
+
+    // Flags repeats, then queues the sample and signals consumers once per
+    // batch, or right away with wakeNow
+    void queue(sfe_otos_sample_t &sample, bool wakeNow);
+
+    // Counts still samples and switches between the regular and idle rates.
+    // Returns true when motion resumes
+    bool updateIdle(const sfe_otos_sample_t &sample);
+
+    // Changes the time to the next tick, and every one after it
+    void setDelay(uint32_t delayUs);
+
+    // Polls the read on the bus. validity is only set for the status-gated
+    // reads
+    int pollPending(sfe_otos_sample_t &sample, sfe_otos_validity_t &validity);
+
+    sfeQwiicOtos &_otos;
+    repeating_timer_t _timer;
+    volatile bool _running;
+    uint32_t _periodUs;
+
+    otos_sampler_policy_t _policy;
+
+    // Read currently on the bus, if any, and when it was started
+    uint8_t _pending;
+    uint64_t _pendingTimestampUs;
+
+    // Last status read showed an invalid sample, see kOtosSamplerSkipWhenLost
+    bool _trackingLost;
+
+    // Low power mode, see setIdleRate(). While idle, _idleRead is set between
+    // the tick starting a read and the one collecting it
+    uint32_t _idlePeriodUs;
+    float _stillLinear;
+    float _stillAngular;
+    uint16_t _stillSamples;
+    uint16_t _stillCount;
+    volatile bool _idle;
+    bool _idleRead;
+
+    // New samples queued since the consumers were last woken
+    size_t _batchSize;
+    size_t _unsignalled;
+
+    // Previous valid sample, to detect repeats
+    bool _dropRepeats;
+    bool _haveLast;
+    sfe_otos_sample_t _last;
+
+    // Signalled for every new sample. A binary semaphore, so a consumer that
+    // falls behind wakes once instead of once per sample
+    semaphore_t _newSample;
+    void (*_callback)(void *context);
+    void *_callbackContext;
+
+    sfeOtosRingBuffer<sfe_otos_sample_t, OTOS_SAMPLER_BUFFER_SIZE> _samples;
+    volatile uint32_t _numDropped;
+    volatile uint32_t _numErrors;
+    volatile uint32_t _numInvalid;
+    volatile uint32_t _numRepeats;
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "sfeQwiicOtos.h"
+
+/// @brief Compact binary telemetry of OTOS samples, for logging over a serial
+/// link. Every frame is a sync byte, a type byte, a fixed-size payload and a
+/// CRC-16 of the type and payload, all little endian:
+///  - Header: protocol version, linear unit, angular unit
+///  - Time: absolute timestamp in microseconds, 64 bits, then the origin of
+///    the positions, 3 int32 counts of x, y, h
+///  - Sample: microseconds since the previous frame's timestamp, 16 bits, then
+///    the 9 raw int16 registers, position x, y, h, velocity, acceleration
+///
+/// A sample's position is the origin plus its registers, so positions beyond
+/// the register range, from continuous tracking, are carried exactly. The
+/// origin is a multiple of 65536 counts and only changes, with a new time
+/// frame, when the position crosses a register wrap
+///
+/// A sample frame is 24 bytes, against about 100 for the same values printed
+/// as text. The registers are sent as read, so a decoder applying the same
+/// conversion factors as the driver reproduces the decoded floats exactly.
+/// The header and a time frame are repeated periodically, so a decoder can
+/// join a stream at any point
+
+/// @brief First byte of every frame
+static constexpr uint8_t kOtosTelemetrySync = 0xA5;
+
+/// @brief Protocol version carried in the header frame
+static constexpr uint8_t kOtosTelemetryVersion = 2;
+
+/// @brief Frame types, the repeat flag can be combined with the sample type
+typedef enum
+{
+    kOtosTelemetryHeader = 'H',
+    kOtosTelemetryTime = 'T',
+    kOtosTelemetrySample = 'S',
+
+    /// @brief Sample whose registers had not changed, see
+    /// sfe_otos_sample_t::isRepeat
+    kOtosTelemetryRepeatFlag = 0x80
+} otos_telemetry_frame_t;
+
+/// @brief Largest output of a single QwiicOTOSTelemetryEncoder::encode() call,
+/// a header, a time and a sample frame
+static constexpr size_t kOtosTelemetryMaxEncodeBytes = 7 + 24 + 24;
+
+/// @brief Encodes samples into telemetry frames
+class QwiicOTOSTelemetryEncoder : protected sfeOtosRuntimeUnits
+{
+  public:
+    /// @brief Constructor
+    /// @param linearUnit Linear unit of the samples, the one of their driver
+    /// @param angularUnit Angular unit of the samples, the one of their driver
+    QwiicOTOSTelemetryEncoder(sfe_otos_linear_unit_t linearUnit = kSfeOtosLinearUnitInches,
+                              sfe_otos_angular_unit_t angularUnit = kSfeOtosAngularUnitDegrees);
+
+    /// @brief Sets how many samples are sent between repeats of the header and
+    /// time frames
+    /// @param numSamples Samples between repeats, 256 by default
+    void setResyncInterval(uint32_t numSamples);
+
+    /// @brief Makes the next encode() start with the header and time frames,
+    /// eg. after frames were lost
+    void resync();
+
+    /// @brief Encodes a sample, preceded by the header and time frames when
+    /// they are due, and by a time frame when the timestamp no longer fits in
+    /// a delta or the position origin changes
+    /// @param sample Sample to encode
+    /// @param out Destination of at least kOtosTelemetryMaxEncodeBytes bytes
+    /// @return Number of bytes written
+    size_t encode(const sfe_otos_sample_t &sample, uint8_t *out);
+
+  protected:
+    // Frame writers, each returning its length
+    size_t encodeHeader(uint8_t *out);
+    size_t encodeTime(uint64_t timestampUs, uint8_t *out);
+
+    uint32_t _resyncInterval;
+    uint32_t _sinceResync;
+    uint64_t _lastTimestampUs;
+    int32_t _origin[3];
+};
+
+/// @brief Decodes telemetry frames back into samples, one byte at a time, so
+/// it can be fed straight from a serial port or a file. Bytes outside valid
+/// frames are skipped, and frames failing their CRC are counted and dropped.
+/// A header of another protocol version stops decoding until a header of
+/// kOtosTelemetryVersion arrives, as its frames may not be laid out the same
+class QwiicOTOSTelemetryDecoder : protected sfeOtosRuntimeUnits
+{
+  public:
+    QwiicOTOSTelemetryDecoder();
+
+    /// @brief Feeds one byte of the stream
+    /// @param byte Next byte
+    /// @param sample Decoded sample, written only when true is returned
+    /// @return True if the byte completed a sample frame
+    bool push(uint8_t byte, sfe_otos_sample_t &sample);
+
+    /// @brief Gets the units of the stream, from its last header frame. Until
+    /// the first header these are the driver defaults, inches and degrees
+    using sfeOtosRuntimeUnits::getLinearUnit;
+    using sfeOtosRuntimeUnits::getAngularUnit;
+
+    /// @brief Gets the number of frames dropped because of a CRC mismatch
+    uint32_t getNumCrcErrors() const;
+
+    /// @brief Gets the number of valid samples dropped because no time frame
+    /// had been received yet, or since a CRC error
+    uint32_t getNumUnsynced() const;
+
+    /// @brief Gets the number of valid frames dropped because the last header
+    /// announced a protocol version other than kOtosTelemetryVersion
+    uint32_t getNumUnsupported() const;
+
+  protected:
+    // Payload length of a frame type, 0 if unknown
+    static size_t payloadLength(uint8_t type);
+
+    // Handles a complete frame that passed its CRC
+    bool decodeFrame(sfe_otos_sample_t &sample);
+
+    // Frame being assembled: type, payload and CRC
+    uint8_t _frame[1 + 20 + 2];
+    size_t _length;
+    size_t _expected;
+    bool _inFrame;
+
+    bool _supported;
+    bool _haveTime;
+    uint64_t _timestampUs;
+    int32_t _origin[3];
+
+    uint32_t _numCrcErrors;
+    uint32_t _numUnsynced;
+    uint32_t _numUnsupported;
+};
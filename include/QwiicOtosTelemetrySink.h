@@ -0,0 +1,69 @@
+#pragma once
+
+#include "QwiicOtosSampler.h"
+#include "QwiicOtosTelemetry.h"
+#include "hardware/uart.h"
+
+#ifndef OTOS_TELEMETRY_BUFFER_SIZE
+#define OTOS_TELEMETRY_BUFFER_SIZE 512
+#endif
+
+/// @brief Streams the samples of a QwiicOTOSSampler as binary telemetry, see
+/// QwiicOtosTelemetry.h. Samples are encoded into one buffer while a DMA
+/// channel drains the other into the UART, so the CPU only spends time on
+/// the encoding. Without a UART the frames go to stdio instead, eg. USB CDC,
+/// without CRLF translation.
+/// @note The UART must be initialized, with its pins, before start(). poll()
+/// must be called often enough to keep up with the sampler, a 24-byte sample
+/// frame takes about 0.26 ms on a 921600 baud UART
+class QwiicOTOSTelemetrySink
+{
+  public:
+    /// @brief Constructor
+    /// @param sampler Sampler whose buffer is drained
+    /// @param otos Driver of the sampler, for the units of the samples
+    /// @param uart UART to stream to, or nullptr for stdio
+    QwiicOTOSTelemetrySink(QwiicOTOSSampler &sampler, sfeQwiicOtos &otos, uart_inst_t *uart);
+
+    /// @brief Waits for the last transfer and releases the DMA channel
+    ~QwiicOTOSTelemetrySink();
+
+    /// @brief Starts streaming, beginning with the header and time frames
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int start();
+
+    /// @brief Sends the samples still buffered, waits for the last transfer
+    /// and releases the DMA channel
+    void stop();
+
+    /// @brief Drains the sampler's buffer into the stream. Call it from the
+    /// main loop
+    /// @return Number of samples encoded
+    size_t poll();
+
+    /// @brief Gets the number of bytes handed to the UART or stdio
+    uint64_t getNumBytes();
+
+    /// @brief Gets the number of samples encoded
+    uint32_t getNumSamples();
+
+  protected:
+    // Sends the buffer being filled, if the previous transfer has finished
+    void flush();
+
+    QwiicOTOSSampler &_sampler;
+    sfeQwiicOtos &_otos;
+    uart_inst_t *_uart;
+    QwiicOTOSTelemetryEncoder _encoder;
+    bool _running;
+    int _dmaChannel;
+
+    // Double buffer, _fill bytes of _buffer[_active] are waiting to be sent
+    // while the DMA reads the other one
+    uint8_t _buffer[2][OTOS_TELEMETRY_BUFFER_SIZE];
+    int _active;
+    size_t _fill;
+
+    uint64_t _numBytes;
+    uint32_t _numSamples;
+};
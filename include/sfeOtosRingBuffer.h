@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief Fixed-size single-producer single-consumer ring buffer. One context
+/// (eg. a timer interrupt) may push while another (eg. the main loop) pops,
+/// without any locking. Neither side ever blocks
+/// @tparam T Item type, copied in and out of the buffer
+/// @tparam N Capacity of the buffer, must be a power of two
+template <typename T, size_t N>
+class sfeOtosRingBuffer
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "Ring buffer size must be a power of two");
+
+  public:
+    /// @brief Adds an item to the buffer. Must only be called by the producer
+    /// @param item Item to add
+    /// @return True if the item was added, false if the buffer is full
+    bool push(const T &item)
+    {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) >= N)
+            return false;
+
+        _items[head & (N - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Removes the oldest item from the buffer. Must only be called by
+    /// the consumer
+    /// @param item Oldest item in the buffer
+    /// @return True if an item was removed, false if the buffer is empty
+    bool pop(T &item)
+    {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire))
+            return false;
+
+        item = _items[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Gets the number of items currently in the buffer
+    /// @return Number of items
+    size_t size() const
+    {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    /// @brief Discards every item in the buffer. Must only be called by the
+    /// consumer
+    void clear()
+    {
+        _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    /// @brief Capacity of the buffer
+    static constexpr size_t kCapacity = N;
+
+  private:
+    T _items[N];
+
+    // Free-running indices, only ever written by the producer and the consumer
+    // respectively. Wrapping is handled by the unsigned subtraction
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+};
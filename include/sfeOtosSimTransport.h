@@ -0,0 +1,129 @@
+#pragma once
+
+#include "sfeQwiicOtos.h"
+
+/// @brief Simulated OTOS behind the transport interface, with no hardware or
+/// Pico SDK dependency, so the driver, the decode paths and the buffering can
+/// be exercised and profiled on a workstation. It implements the register map
+/// of the sensor, moves along a synthetic circular trajectory, and models the
+/// bus with a virtual clock: every transfer advances simulated time by a fixed
+/// latency plus a time per byte, instead of actually waiting. Errors and short
+/// reads can be injected at a given rate
+class sfeOtosSimTransport final : public sfeOtosTransport
+{
+  public:
+    /// @brief Default constructor, a 1 m circle at 1 rad/s refreshed every
+    /// 2.4 ms, on a 400 kHz bus without injected errors
+    sfeOtosSimTransport();
+
+    int ping() override;
+    int readRegisterByte(uint8_t devReg, uint8_t &dataToRead) override;
+    int readRegisterRegion(uint8_t devReg, uint8_t *data, size_t numBytes, size_t &readBytes) override;
+    int writeRegisterByte(uint8_t devReg, uint8_t dataToWrite) override;
+    int writeRegisterRegion(uint8_t devReg, const uint8_t *data, size_t length) override;
+    int startReadRegisterRegionDma(uint8_t devReg, uint8_t *data, size_t numBytes) override;
+    int pollReadRegisterRegionDma(size_t &readBytes) override;
+
+    /// @brief Sets the trajectory, a circle around the origin driven with the
+    /// heading tangent to it
+    /// @param radius Radius in meters
+    /// @param angularRate Angular rate in radians per second
+    void setCircle(float radius, float angularRate);
+
+    /// @brief Sets how often the simulated sensor refreshes its pose registers.
+    /// Reads in between return the same values
+    /// @param periodUs Refresh period in microseconds, 0 to refresh on every
+    /// transfer
+    void setUpdatePeriodUs(uint32_t periodUs);
+
+    /// @brief Sets the bus timing model
+    /// @param transferUs Simulated time of every transfer, covering the start,
+    /// address and register bytes
+    /// @param byteUs Simulated time of every data byte
+    void setLatency(uint32_t transferUs, uint32_t byteUs);
+
+    /// @brief Sets the error injection rates
+    /// @param errorPpm Transfers failing as if NAKed, per million
+    /// @param underReadPpm Reads returning half the data, per million
+    void setErrorRate(uint32_t errorPpm, uint32_t underReadPpm);
+
+    /// @brief Sets how many times pollReadRegisterRegionDma() reports busy
+    /// before a background read completes
+    /// @param polls Busy polls per read
+    void setAsyncPolls(uint32_t polls);
+
+    /// @brief Sets the value returned by the status register
+    /// @param status Status register value, see sfe_otos_status_t
+    void setStatus(uint8_t status);
+
+    /// @brief Advances the simulated time, eg. from the driver's delayMs()
+    /// @param us Microseconds to advance
+    void advanceUs(uint64_t us);
+
+    /// @brief Gets the simulated time
+    /// @return Microseconds since construction
+    uint64_t getTimeUs() const;
+
+    /// @brief Gets the position on the trajectory at the last register refresh,
+    /// before register quantization
+    /// @param pos Position in meters and radians, including any position set
+    /// through the registers
+    void getTruePosition(sfe_otos_pose2d_t &pos) const;
+
+    /// @brief Gets the number of transfers seen, including failed ones
+    uint32_t getNumTransfers() const;
+
+    /// @brief Gets the number of injected errors and short reads
+    uint32_t getNumInjectedErrors() const;
+
+  private:
+    // Register map size, covering every register up to kRegAccStdHH
+    static constexpr size_t kNumRegs = 0x44;
+
+    // Accounts for one transfer: advances the clock, refreshes the registers
+    // when due, and decides whether to inject a fault
+    void beginTransfer(size_t numBytes);
+    bool inject(uint32_t ppm);
+    void refresh(bool force);
+
+    // Handles a register write landing in the map
+    void writeRegs(uint8_t devReg, const uint8_t *data, size_t length);
+
+    static void packPose(uint8_t *rawData, float x, float y, float h, float xyToRaw, float hToRaw,
+                         bool wrap = false);
+
+    uint8_t _regs[kNumRegs];
+
+    float _radius;
+    float _angularRate;
+    uint32_t _updatePeriodUs;
+    uint32_t _transferUs;
+    uint32_t _byteUs;
+    uint32_t _errorPpm;
+    uint32_t _underReadPpm;
+    uint32_t _asyncPolls;
+
+    uint64_t _timeUs;
+    uint64_t _lastRefreshUs;
+    sfe_otos_pose2d_t _trajectory;
+    sfe_otos_pose2d_t _truePos;
+
+    // Position set through the registers or a tracking reset, relative to the
+    // trajectory
+    sfe_otos_pose2d_t _bias;
+
+    // IMU calibration in progress, counted down while time passes
+    uint8_t _calibSamples;
+    uint64_t _calibStartUs;
+
+    // Background read in progress
+    bool _asyncActive;
+    uint8_t _asyncReg;
+    uint8_t *_asyncData;
+    size_t _asyncLength;
+    uint32_t _asyncPollsLeft;
+
+    uint32_t _rng;
+    uint32_t _numTransfers;
+    uint32_t _numInjected;
+};
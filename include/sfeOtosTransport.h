@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h> //to use size_t
+
+/// @brief Result codes shared by the driver and every transport. 0 for
+/// success, negative for errors, positive for warnings
+static constexpr int kSTkErrOk = 0;
+static constexpr int kSTkErrFail = -1;
+
+const int kSTkErrBaseBus = 0x1000;
+const int kSTkErrBusNotInit = kSTkErrFail * (kSTkErrBaseBus + 1);
+const int kSTkErrBusTimeout = kSTkErrFail * (kSTkErrBaseBus + 2);
+const int kSTkErrBusNoResponse = kSTkErrFail * (kSTkErrBaseBus + 3);
+const int kSTkErrBusDataTooLong = kSTkErrFail * (kSTkErrBaseBus + 4);
+const int kSTkErrBusNullBuffer = kSTkErrFail * (kSTkErrBaseBus + 6);
+const int kSTkErrBusUnderRead = kSTkErrBaseBus + 7;
+const int kSTkErrBusBusy = kSTkErrBaseBus + 9;
+const int kSTkErrBusStuck = kSTkErrFail * (kSTkErrBaseBus + 10);
+
+/// @brief Register access to one OTOS, implemented by each bus the driver can
+/// run on (eg. OtosI2C, OtosPioI2C, or a mock). Every method returns 0 for
+/// success, negative for errors, positive for warnings. The driver calls
+/// through this interface for configuration; the pose reads can instead be
+/// bound to a final transport class at compile time, see sfeQwiicOtosPose
+class sfeOtosTransport
+{
+  public:
+    /// @brief Checks whether the device acknowledges its address
+    virtual int ping() = 0;
+
+    /// @brief Reads a single register
+    /// @param devReg Register address
+    /// @param dataToRead Register value
+    virtual int readRegisterByte(uint8_t devReg, uint8_t &dataToRead) = 0;
+
+    /// @brief Reads consecutive registers in one burst
+    /// @param devReg Address of the first register
+    /// @param data Destination of the register values
+    /// @param numBytes Number of registers to read
+    /// @param readBytes Number of registers actually read
+    virtual int readRegisterRegion(uint8_t devReg, uint8_t *data, size_t numBytes, size_t &readBytes) = 0;
+
+    /// @brief Writes a single register
+    /// @param devReg Register address
+    /// @param dataToWrite Register value
+    virtual int writeRegisterByte(uint8_t devReg, uint8_t dataToWrite) = 0;
+
+    /// @brief Writes consecutive registers in one burst
+    /// @param devReg Address of the first register
+    /// @param data Register values
+    /// @param length Number of registers to write
+    virtual int writeRegisterRegion(uint8_t devReg, const uint8_t *data, size_t length) = 0;
+
+    /// @brief Starts reading consecutive registers in the background. The
+    /// buffer must stay valid until pollReadRegisterRegionDma() succeeds or
+    /// fails
+    /// @param devReg Address of the first register
+    /// @param data Destination of the register values
+    /// @param numBytes Number of registers to read
+    virtual int startReadRegisterRegionDma(uint8_t devReg, uint8_t *data, size_t numBytes) = 0;
+
+    /// @brief Checks whether the background read has finished
+    /// @param readBytes Number of registers read once finished
+    /// @return 0 once finished, kSTkErrBusBusy while still in progress,
+    /// negative for errors
+    virtual int pollReadRegisterRegionDma(size_t &readBytes) = 0;
+
+  protected:
+    // Transports are never destroyed through the interface
+    ~sfeOtosTransport() = default;
+};
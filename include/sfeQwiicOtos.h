@@ -19,6 +19,9 @@
 #include <math.h>
 #include <stdint.h>
 #include <stddef.h> //to use size_t
+#include <string.h>
+
+#include "sfeOtosTransport.h"
 
 /// @struct sfe_otos_pose2d_t
 /// @brief 2D pose structure, including x and y coordinates and heading angle
@@ -36,6 +39,146 @@ typedef struct
     float h;
 } sfe_otos_pose2d_t;
 
+/// @struct sfe_otos_pose2d_q_t
+/// @brief 2D pose structure in signed Q16.16 fixed point, for applications
+/// that avoid floating point math entirely
+/// @note Fixed-point poses are always in meters and radians (or their
+/// derivatives), regardless of the units set with setLinearUnit() and
+/// setAngularUnit()
+typedef struct
+{
+    /// @brief X value
+    int32_t x;
+
+    /// @brief Y value
+    int32_t y;
+
+    /// @brief Heading value
+    int32_t h;
+} sfe_otos_pose2d_q_t;
+
+/// @struct sfe_otos_q_scale_t
+/// @brief Integer scale factor converting a raw register value to Q16.16,
+/// applied as (raw * mult) >> shift. The multiplier is kept below 2^16 so the
+/// product of any int16 register value always fits in 32 bits
+typedef struct
+{
+    /// @brief Multiplier
+    int32_t mult;
+
+    /// @brief Right shift applied after the multiplication
+    uint8_t shift;
+} sfe_otos_q_scale_t;
+
+/// @brief Computes the most precise fixed-point scale factor for a register
+/// resolution, by finding the largest shift that keeps the multiplier below 2^16
+/// @param rawToUnit Value of one register count
+/// @param shift Smallest shift to try
+/// @return Scale factor converting a register value to Q16.16
+constexpr sfe_otos_q_scale_t sfeOtosQScale(double rawToUnit, uint8_t shift = 0)
+{
+    return (rawToUnit * 65536.0 * (1u << (shift + 1)) + 0.5 >= 65536.0)
+               ? sfe_otos_q_scale_t{(int32_t)(rawToUnit * 65536.0 * (1u << shift) + 0.5), shift}
+               : sfeOtosQScale(rawToUnit, shift + 1);
+}
+
+/// @struct sfe_otos_conversion_t
+/// @brief Fused conversion factors between the raw registers of one register
+/// group and the linear and angular units, in both directions
+typedef struct
+{
+    /// @brief Raw x and y registers to linear unit
+    float rawToXY;
+
+    /// @brief Raw heading register to angular unit
+    float rawToH;
+
+    /// @brief Linear unit to raw x and y registers
+    float xyToRaw;
+
+    /// @brief Angular unit to raw heading register
+    float hToRaw;
+} sfe_otos_conversion_t;
+
+/// @brief Recovers a register value from a value decoded with the factors of
+/// sfe_otos_conversion_t. The decoded float is the register times a factor,
+/// with far less relative error than half a count, so rounding is exact
+/// @param value Decoded value
+/// @param toRaw Unit to raw factor, xyToRaw or hToRaw
+/// @return Register value, saturated to the int16 range
+inline int16_t sfeOtosToRaw(float value, float toRaw)
+{
+    float raw = value * toRaw;
+    if(raw >= 32767.0f)
+        return 32767;
+    if(raw <= -32768.0f)
+        return -32768;
+    return (int16_t)lrintf(raw);
+}
+
+/// @brief Recovers the 32-bit counts of a position decoded with continuous
+/// tracking, see sfeQwiicOtosBase::getContinuousPositionRaw(). Exact like
+/// sfeOtosToRaw() within the float precision, +/-2^23 counts
+/// @param value Decoded value
+/// @param toRaw Unit to raw factor, xyToRaw or hToRaw
+/// @return Counts, saturated to the int32 range
+inline int32_t sfeOtosToCounts(float value, float toRaw)
+{
+    float raw = value * toRaw;
+    if(raw >= 2147483520.0f)
+        return INT32_MAX;
+    if(raw <= -2147483648.0f)
+        return INT32_MIN;
+    return (int32_t)lrintf(raw);
+}
+
+/// @brief Converts raw registers or continuous counts to a pose, with the
+/// factors of sfe_otos_conversion_t. Every decoder of raw values goes through
+/// this, so they all reproduce the driver's floats exactly
+/// @param raw Registers or counts of x, y, and h
+/// @param conversion Factors of the register group
+/// @param pose Pose in the units of the factors
+inline void sfeOtosFromRaw(const int32_t raw[3], const sfe_otos_conversion_t &conversion, sfe_otos_pose2d_t &pose)
+{
+    pose.x = raw[0] * conversion.rawToXY;
+    pose.y = raw[1] * conversion.rawToXY;
+    pose.h = raw[2] * conversion.rawToH;
+}
+
+/// @struct sfe_otos_sample_t
+/// @brief Position, velocity, and acceleration read in a single burst, stamped
+/// with the time the read was started
+typedef struct
+{
+    /// @brief Time the sample was acquired, in microseconds since boot
+    uint64_t timestampUs;
+
+    /// @brief Position measured by the OTOS
+    sfe_otos_pose2d_t pos;
+
+    /// @brief Velocity measured by the OTOS
+    sfe_otos_pose2d_t vel;
+
+    /// @brief Acceleration measured by the OTOS
+    sfe_otos_pose2d_t acc;
+
+    /// @brief True if the registers had not changed since the previous sample,
+    /// ie. it was read before the OTOS produced a new measurement
+    bool isRepeat;
+} sfe_otos_sample_t;
+
+/// @brief Checks whether two samples hold the same reading. The conversion
+/// from the registers is exact and the same for both, so this is equivalent to
+/// comparing the raw register frames
+/// @param a First sample
+/// @param b Second sample
+/// @return True if the position, velocity, and acceleration are identical
+inline bool sfeOtosSameReading(const sfe_otos_sample_t &a, const sfe_otos_sample_t &b)
+{
+    return memcmp(&a.pos, &b.pos, sizeof(a.pos)) == 0 && memcmp(&a.vel, &b.vel, sizeof(a.vel)) == 0 &&
+           memcmp(&a.acc, &b.acc, sizeof(a.acc)) == 0;
+}
+
 /// @enum sfe_otos_linear_unit_t
 /// @brief Enumerations for linear units used by the OTOS driver
 typedef enum
@@ -58,6 +201,37 @@ typedef enum
     kSfeOtosAngularUnitDegrees = 1
 } sfe_otos_angular_unit_t;
 
+/// @brief Gets the size of a half turn in an angular unit
+/// @param unit Angular unit
+/// @return Pi for radians, 180 for degrees
+inline float sfeOtosHalfTurn(sfe_otos_angular_unit_t unit)
+{
+    return (unit == kSfeOtosAngularUnitRadians) ? (float)M_PI : 180.0f;
+}
+
+/// @brief Gets the factor from an angular unit to radians
+/// @param unit Angular unit
+/// @return Radians per unit
+inline float sfeOtosUnitToRadians(sfe_otos_angular_unit_t unit)
+{
+    return (unit == kSfeOtosAngularUnitRadians) ? 1.0f : (float)(M_PI / 180.0);
+}
+
+/// @brief Wraps a heading into the half turn either side of zero. Only one
+/// turn is added or removed, which is enough for the sum or difference of two
+/// wrapped headings
+/// @param h Heading, within a turn and a half of zero
+/// @param halfTurn Half turn in the unit of h, see sfeOtosHalfTurn()
+/// @return Heading in [-halfTurn, halfTurn)
+inline float sfeOtosWrapHeading(float h, float halfTurn)
+{
+    if(h >= halfTurn)
+        return h - 2 * halfTurn;
+    if(h < -halfTurn)
+        return h + 2 * halfTurn;
+    return h;
+}
+
 /// @union sfe_otos_version_t
 /// @brief Version register bit fields
 typedef union {
@@ -154,15 +328,161 @@ typedef union {
     uint8_t value;
 } sfe_otos_status_t;
 
-/// @brief Class for the SparkFun Qwiic Optical Tracking Odometry Sensor (OTOS).
-/// Includes methods to communicate with the sensor, such as getting the tracked
-/// location, configuring the sensor, etc. This class is a base class that must
-/// be derived to implement the delay function and I2C communication bus.
-class sfeQwiicOtos
+/// @enum sfe_otos_validity_t
+/// @brief Validity of a sample, from the status register read with it, see
+/// sfeQwiicOtosBase::getStatusValidity()
+typedef enum
+{
+    /// @brief Optical tracking is working, the sample can be used
+    kSfeOtosSampleValid = 0,
+
+    /// @brief Optical tracking is unreliable, eg. while the robot is lifted.
+    /// The pose only follows the IMU and drifts quickly
+    kSfeOtosSampleTrackingLost,
+
+    /// @brief The optical sensor or the IMU reports a fatal error
+    kSfeOtosSampleSensorFault
+} sfe_otos_validity_t;
+
+/// @enum sfe_otos_status_read_t
+/// @brief How a status-gated read gets the status register, see
+/// sfeQwiicOtosPose::getPosVelAccChecked()
+typedef enum
+{
+    /// @brief Read the status register and the pose block in one burst. The
+    /// status register sits right before the pose, so this costs one byte
+    kSfeOtosStatusFused = 0,
+
+    /// @brief Read the status register first, and the pose block only when the
+    /// sample is valid. Costs a second transfer for valid samples, but skips
+    /// the pose data entirely while tracking is lost
+    kSfeOtosStatusFirst
+} sfe_otos_status_read_t;
+
+/// @enum sfe_otos_group_t
+/// @brief Bitmask of register groups for selective reads, see
+/// sfeQwiicOtosPose::read()
+typedef enum
+{
+    /// @brief Position
+    kSfeOtosGroupPos = 1 << 0,
+
+    /// @brief Velocity
+    kSfeOtosGroupVel = 1 << 1,
+
+    /// @brief Acceleration
+    kSfeOtosGroupAcc = 1 << 2,
+
+    /// @brief Standard deviation of the position
+    kSfeOtosGroupPosStdDev = 1 << 3,
+
+    /// @brief Standard deviation of the velocity
+    kSfeOtosGroupVelStdDev = 1 << 4,
+
+    /// @brief Standard deviation of the acceleration
+    kSfeOtosGroupAccStdDev = 1 << 5,
+
+    /// @brief Every group
+    kSfeOtosGroupAll = 0x3F
+} sfe_otos_group_t;
+
+/// @struct sfe_otos_pose_groups_t
+/// @brief Destination of a selective read. Only the requested groups are
+/// written, the others are left untouched
+typedef struct
+{
+    /// @brief Position measured by the OTOS
+    sfe_otos_pose2d_t pos;
+
+    /// @brief Velocity measured by the OTOS
+    sfe_otos_pose2d_t vel;
+
+    /// @brief Acceleration measured by the OTOS
+    sfe_otos_pose2d_t acc;
+
+    /// @brief Standard deviation of the position measured by the OTOS
+    sfe_otos_pose2d_t posStdDev;
+
+    /// @brief Standard deviation of the velocity measured by the OTOS
+    sfe_otos_pose2d_t velStdDev;
+
+    /// @brief Standard deviation of the acceleration measured by the OTOS
+    sfe_otos_pose2d_t accStdDev;
+} sfe_otos_pose_groups_t;
+
+/// @struct sfe_otos_config_t
+/// @brief Start-up configuration of the OTOS, written at once by
+/// sfeQwiicOtosPose::applyConfig()
+typedef struct
+{
+    /// @brief Linear scalar, must be between 0.872 and 1.127
+    float linearScalar;
+
+    /// @brief Angular scalar, must be between 0.872 and 1.127
+    float angularScalar;
+
+    /// @brief Signal processing configuration
+    sfe_otos_signal_process_config_t signalProcess;
+
+    /// @brief Offset of the sensor relative to the center of the robot, in the
+    /// units of the driver
+    sfe_otos_pose2d_t offset;
+
+    /// @brief Number of IMU calibration samples, 0 to skip the calibration
+    uint8_t imuCalibSamples;
+
+    /// @brief Whether to reset the tracking
+    bool resetTracking;
+
+    /// @brief Whether to set the position below, after any reset
+    bool setPosition;
+
+    /// @brief Position to track from, in the units of the driver
+    sfe_otos_pose2d_t position;
+} sfe_otos_config_t;
+
+/// @struct sfe_otos_snapshot_t
+/// @brief Tuned state of the OTOS as raw register values, independent of the
+/// units of the driver, see sfeQwiicOtosBase::getSnapshot()
+typedef struct
+{
+    /// @brief Linear and angular scalar registers
+    uint8_t scalarLinear;
+    uint8_t scalarAngular;
+
+    /// @brief Signal processing configuration
+    sfe_otos_signal_process_config_t signalProcess;
+
+    /// @brief Offset registers, x, y, then h, little-endian
+    uint8_t offset[6];
+
+    /// @brief Position registers, x, y, then h, little-endian
+    uint8_t position[6];
+} sfe_otos_snapshot_t;
+
+class sfeOtosRuntimeUnits;
+template <sfe_otos_linear_unit_t LinearUnit, sfe_otos_angular_unit_t AngularUnit> class sfeOtosFixedUnits;
+
+/// @brief Base class for the SparkFun Qwiic Optical Tracking Odometry Sensor
+/// (OTOS). Includes every method that does not depend on the linear and
+/// angular units, such as configuring the sensor.
+/// This class must be derived to implement the delay function, and be given a
+/// transport to communicate with the sensor, see sfeQwiicOtos
+class sfeQwiicOtosBase
 {
   public:
-    /// @brief Default constructor, only initializes member variables
-    sfeQwiicOtos();
+    /// @brief Default constructor, only initializes member variables. The bus
+    /// must be set with setBus() before any other method is called
+    sfeQwiicOtosBase();
+
+    /// @brief Sets the bus used to communicate with the OTOS, which must
+    /// outlive the driver
+    /// @param bus Transport connected to the OTOS
+    void setBus(sfeOtosTransport &bus);
+
+    /// @brief Gets the bus used to communicate with the OTOS
+    /// @return Transport connected to the OTOS
+    sfeOtosTransport &getBus();
 
     /// @brief Checks if the device is connected
     /// @return 0 for succuss, negative for errors, positive for warnings
@@ -193,21 +513,36 @@ class sfeQwiicOtos
     /// @return 0 for succuss, negative for errors, positive for warnings
     int getImuCalibrationProgress(uint8_t &numSamples);
 
-    /// @brief Gets the linear unit used by all methods using a pose
-    /// @return Linear unit
-    sfe_otos_linear_unit_t getLinearUnit();
-
-    /// @brief Sets the linear unit used by all methods using a pose
-    /// @param unit Linear unit
-    void setLinearUnit(sfe_otos_linear_unit_t unit);
-
-    /// @brief Gets the angular unit used by all methods using a pose
-    /// @return Angular unit
-    sfe_otos_angular_unit_t getAngularUnit();
+    /// @brief Starts an IMU calibration without blocking. Call
+    /// stepImuCalibration() after nextStepUs, eg. from the main loop or a
+    /// hardware alarm, until it stops returning kSTkErrBusBusy
+    /// @param numSamples Number of samples to take for calibration, see
+    /// calibrateImu()
+    /// @param nextStepUs Time to wait before the first step, in microseconds
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int startImuCalibration(uint8_t numSamples, uint32_t &nextStepUs);
+
+    /// @brief Advances the calibration started by startImuCalibration() with a
+    /// single register read. Never blocks beyond that read
+    /// @param nextStepUs Time to wait before the next step, in microseconds,
+    /// from the number of samples left
+    /// @return 0 once the calibration is done, kSTkErrBusBusy while it is still
+    /// in progress or the bus is busy, negative for errors or a calibration
+    /// that does not finish
+    int stepImuCalibration(uint32_t &nextStepUs);
+
+    /// @brief Starts a self test without blocking. Call stepSelfTest() after
+    /// nextStepUs until it stops returning kSTkErrBusBusy
+    /// @param nextStepUs Time to wait before the first step, in microseconds
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int startSelfTest(uint32_t &nextStepUs);
 
-    /// @brief Sets the angular unit used by all methods using a pose
-    /// @param unit Angular unit
-    void setAngularUnit(sfe_otos_angular_unit_t unit);
+    /// @brief Advances the self test started by startSelfTest() with a single
+    /// register read. Never blocks beyond that read
+    /// @param nextStepUs Time to wait before the next step, in microseconds
+    /// @return 0 once the self test has passed, kSTkErrBusBusy while it is
+    /// still in progress or the bus is busy, negative if it failed
+    int stepSelfTest(uint32_t &nextStepUs);
 
     /// @brief Gets the linear scalar used by the OTOS
     /// @param scalar Linear scalar
@@ -253,6 +588,576 @@ class sfeQwiicOtos
     /// @return 0 for succuss, negative for errors, positive for warnings
     int getStatus(sfe_otos_status_t &status);
 
+    /// @brief Starts a non-blocking read of the status register. The transfer
+    /// runs in the background, use pollStatusAsync() to get the result
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int startStatusAsync();
+
+    /// @brief Checks whether the read started by startStatusAsync() has
+    /// finished
+    /// @param status Status register value, left untouched while the transfer
+    /// is still in progress
+    /// @return 0 once the read is complete, kSTkErrBusBusy while it is still in
+    /// progress, negative for errors
+    int pollStatusAsync(sfe_otos_status_t &status);
+
+    /// @brief Classifies a status register value. A tilt warning alone leaves
+    /// the sample valid, since only the accelerometer is ignored while it is
+    /// set
+    /// @param status Status register value
+    /// @return Validity of a sample read with this status
+    static sfe_otos_validity_t getStatusValidity(sfe_otos_status_t status);
+
+    /// @brief Captures the scalars, signal processing configuration, offset,
+    /// and current position in a single burst read, eg. to store them with
+    /// otosSnapshotSave() and restore them on the next boot
+    /// @param snapshot Captured state
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int getSnapshot(sfe_otos_snapshot_t &snapshot);
+
+    /// @brief Restores a state captured by getSnapshot() with the fewest
+    /// writes, then verifies the configuration with a single read. The IMU
+    /// calibration is internal to the OTOS and cannot be captured, so it is
+    /// up to the caller whether to recalibrate
+    /// @param snapshot State to restore
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int restoreSnapshot(const sfe_otos_snapshot_t &snapshot);
+
+    /// @brief Enables continuous tracking. The position registers wrap at
+    /// +/-10 meters and the heading at +/-180 degrees; with continuous tracking
+    /// every position read continues across the wraps instead, so the position
+    /// grows past 10 meters and the heading counts whole turns. Each read is
+    /// unwrapped against the previous one, so the position must be read at
+    /// least once every 5 meters and half turn of motion. setPosition() then
+    /// accepts positions beyond the register range too. The exceptions are
+    /// getPosVelAccRaw(), which returns the registers as read but still keeps
+    /// the tracking going, and decodeFrames(), which only sees the frames
+    /// @param enable True to enable, false to return the raw wrapped position
+    /// (default)
+    void setContinuousTracking(bool enable);
+
+    /// @brief Checks whether continuous tracking is enabled
+    /// @return True if enabled
+    bool getContinuousTracking();
+
+    /// @brief Keeps the position registers near the origin during continuous
+    /// tracking. When a position read finds x or y past the threshold, the
+    /// driver writes both back to zero right away, in a single position write,
+    /// and keeps the shift in a 32-bit origin, so the positions read stay
+    /// continuous and the registers never come close to wrapping. Motion
+    /// between the sensor's last update and the write is lost, about the
+    /// speed times a millisecond or two per rebase, so a threshold close to
+    /// the register range keeps rebases rare. The write happens in the
+    /// blocking read that crossed the threshold. A background poll crossing it
+    /// only flags the rebase, since it may run in an interrupt, and the write
+    /// then waits for the next blocking position read or serviceRebase()
+    /// @param enable True to enable, false to let the registers wrap (default)
+    /// @param thresholdMeters Distance from the origin of the registers that
+    /// triggers a rebase, up to 10 meters
+    void setAutoRebase(bool enable, float thresholdMeters = 8.0f);
+
+    /// @brief Gets the number of times the registers were rebased
+    /// @return Number of rebases
+    uint32_t getNumRebases();
+
+    /// @brief Checks whether a position read crossed the rebase threshold
+    /// without rebasing yet, see setAutoRebase()
+    /// @return True if a rebase is due
+    bool isRebaseDue();
+
+    /// @brief Runs a due rebase, eg. one flagged by the background polls. The
+    /// position is read again right before the write. Call from the main loop,
+    /// not from an interrupt, and with no background read pending, see
+    /// QwiicOTOSSampler::serviceRebase()
+    /// @return 0 for succuss, negative for errors, positive for warnings.
+    /// kSTkErrBusBusy while a background read is pending
+    int serviceRebase();
+
+    /// @brief Gets the continuous position of the last position read, in
+    /// register counts, without any floating point math
+    /// @param raw Counts of x, y, and h, 32-bit so they span +/-655 km and
+    /// +/-32768 turns
+    /// @return True if continuous tracking is enabled and a position has been
+    /// read since
+    bool getContinuousPositionRaw(int32_t raw[3]);
+
+    /// @brief Converts a batch of raw pose frames to fixed point, into separate
+    /// x, y, and h arrays, see sfeQwiicOtosPose::decodeFrames()
+    /// @param frames Raw registers of the first frame, x, y, then h,
+    /// little-endian as read from the OTOS
+    /// @param numFrames Number of frames
+    /// @param xs X values in meters or its derivative, Q16.16
+    /// @param ys Y values in meters or its derivative, Q16.16
+    /// @param hs Heading values in radians or its derivative, Q16.16
+    /// @param group Register group held by the frames, a single
+    /// sfe_otos_group_t value
+    /// @param stride Bytes from one frame to the next, at least 6
+    static void decodeFramesQ(const uint8_t *frames, size_t numFrames, int32_t *xs, int32_t *ys, int32_t *hs,
+                              sfe_otos_group_t group = kSfeOtosGroupPos, size_t stride = 6);
+
+    /// @brief Default I2C addresses of the Qwiic OTOS
+    static constexpr uint8_t kDefaultAddress = 0x17;
+
+    /// @brief Minimum scalar value for the linear and angular scalars
+    static constexpr float kMinScalar = 0.872f;
+
+    /// @brief Maximum scalar value for the linear and angular scalars
+    static constexpr float kMaxScalar = 1.127f;
+
+    /// @brief OTOS register map
+    static constexpr uint8_t kRegProductId = 0x00;
+    static constexpr uint8_t kRegHwVersion = 0x01;
+    static constexpr uint8_t kRegFwVersion = 0x02;
+    static constexpr uint8_t kRegScalarLinear = 0x04;
+    static constexpr uint8_t kRegScalarAngular = 0x05;
+    static constexpr uint8_t kRegImuCalib = 0x06;
+    static constexpr uint8_t kRegReset = 0x07;
+    static constexpr uint8_t kRegSignalProcess = 0x0E;
+    static constexpr uint8_t kRegSelfTest = 0x0F;
+    static constexpr uint8_t kRegOffXL = 0x10;
+    static constexpr uint8_t kRegOffXH = 0x11;
+    static constexpr uint8_t kRegOffYL = 0x12;
+    static constexpr uint8_t kRegOffYH = 0x13;
+    static constexpr uint8_t kRegOffHL = 0x14;
+    static constexpr uint8_t kRegOffHH = 0x15;
+    static constexpr uint8_t kRegStatus = 0x1F;
+    static constexpr uint8_t kRegPosXL = 0x20;
+    static constexpr uint8_t kRegPosXH = 0x21;
+    static constexpr uint8_t kRegPosYL = 0x22;
+    static constexpr uint8_t kRegPosYH = 0x23;
+    static constexpr uint8_t kRegPosHL = 0x24;
+    static constexpr uint8_t kRegPosHH = 0x25;
+    static constexpr uint8_t kRegVelXL = 0x26;
+    static constexpr uint8_t kRegVelXH = 0x27;
+    static constexpr uint8_t kRegVelYL = 0x28;
+    static constexpr uint8_t kRegVelYH = 0x29;
+    static constexpr uint8_t kRegVelHL = 0x2A;
+    static constexpr uint8_t kRegVelHH = 0x2B;
+    static constexpr uint8_t kRegAccXL = 0x2C;
+    static constexpr uint8_t kRegAccXH = 0x2D;
+    static constexpr uint8_t kRegAccYL = 0x2E;
+    static constexpr uint8_t kRegAccYH = 0x2F;
+    static constexpr uint8_t kRegAccHL = 0x30;
+    static constexpr uint8_t kRegAccHH = 0x31;
+    static constexpr uint8_t kRegPosStdXL = 0x32;
+    static constexpr uint8_t kRegPosStdXH = 0x33;
+    static constexpr uint8_t kRegPosStdYL = 0x34;
+    static constexpr uint8_t kRegPosStdYH = 0x35;
+    static constexpr uint8_t kRegPosStdHL = 0x36;
+    static constexpr uint8_t kRegPosStdHH = 0x37;
+    static constexpr uint8_t kRegVelStdXL = 0x38;
+    static constexpr uint8_t kRegVelStdXH = 0x39;
+    static constexpr uint8_t kRegVelStdYL = 0x3A;
+    static constexpr uint8_t kRegVelStdYH = 0x3B;
+    static constexpr uint8_t kRegVelStdHL = 0x3C;
+    static constexpr uint8_t kRegVelStdHH = 0x3D;
+    static constexpr uint8_t kRegAccStdXL = 0x3E;
+    static constexpr uint8_t kRegAccStdXH = 0x3F;
+    static constexpr uint8_t kRegAccStdYL = 0x40;
+    static constexpr uint8_t kRegAccStdYH = 0x41;
+    static constexpr uint8_t kRegAccStdHL = 0x42;
+    static constexpr uint8_t kRegAccStdHH = 0x43;
+
+    /// @brief Product ID register value
+    static constexpr uint8_t kProductId = 0x5F;
+
+    /// @brief Conversion factors
+    static constexpr float kMeterToInch = 39.37f;
+    static constexpr float kInchToMeter = 1.0f / kMeterToInch;
+    static constexpr float kRadianToDegree = 180.0f / M_PI;
+    static constexpr float kDegreeToRadian = M_PI / 180.0f;
+
+    /// @brief Conversion factor for the linear position registers. 16-bit
+    /// signed registers with a max value of 10 meters (394 inches) gives a
+    /// resolution of about 0.0003 mps (0.012 ips)
+    static constexpr float kMeterToInt16 = 32768.0f / 10.0f;
+    static constexpr float kInt16ToMeter = 1.0f / kMeterToInt16;
+
+    /// @brief Conversion factor for the linear velocity registers. 16-bit
+    /// signed registers with a max value of 5 mps (197 ips) gives a resolution
+    /// of about 0.00015 mps (0.006 ips)
+    static constexpr float kMpsToInt16 = 32768.0f / 5.0f;
+    static constexpr float kInt16ToMps = 1.0f / kMpsToInt16;
+
+    /// @brief Conversion factor for the linear acceleration registers. 16-bit
+    /// signed registers with a max value of 157 mps^2 (16 g) gives a resolution
+    /// of about 0.0048 mps^2 (0.49 mg)
+    static constexpr float kMpssToInt16 = 32768.0f / (16.0f * 9.80665f);
+    static constexpr float kInt16ToMpss = 1.0f / kMpssToInt16;
+
+    /// @brief Conversion factor for the angular position registers. 16-bit
+    /// signed registers with a max value of pi radians (180 degrees) gives a
+    /// resolution of about 0.00096 radians (0.0055 degrees)
+    static constexpr float kRadToInt16 = 32768.0f / M_PI;
+    static constexpr float kInt16ToRad = 1.0f / kRadToInt16;
+
+    /// @brief Conversion factor for the angular velocity registers. 16-bit
+    /// signed registers with a max value of 34.9 rps (2000 dps) gives a
+    /// resolution of about 0.0011 rps (0.061 degrees per second)
+    static constexpr float kRpsToInt16 = 32768.0f / (2000.0f * kDegreeToRadian);
+    static constexpr float kInt16ToRps = 1.0f / kRpsToInt16;
+
+    /// @brief Conversion factor for the angular acceleration registers. 16-bit
+    /// signed registers with a max value of 3141 rps^2 (180000 dps^2) gives a
+    /// resolution of about 0.096 rps^2 (5.5 dps^2)
+    static constexpr float kRpssToInt16 = 32768.0f / (M_PI * 1000.0f);
+    static constexpr float kInt16ToRpss = 1.0f / kRpssToInt16;
+
+    /// @brief Fixed-point scale factors from each register group to Q16.16
+    /// meters and radians, used by the raw integer fast path
+    static constexpr sfe_otos_q_scale_t kQScaleMeter = sfeOtosQScale(kInt16ToMeter);
+    static constexpr sfe_otos_q_scale_t kQScaleMps = sfeOtosQScale(kInt16ToMps);
+    static constexpr sfe_otos_q_scale_t kQScaleMpss = sfeOtosQScale(kInt16ToMpss);
+    static constexpr sfe_otos_q_scale_t kQScaleRad = sfeOtosQScale(kInt16ToRad);
+    static constexpr sfe_otos_q_scale_t kQScaleRps = sfeOtosQScale(kInt16ToRps);
+    static constexpr sfe_otos_q_scale_t kQScaleRpss = sfeOtosQScale(kInt16ToRpss);
+
+  protected:
+    // The unit policies build their conversion factors per register group
+    friend class sfeOtosRuntimeUnits;
+    template <sfe_otos_linear_unit_t LinearUnit, sfe_otos_angular_unit_t AngularUnit> friend class sfeOtosFixedUnits;
+
+    // Virtual function that must be implemented by the derived class to delay
+    // for a given number of milliseconds
+    virtual void delayMs(uint32_t ms) = 0;
+
+    // Register groups sharing the same conversion factors. The offset and the
+    // standard deviations use the factors of the quantity they describe
+    enum
+    {
+        kGroupPos = 0,
+        kGroupVel,
+        kGroupAcc,
+        kNumGroups
+    };
+
+    // Functions to read and write a block of registers, failing unless every
+    // byte is transferred. The data paths are templates on the bus type so a
+    // final transport is called directly, see sfeQwiicOtosPose
+    template <class Bus> int readRegs(Bus &bus, uint8_t reg, uint8_t *data, size_t numBytes);
+    template <class Bus> int writeRegs(Bus &bus, uint8_t reg, const uint8_t *data, size_t numBytes);
+
+    // Functions to start a background burst read into _asyncData, and to check
+    // whether it has finished
+    template <class Bus> int startAsyncRead(Bus &bus, uint8_t reg, size_t numBytes);
+    template <class Bus> int pollAsyncRead(Bus &bus);
+
+    // Burst reads covering a set of register groups, see planGroupRead()
+    typedef struct
+    {
+        uint8_t reg[2];
+        uint8_t length[2];
+        uint8_t numBursts;
+    } sfe_otos_group_plan_t;
+
+    // Function to find the cheapest way to read a set of register groups. The
+    // groups are read as one contiguous burst, or as two bursts when skipping
+    // the unrequested groups between them costs less than a new transaction
+    static void planGroupRead(uint8_t groups, sfe_otos_group_plan_t &plan);
+
+    // Function to perform the bursts of a plan, storing each group at its
+    // offset from kRegPosXL in rawData
+    template <class Bus> int readGroupPlan(Bus &bus, const sfe_otos_group_plan_t &plan, uint8_t *rawData);
+
+    // Function to convert a linear or angular scalar to its register value,
+    // multiples of 0.1%
+    static int scalarToRaw(float scalar, uint8_t &rawScalar);
+
+    // Registers covered by a configuration image, up to the position
+    static constexpr uint8_t kConfigImageSize = 0x26;
+
+    // Function to write the registers flagged in mask from an image indexed by
+    // register address, merging adjacent registers into a single burst
+    int writeRegImage(const uint8_t *image, uint64_t mask);
+
+    // Background operations driven by the step functions. Only one runs at a
+    // time, starting one abandons the other
+    enum
+    {
+        kOpNone = 0,
+        kOpImuCalibration,
+        kOpSelfTest
+    };
+
+    // As of firmware v1.0, IMU calibration samples take 2.4ms each, and the
+    // self test takes about 20ms
+    static constexpr uint32_t kImuSampleUs = 2400;
+    static constexpr uint32_t kSelfTestStepUs = 5000;
+    static constexpr uint8_t kSelfTestMaxSteps = 10;
+
+    // Steps allowed after the first calibration step. Each step sleeps through
+    // the samples left, so a healthy calibration finishes in two or three
+    static constexpr uint8_t kImuCalibrationMaxSteps = 16;
+
+    // Function to track a calibration whose register was already written
+    void beginImuCalibration(uint32_t &nextStepUs);
+
+    // Function to run the calibration state machine to the end with delayMs()
+    int waitForImuCalibration(uint32_t nextStepUs);
+
+    // Function to read back the configuration registers in a single burst and
+    // check them against an image
+    int verifyRegImage(const uint8_t *image, uint64_t mask);
+
+    // Function to unpack little-endian raw registers into signed values
+    static void regsToRaw(const uint8_t *rawData, int16_t *raw, size_t count);
+
+    // Function to get the register group, with its conversion factors, of a
+    // sfe_otos_group_t value
+    static int groupIndex(sfe_otos_group_t group)
+    {
+        return (group & (kSfeOtosGroupVel | kSfeOtosGroupVelStdDev))   ? kGroupVel
+               : (group & (kSfeOtosGroupAcc | kSfeOtosGroupAccStdDev)) ? kGroupAcc
+                                                                       : kGroupPos;
+    }
+
+    // Function to convert raw pose registers to a fixed-point pose structure
+    static void regsToPoseQ(const uint8_t *rawData, sfe_otos_pose2d_q_t &pose, sfe_otos_q_scale_t rawToXY,
+                            sfe_otos_q_scale_t rawToH);
+
+    // Function to convert the position registers to fixed point, continuous
+    // if enabled
+    void positionRegsToPoseQ(const uint8_t *rawData, sfe_otos_pose2d_q_t &pose);
+
+    // Bus used for every transfer
+    sfeOtosTransport *_bus;
+
+    // Destination of the background burst reads, sized for the full
+    // pos/vel/acc and standard deviation block. It must not be touched while a
+    // transfer is in progress. Each read has its own length, which identifies
+    // it when polled
+    uint8_t _asyncData[36];
+    size_t _asyncLength;
+
+    // Background operation being stepped, and the steps it has left
+    uint8_t _operation;
+    uint8_t _operationSteps;
+
+    // Function to unwrap the position registers, flag a rebase if due, and
+    // get the continuous position counts
+    void unwrapPosition(const uint8_t *rawData, int32_t counts[3]);
+
+    // Function to write the position registers back to the origin
+    int rebasePosition();
+
+    // Function to rebase after a blocking position read, if one is due
+    void rebaseIfDue();
+
+    // Function to start the continuous counts over from the next read, after
+    // the position registers were written or reset
+    void resyncContinuous();
+
+    // Unwrapped registers in counts. The low 16 bits always equal the
+    // registers of the last read, so the wrapped difference to a new read is
+    // the motion in between. The continuous position adds the origin, the sum
+    // of the shifts written by the rebases
+    bool _continuous;
+    bool _continuousSeeded;
+    int32_t _continuousRaw[3];
+    int32_t _continuousOrigin[2];
+
+    bool _autoRebase;
+    int16_t _rebaseThreshold;
+    bool _rebaseDue;
+    uint32_t _numRebases;
+};
+
+/// @brief Unit policy letting the linear and angular units be changed at run
+/// time. The conversion factors are rebuilt whenever a unit changes
+class sfeOtosRuntimeUnits
+{
+  public:
+    /// @brief Default constructor, selects inches and degrees
+    sfeOtosRuntimeUnits();
+
+    /// @brief Gets the linear unit used by all methods using a pose
+    /// @return Linear unit
+    sfe_otos_linear_unit_t getLinearUnit();
+
+    /// @brief Sets the linear unit used by all methods using a pose
+    /// @param unit Linear unit
+    void setLinearUnit(sfe_otos_linear_unit_t unit);
+
+    /// @brief Gets the angular unit used by all methods using a pose
+    /// @return Angular unit
+    sfe_otos_angular_unit_t getAngularUnit();
+
+    /// @brief Sets the angular unit used by all methods using a pose
+    /// @param unit Angular unit
+    void setAngularUnit(sfe_otos_angular_unit_t unit);
+
+  protected:
+    // Function to get the conversion factors of a register group
+    const sfe_otos_conversion_t &conversion(int group) const
+    {
+        return _conversion[group];
+    }
+
+    // Function to rebuild the conversion factors after a unit change
+    void updateConversionFactors();
+
+    // Units to be used by the public pose functions. Everything uses meters and
+    // radians internally, so this just determines what conversion factor is
+    // applied to the public functions
+    sfe_otos_linear_unit_t _linearUnit;
+    sfe_otos_angular_unit_t _angularUnit;
+
+    // Conversion factors from the raw registers of each group to the current
+    // linear and angular units, rebuilt whenever a unit changes so the hot
+    // paths never divide
+    sfe_otos_conversion_t _conversion[sfeQwiicOtosBase::kNumGroups];
+};
+
+/// @brief Unit policy fixing the linear and angular units at compile time. The
+/// conversion factors are constant expressions, so every conversion folds into
+/// a single multiply by an immediate, and the policy adds no members
+/// @tparam LinearUnit Linear unit used by all methods using a pose
+/// @tparam AngularUnit Angular unit used by all methods using a pose
+template <sfe_otos_linear_unit_t LinearUnit, sfe_otos_angular_unit_t AngularUnit>
+class sfeOtosFixedUnits
+{
+  public:
+    /// @brief Gets the linear unit used by all methods using a pose
+    /// @return Linear unit
+    static constexpr sfe_otos_linear_unit_t getLinearUnit()
+    {
+        return LinearUnit;
+    }
+
+    /// @brief Gets the angular unit used by all methods using a pose
+    /// @return Angular unit
+    static constexpr sfe_otos_angular_unit_t getAngularUnit()
+    {
+        return AngularUnit;
+    }
+
+  protected:
+    static constexpr float kMeterToUnit =
+        (LinearUnit == kSfeOtosLinearUnitMeters) ? 1.0f : sfeQwiicOtosBase::kMeterToInch;
+    static constexpr float kRadToUnit =
+        (AngularUnit == kSfeOtosAngularUnitRadians) ? 1.0f : sfeQwiicOtosBase::kRadianToDegree;
+
+    // Function to get the conversion factors of a register group
+    static constexpr sfe_otos_conversion_t conversion(int group)
+    {
+        return (group == sfeQwiicOtosBase::kGroupPos)
+                   ? sfe_otos_conversion_t{sfeQwiicOtosBase::kInt16ToMeter * kMeterToUnit,
+                                           sfeQwiicOtosBase::kInt16ToRad * kRadToUnit,
+                                           sfeQwiicOtosBase::kMeterToInt16 / kMeterToUnit,
+                                           sfeQwiicOtosBase::kRadToInt16 / kRadToUnit}
+               : (group == sfeQwiicOtosBase::kGroupVel)
+                   ? sfe_otos_conversion_t{sfeQwiicOtosBase::kInt16ToMps * kMeterToUnit,
+                                           sfeQwiicOtosBase::kInt16ToRps * kRadToUnit,
+                                           sfeQwiicOtosBase::kMpsToInt16 / kMeterToUnit,
+                                           sfeQwiicOtosBase::kRpsToInt16 / kRadToUnit}
+                   : sfe_otos_conversion_t{sfeQwiicOtosBase::kInt16ToMpss * kMeterToUnit,
+                                           sfeQwiicOtosBase::kInt16ToRpss * kRadToUnit,
+                                           sfeQwiicOtosBase::kMpssToInt16 / kMeterToUnit,
+                                           sfeQwiicOtosBase::kRpssToInt16 / kRadToUnit};
+    }
+};
+
+/// @brief OTOS driver methods reading the pose registers, converted to the
+/// units given by a unit policy. Use sfeQwiicOtos for units selectable at run
+/// time, or sfeQwiicOtosT for units fixed at compile time
+/// @tparam Units Unit policy, sfeOtosRuntimeUnits or sfeOtosFixedUnits
+/// @tparam Bus Transport type of the pose reads. sfeOtosTransport accepts any
+/// bus; a final transport class such as OtosI2C removes the virtual dispatch
+/// from every pose read
+template <class Units, class Bus = sfeOtosTransport>
+class sfeQwiicOtosPose : public sfeQwiicOtosBase, public Units
+{
+  public:
+    /// @brief Sets the bus used to communicate with the OTOS, which must
+    /// outlive the driver
+    /// @param bus Transport connected to the OTOS
+    void setBus(Bus &bus)
+    {
+        sfeQwiicOtosBase::setBus(bus);
+    }
+
+    /// @brief Gets the bus used to communicate with the OTOS
+    /// @return Transport connected to the OTOS
+    Bus &getBus()
+    {
+        return transport();
+    }
+
+    /// @brief Gets the raw position, velocity, and acceleration registers in a
+    /// single burst read, without any unit conversion
+    /// @param raw Register values, ordered position x, y, h, then velocity x,
+    /// y, h, then acceleration x, y, h
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int getPosVelAccRaw(int16_t raw[9]);
+
+    /// @brief Converts a batch of raw pose frames, eg. from a log, a sampler
+    /// or several sensors, into separate x, y, and h arrays in one pass. The
+    /// factors are loaded once and every array is written sequentially, which
+    /// suits filtering and compression better than an array of poses. Each
+    /// value is the same as from the single pose reads
+    /// @param frames Raw registers of the first frame, x, y, then h,
+    /// little-endian as read from the OTOS
+    /// @param numFrames Number of frames
+    /// @param xs X values
+    /// @param ys Y values
+    /// @param hs Heading values
+    /// @param group Register group held by the frames, a single
+    /// sfe_otos_group_t value
+    /// @param stride Bytes from one frame to the next, at least 6, eg. 18 to
+    /// take one group out of consecutive position, velocity, and acceleration
+    /// blocks
+    /// @note Continuous tracking is not applied, positions are the wrapped
+    /// registers
+    void decodeFrames(const uint8_t *frames, size_t numFrames, float *xs, float *ys, float *hs,
+                      sfe_otos_group_t group = kSfeOtosGroupPos, size_t stride = 6);
+
+    /// @brief Gets the position measured by the OTOS in fixed point, without
+    /// any floating point math
+    /// @param pos Position in meters and radians, Q16.16
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int getPositionQ(sfe_otos_pose2d_q_t &pos);
+
+    /// @brief Gets the position, velocity, and acceleration measured by the
+    /// OTOS in fixed point in a single burst read, without any floating point
+    /// math
+    /// @param pos Position in meters and radians, Q16.16
+    /// @param vel Velocity in meters and radians per second, Q16.16
+    /// @param acc Acceleration in meters and radians per second squared, Q16.16
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int getPosVelAccQ(sfe_otos_pose2d_q_t &pos, sfe_otos_pose2d_q_t &vel, sfe_otos_pose2d_q_t &acc);
+
+    /// @brief Starts a non-blocking burst read of the position, velocity, and
+    /// acceleration. The transfer runs in the background, use
+    /// pollPosVelAccAsync() to get the results
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int startPosVelAccAsync();
+
+    /// @brief Starts a non-blocking burst read of the position, velocity,
+    /// acceleration, and standard deviation of each. The transfer runs in the
+    /// background, use pollPosVelAccAndStdDevAsync() to get the results
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int startPosVelAccAndStdDevAsync();
+
+    /// @brief Starts a non-blocking burst read of the status register together
+    /// with the position, velocity, and acceleration, see
+    /// kSfeOtosStatusFused. Use pollPosVelAccCheckedAsync() to get the results
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int startPosVelAccCheckedAsync();
+
+    /// @brief Applies a complete start-up configuration with the fewest
+    /// transfers. Adjacent registers are written in a single burst, then the
+    /// configuration registers are verified with a single read. When the IMU
+    /// is calibrated and waitForCalibration is set, the tracking reset and the
+    /// position are written once the calibration is done, so the pose does not
+    /// start out with the drift accumulated during it
+    /// @param config Configuration to apply
+    /// @param waitForCalibration Whether to wait for the IMU calibration. If
+    /// not, it continues in the background, see getImuCalibrationProgress()
+    /// @return 0 for succuss, negative for errors, positive for warnings. Fails
+    /// without writing anything if a scalar is out of bounds, and if the
+    /// readback does not match
+    int applyConfig(const sfe_otos_config_t &config, bool waitForCalibration = true);
+
     /// @brief Gets the offset of the OTOS
     /// @param pose Offset of the sensor relative to the center of the robot
     /// @return 0 for succuss, negative for errors, positive for warnings
@@ -320,6 +1225,19 @@ class sfeQwiicOtos
     /// @return 0 for succuss, negative for errors, positive for warnings
     int getPosVelAcc(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc);
 
+    /// @brief Gets the position, velocity, and acceleration measured by the
+    /// OTOS, gated by the status register. The poses are converted only when
+    /// the sample is valid, and left untouched otherwise
+    /// @param pos Position measured by the OTOS
+    /// @param vel Velocity measured by the OTOS
+    /// @param acc Acceleration measured by the OTOS
+    /// @param validity Validity of the sample, from the status register
+    /// @param mode Whether the status is read with the pose or before it
+    /// @return 0 for succuss, negative for errors, positive for warnings. An
+    /// invalid sample is not an error
+    int getPosVelAccChecked(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc,
+                            sfe_otos_validity_t &validity, sfe_otos_status_read_t mode = kSfeOtosStatusFused);
+
     /// @brief Gets the standard deviation of the measured position, velocity,
     /// and acceleration in a single burst read
     /// @param pos Standard deviation of the position measured by the OTOS
@@ -340,142 +1258,756 @@ class sfeQwiicOtos
     int getPosVelAccAndStdDev(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc,
                         sfe_otos_pose2d_t &posStdDev, sfe_otos_pose2d_t &velStdDev, sfe_otos_pose2d_t &accStdDev);
 
-    /// @brief Default I2C addresses of the Qwiic OTOS
-    static constexpr uint8_t kDefaultAddress = 0x17;
+    /// @brief Checks whether the read started by startPosVelAccAsync() has
+    /// finished, and if so converts the results. The poses are left untouched
+    /// while the transfer is still in progress
+    /// @param pos Position measured by the OTOS
+    /// @param vel Velocity measured by the OTOS
+    /// @param acc Acceleration measured by the OTOS
+    /// @return 0 once the read is complete, kSTkErrBusBusy while it is still in
+    /// progress, negative for errors
+    int pollPosVelAccAsync(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc);
 
-    /// @brief Minimum scalar value for the linear and angular scalars
-    static constexpr float kMinScalar = 0.872f;
+    /// @brief Checks whether the read started by startPosVelAccAndStdDevAsync()
+    /// has finished, and if so converts the results. The poses are left
+    /// untouched while the transfer is still in progress
+    /// @param pos Position measured by the OTOS
+    /// @param vel Velocity measured by the OTOS
+    /// @param acc Acceleration measured by the OTOS
+    /// @param posStdDev Standard deviation of the position measured by the OTOS
+    /// @param velStdDev Standard deviation of the velocity measured by the OTOS
+    /// @param accStdDev Standard deviation of the acceleration measured by the OTOS
+    /// @return 0 once the read is complete, kSTkErrBusBusy while it is still in
+    /// progress, negative for errors
+    int pollPosVelAccAndStdDevAsync(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc,
+                        sfe_otos_pose2d_t &posStdDev, sfe_otos_pose2d_t &velStdDev, sfe_otos_pose2d_t &accStdDev);
 
-    /// @brief Maximum scalar value for the linear and angular scalars
-    static constexpr float kMaxScalar = 1.127f;
+    /// @brief Checks whether the read started by startPosVelAccCheckedAsync()
+    /// has finished, and if so converts the results when the sample is valid.
+    /// The poses are left untouched while the transfer is still in progress or
+    /// when the sample is invalid
+    /// @param pos Position measured by the OTOS
+    /// @param vel Velocity measured by the OTOS
+    /// @param acc Acceleration measured by the OTOS
+    /// @param validity Validity of the sample, from the status register
+    /// @return 0 once the read is complete, kSTkErrBusBusy while it is still in
+    /// progress, negative for errors
+    int pollPosVelAccCheckedAsync(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc,
+                                  sfe_otos_validity_t &validity);
+
+    /// @brief Reads any combination of the position, velocity, acceleration,
+    /// and standard deviation of each, using the fewest bytes on the bus. The
+    /// requested groups are read in a single burst, or in two bursts when that
+    /// transfers less data, and only the requested groups are converted
+    /// @param groups Bitmask of sfe_otos_group_t values to read
+    /// @param out Destination of the requested groups
+    /// @return 0 for succuss, negative for errors, positive for warnings
+    int read(uint8_t groups, sfe_otos_pose_groups_t &out);
 
   protected:
-    // Virtual function that must be implemented by the derived class to delay
-    // for a given number of milliseconds
-    virtual void delayMs(uint32_t ms) = 0;
+    // Function to get the bus as the policy type. setBus() only accepts a Bus,
+    // so the cast always holds
+    Bus &transport()
+    {
+        return static_cast<Bus &>(*_bus);
+    }
 
-    // Function to read raw pose registers and convert to specified units
-    int readPoseRegs(uint8_t reg, sfe_otos_pose2d_t &pose, float rawToXY, float rawToH);
+    // Function to read raw pose registers and convert to the policy units
+    int readPoseRegs(uint8_t reg, sfe_otos_pose2d_t &pose, int group);
 
-    // Function to write raw pose registers and convert from specified units
-    int writePoseRegs(uint8_t reg, sfe_otos_pose2d_t &pose, float xyToRaw, float hToRaw);
+    // Function to write raw pose registers and convert from the policy units
+    int writePoseRegs(uint8_t reg, sfe_otos_pose2d_t &pose, int group);
 
     // Function to convert raw pose registers to a pose structure
-    void regsToPose(uint8_t *rawData, sfe_otos_pose2d_t &pose, float rawToXY, float rawToH);
+    void regsToPose(const uint8_t *rawData, sfe_otos_pose2d_t &pose, const sfe_otos_conversion_t &conversion);
+
+    // Function to convert the position registers, continuous if enabled
+    void positionRegsToPose(const uint8_t *rawData, sfe_otos_pose2d_t &pos);
 
     // Function to convert a pose structure to raw pose registers
-    void poseToRegs(uint8_t *rawData, sfe_otos_pose2d_t &pose, float xyToRaw, float hToRaw);
+    void poseToRegs(uint8_t *rawData, const sfe_otos_pose2d_t &pose, const sfe_otos_conversion_t &conversion);
+};
 
-    // Units to be used by the public pose functions. Everything uses meters and
-    // radians internally, so this just determines what conversion factor is
-    // applied to the public functions
-    sfe_otos_linear_unit_t _linearUnit;
-    sfe_otos_angular_unit_t _angularUnit;
+/// @brief Class for the SparkFun Qwiic Optical Tracking Odometry Sensor (OTOS).
+/// Includes methods to communicate with the sensor, such as getting the tracked
+/// location, configuring the sensor, etc. The linear and angular units can be
+/// changed at run time. This class is a base class that must be derived to
+/// implement the delay function and I2C communication bus.
+class sfeQwiicOtos : public sfeQwiicOtosPose<sfeOtosRuntimeUnits>
+{
+};
 
-    // Conversion factors from meters and radians to the current linear and
-    // angular units
-    float _meterToUnit;
-    float _radToUnit;
+/// @brief OTOS driver with the linear and angular units fixed at compile time.
+/// Behaves like sfeQwiicOtos, but every unit conversion is a constant
+/// expression and the unit members are not stored in the object
+/// @tparam LinearUnit Linear unit used by all methods using a pose
+/// @tparam AngularUnit Angular unit used by all methods using a pose
+/// @tparam Bus Transport type of the pose reads, see sfeQwiicOtosPose
+template <sfe_otos_linear_unit_t LinearUnit, sfe_otos_angular_unit_t AngularUnit, class Bus = sfeOtosTransport>
+using sfeQwiicOtosT = sfeQwiicOtosPose<sfeOtosFixedUnits<LinearUnit, AngularUnit>, Bus>;
+
+// Template member definitions. The run-time unit variant is instantiated once
+// in sfeQwiicOtos.cpp; fixed-unit variants are instantiated where they are used
+// so their constant conversion factors fold into the calling code
+
+template <class Bus>
+int sfeQwiicOtosBase::readRegs(Bus &bus, uint8_t reg, uint8_t *data, size_t numBytes)
+{
+    size_t bytesRead;
 
-    // OTOS register map
-    static constexpr uint8_t kRegProductId = 0x00;
-    static constexpr uint8_t kRegHwVersion = 0x01;
-    static constexpr uint8_t kRegFwVersion = 0x02;
-    static constexpr uint8_t kRegScalarLinear = 0x04;
-    static constexpr uint8_t kRegScalarAngular = 0x05;
-    static constexpr uint8_t kRegImuCalib = 0x06;
-    static constexpr uint8_t kRegReset = 0x07;
-    static constexpr uint8_t kRegSignalProcess = 0x0E;
-    static constexpr uint8_t kRegSelfTest = 0x0F;
-    static constexpr uint8_t kRegOffXL = 0x10;
-    static constexpr uint8_t kRegOffXH = 0x11;
-    static constexpr uint8_t kRegOffYL = 0x12;
-    static constexpr uint8_t kRegOffYH = 0x13;
-    static constexpr uint8_t kRegOffHL = 0x14;
-    static constexpr uint8_t kRegOffHH = 0x15;
-    static constexpr uint8_t kRegStatus = 0x1F;
-    static constexpr uint8_t kRegPosXL = 0x20;
-    static constexpr uint8_t kRegPosXH = 0x21;
-    static constexpr uint8_t kRegPosYL = 0x22;
-    static constexpr uint8_t kRegPosYH = 0x23;
-    static constexpr uint8_t kRegPosHL = 0x24;
-    static constexpr uint8_t kRegPosHH = 0x25;
-    static constexpr uint8_t kRegVelXL = 0x26;
-    static constexpr uint8_t kRegVelXH = 0x27;
-    static constexpr uint8_t kRegVelYL = 0x28;
-    static constexpr uint8_t kRegVelYH = 0x29;
-    static constexpr uint8_t kRegVelHL = 0x2A;
-    static constexpr uint8_t kRegVelHH = 0x2B;
-    static constexpr uint8_t kRegAccXL = 0x2C;
-    static constexpr uint8_t kRegAccXH = 0x2D;
-    static constexpr uint8_t kRegAccYL = 0x2E;
-    static constexpr uint8_t kRegAccYH = 0x2F;
-    static constexpr uint8_t kRegAccHL = 0x30;
-    static constexpr uint8_t kRegAccHH = 0x31;
-    static constexpr uint8_t kRegPosStdXL = 0x32;
-    static constexpr uint8_t kRegPosStdXH = 0x33;
-    static constexpr uint8_t kRegPosStdYL = 0x34;
-    static constexpr uint8_t kRegPosStdYH = 0x35;
-    static constexpr uint8_t kRegPosStdHL = 0x36;
-    static constexpr uint8_t kRegPosStdHH = 0x37;
-    static constexpr uint8_t kRegVelStdXL = 0x38;
-    static constexpr uint8_t kRegVelStdXH = 0x39;
-    static constexpr uint8_t kRegVelStdYL = 0x3A;
-    static constexpr uint8_t kRegVelStdYH = 0x3B;
-    static constexpr uint8_t kRegVelStdHL = 0x3C;
-    static constexpr uint8_t kRegVelStdHH = 0x3D;
-    static constexpr uint8_t kRegAccStdXL = 0x3E;
-    static constexpr uint8_t kRegAccStdXH = 0x3F;
-    static constexpr uint8_t kRegAccStdYL = 0x40;
-    static constexpr uint8_t kRegAccStdYH = 0x41;
-    static constexpr uint8_t kRegAccStdHL = 0x42;
-    static constexpr uint8_t kRegAccStdHH = 0x43;
+    // Attempt to read the registers
+    int err = bus.readRegisterRegion(reg, data, numBytes, bytesRead);
+    if(err != kSTkErrOk)
+        return err;
 
-    // Product ID register value
-    static constexpr uint8_t kProductId = 0x5F;
+    // Check if we read the correct number of bytes
+    if(bytesRead != numBytes)
+        return kSTkErrFail;
 
-    // Conversion factors
-    static constexpr float kMeterToInch = 39.37f;
-    static constexpr float kInchToMeter = 1.0f / kMeterToInch;
-    static constexpr float kRadianToDegree = 180.0f / M_PI;
-    static constexpr float kDegreeToRadian = M_PI / 180.0f;
+    // Done!
+    return kSTkErrOk;
+}
 
-    // Conversion factor for the linear position registers. 16-bit signed
-    // registers with a max value of 10 meters (394 inches) gives a resolution
-    // of about 0.0003 mps (0.012 ips)
-    static constexpr float kMeterToInt16 = 32768.0f / 10.0f;
-    static constexpr float kInt16ToMeter = 1.0f / kMeterToInt16;
+template <class Bus>
+int sfeQwiicOtosBase::writeRegs(Bus &bus, uint8_t reg, const uint8_t *data, size_t numBytes)
+{
+    return bus.writeRegisterRegion(reg, data, numBytes);
+}
 
-    // Conversion factor for the linear velocity registers. 16-bit signed
-    // registers with a max value of 5 mps (197 ips) gives a resolution of about
-    // 0.00015 mps (0.006 ips)
-    static constexpr float kMpsToInt16 = 32768.0f / 5.0f;
-    static constexpr float kInt16ToMps = 1.0f / kMpsToInt16;
+template <class Bus>
+int sfeQwiicOtosBase::readGroupPlan(Bus &bus, const sfe_otos_group_plan_t &plan, uint8_t *rawData)
+{
+    for(uint8_t i = 0; i < plan.numBursts; i++)
+    {
+        int err = readRegs(bus, plan.reg[i], rawData + (plan.reg[i] - kRegPosXL), plan.length[i]);
+        if(err != kSTkErrOk)
+            return err;
+    }
 
-    // Conversion factor for the linear acceleration registers. 16-bit signed
-    // registers with a max value of 157 mps^2 (16 g) gives a resolution of
-    // about 0.0048 mps^2 (0.49 mg)
-    static constexpr float kMpssToInt16 = 32768.0f / (16.0f * 9.80665f);
-    static constexpr float kInt16ToMpss = 1.0f / kMpssToInt16;
+    // Done!
+    return kSTkErrOk;
+}
 
-    // Conversion factor for the angular position registers. 16-bit signed
-    // registers with a max value of pi radians (180 degrees) gives a resolution
-    // of about 0.00096 radians (0.0055 degrees)
-    static constexpr float kRadToInt16 = 32768.0f / M_PI;
-    static constexpr float kInt16ToRad = 1.0f / kRadToInt16;
+template <class Bus>
+int sfeQwiicOtosBase::startAsyncRead(Bus &bus, uint8_t reg, size_t numBytes)
+{
+    // Check if the read fits in the buffer
+    if(numBytes > sizeof(_asyncData))
+        return kSTkErrFail;
 
-    // Conversion factor for the angular velocity registers. 16-bit signed
-    // registers with a max value of 34.9 rps (2000 dps) gives a resolution of
-    // about 0.0011 rps (0.061 degrees per second)
-    static constexpr float kRpsToInt16 = 32768.0f / (2000.0f * kDegreeToRadian);
-    static constexpr float kInt16ToRps = 1.0f / kRpsToInt16;
+    // Start the transfer in the background
+    int err = bus.startReadRegisterRegionDma(reg, _asyncData, numBytes);
+    if(err != kSTkErrOk)
+        return err;
 
-    // Conversion factor for the angular acceleration registers. 16-bit signed
-    // registers with a max value of 3141 rps^2 (180000 dps^2) gives a
-    // resolution of about 0.096 rps^2 (5.5 dps^2)
-    static constexpr float kRpssToInt16 = 32768.0f / (M_PI * 1000.0f);
-    static constexpr float kInt16ToRpss = 1.0f / kRpssToInt16;
+    // Remember how much data to expect
+    _asyncLength = numBytes;
 
-    static constexpr int kSTkErrOk = 0;
-    static constexpr int kSTkErrFail = -1;
-};
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Bus>
+int sfeQwiicOtosBase::pollAsyncRead(Bus &bus)
+{
+    // Check if a read was started
+    if(_asyncLength == 0)
+        return kSTkErrFail;
+
+    // Check if the transfer has finished
+    size_t bytesRead;
+    int err = bus.pollReadRegisterRegionDma(bytesRead);
+    if(err == kSTkErrBusBusy)
+        return err;
+
+    // The transfer is over one way or another, so the buffer is free again
+    size_t expected = _asyncLength;
+    _asyncLength = 0;
+
+    if(err != kSTkErrOk)
+        return err;
+
+    // Check if we read the correct number of bytes
+    if(bytesRead != expected)
+        return kSTkErrFail;
+
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::getPosVelAccRaw(int16_t raw[9])
+{
+    // Read all pose registers
+    uint8_t rawData[18];
+    int err = readRegs(transport(), kRegPosXL, rawData, 18);
+    if(err != kSTkErrOk)
+        return err;
+
+    // Unpack without any conversion. Continuous tracking still has to see
+    // every read to follow the wraps
+    regsToRaw(rawData, raw, 9);
+    if(_continuous)
+    {
+        int32_t counts[3];
+        unwrapPosition(rawData, counts);
+        rebaseIfDue();
+    }
+
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::getPositionQ(sfe_otos_pose2d_q_t &pos)
+{
+    // Read the position registers
+    uint8_t rawData[6];
+    int err = readRegs(transport(), kRegPosXL, rawData, 6);
+    if(err != kSTkErrOk)
+        return err;
+
+    // Convert raw data to fixed point
+    positionRegsToPoseQ(rawData, pos);
+    rebaseIfDue();
+
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::getPosVelAccQ(sfe_otos_pose2d_q_t &pos, sfe_otos_pose2d_q_t &vel, sfe_otos_pose2d_q_t &acc)
+{
+    // Read all pose registers
+    uint8_t rawData[18];
+    int err = readRegs(transport(), kRegPosXL, rawData, 18);
+    if(err != kSTkErrOk)
+        return err;
+
+    // Convert raw data to fixed point
+    positionRegsToPoseQ(rawData, pos);
+    regsToPoseQ(rawData + 6, vel, kQScaleMps, kQScaleRps);
+    regsToPoseQ(rawData + 12, acc, kQScaleMpss, kQScaleRpss);
+    rebaseIfDue();
+
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::startPosVelAccAsync()
+{
+    return startAsyncRead(transport(), kRegPosXL, 18);
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::startPosVelAccAndStdDevAsync()
+{
+    return startAsyncRead(transport(), kRegPosXL, 36);
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::startPosVelAccCheckedAsync()
+{
+    return startAsyncRead(transport(), kRegStatus, 19);
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::applyConfig(const sfe_otos_config_t &config, bool waitForCalibration)
+{
+    uint8_t image[kConfigImageSize];
+    uint64_t mask = 0;
+
+    // Encode everything first, so nothing is written if a value is invalid
+    int err = scalarToRaw(config.linearScalar, image[kRegScalarLinear]);
+    if(err != kSTkErrOk)
+        return err;
+    err = scalarToRaw(config.angularScalar, image[kRegScalarAngular]);
+    if(err != kSTkErrOk)
+        return err;
+    mask |= (1ull << kRegScalarLinear) | (1ull << kRegScalarAngular);
+
+    image[kRegSignalProcess] = config.signalProcess.value;
+    mask |= 1ull << kRegSignalProcess;
+
+    poseToRegs(image + kRegOffXL, config.offset, this->conversion(kGroupPos));
+    mask |= 0x3Full << kRegOffXL;
+
+    // The configuration registers are all that can be read back, the command
+    // registers clear themselves and the position moves
+    uint64_t verifyMask = mask;
+
+    if(config.imuCalibSamples)
+    {
+        image[kRegImuCalib] = config.imuCalibSamples;
+        mask |= 1ull << kRegImuCalib;
+    }
+
+    // The reset and the position go last, after the calibration if we wait
+    // for it
+    uint64_t trackingMask = 0;
+    if(config.resetTracking)
+    {
+        image[kRegReset] = 0x01;
+        trackingMask |= 1ull << kRegReset;
+    }
+    if(config.setPosition)
+    {
+        poseToRegs(image + kRegPosXL, config.position, this->conversion(kGroupPos));
+        trackingMask |= 0x3Full << kRegPosXL;
+    }
+
+    bool waitFirst = config.imuCalibSamples && waitForCalibration;
+    if(!waitFirst)
+        mask |= trackingMask;
+
+    err = writeRegImage(image, mask);
+    if(err != kSTkErrOk)
+        return err;
+
+    err = verifyRegImage(image, verifyMask);
+    if(err != kSTkErrOk)
+        return err;
+
+    if(waitFirst)
+    {
+        uint32_t nextStepUs;
+        beginImuCalibration(nextStepUs);
+        err = waitForImuCalibration(nextStepUs);
+        if(err != kSTkErrOk)
+            return err;
+
+        err = writeRegImage(image, trackingMask);
+        if(err != kSTkErrOk)
+            return err;
+    }
+
+    if(trackingMask)
+        resyncContinuous();
+
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::getOffset(sfe_otos_pose2d_t &pose)
+{
+    return readPoseRegs(kRegOffXL, pose, kGroupPos);
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::setOffset(sfe_otos_pose2d_t &pose)
+{
+    return writePoseRegs(kRegOffXL, pose, kGroupPos);
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::getPosition(sfe_otos_pose2d_t &pose)
+{
+    uint8_t rawData[6];
+    int err = readRegs(transport(), kRegPosXL, rawData, 6);
+    if(err != kSTkErrOk)
+        return err;
+
+    positionRegsToPose(rawData, pose);
+    rebaseIfDue();
+
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::setPosition(sfe_otos_pose2d_t &pose)
+{
+    if(!_continuous)
+    {
+        int err = writePoseRegs(kRegPosXL, pose, kGroupPos);
+        if(err == kSTkErrOk)
+            resyncContinuous();
+        return err;
+    }
+
+    // The registers get the wrapped position, and the counts keep the rest
+    const sfe_otos_conversion_t &conversion = this->conversion(kGroupPos);
+    int32_t raw[3] = {(int32_t)lrintf(pose.x * conversion.xyToRaw), (int32_t)lrintf(pose.y * conversion.xyToRaw),
+                      (int32_t)lrintf(pose.h * conversion.hToRaw)};
+
+    uint8_t rawData[6];
+    for(int i = 0; i < 3; i++)
+    {
+        rawData[2 * i] = raw[i] & 0xFF;
+        rawData[2 * i + 1] = (raw[i] >> 8) & 0xFF;
+    }
+
+    int err = writeRegs(transport(), kRegPosXL, rawData, 6);
+    if(err != kSTkErrOk)
+        return err;
+
+    memcpy(_continuousRaw, raw, sizeof(_continuousRaw));
+    _continuousOrigin[0] = 0;
+    _continuousOrigin[1] = 0;
+    _continuousSeeded = true;
+
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::getVelocity(sfe_otos_pose2d_t &pose)
+{
+    return readPoseRegs(kRegVelXL, pose, kGroupVel);
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::getAcceleration(sfe_otos_pose2d_t &pose)
+{
+    return readPoseRegs(kRegAccXL, pose, kGroupAcc);
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::getPositionStdDev(sfe_otos_pose2d_t &pose)
+{
+    return readPoseRegs(kRegPosStdXL, pose, kGroupPos);
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::getVelocityStdDev(sfe_otos_pose2d_t &pose)
+{
+    return readPoseRegs(kRegVelStdXL, pose, kGroupVel);
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::getAccelerationStdDev(sfe_otos_pose2d_t &pose)
+{
+    return readPoseRegs(kRegAccStdXL, pose, kGroupAcc);
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::getPosVelAcc(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc)
+{
+    // Read all pose registers
+    uint8_t rawData[18];
+    int err = readRegs(transport(), kRegPosXL, rawData, 18);
+    if(err != kSTkErrOk)
+        return err;
+
+    // Convert raw data to pose units
+    positionRegsToPose(rawData, pos);
+    regsToPose(rawData + 6, vel, this->conversion(kGroupVel));
+    regsToPose(rawData + 12, acc, this->conversion(kGroupAcc));
+    rebaseIfDue();
+
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::getPosVelAccChecked(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel,
+                                                      sfe_otos_pose2d_t &acc, sfe_otos_validity_t &validity,
+                                                      sfe_otos_status_read_t mode)
+{
+    // The status register is right before the pose block, so both fit in a
+    // single burst starting at the status
+    uint8_t rawData[19];
+    int err;
+
+    if(mode == kSfeOtosStatusFirst)
+    {
+        // Read the status on its own and stop there if the pose is not worth
+        // transferring
+        err = readRegs(transport(), kRegStatus, rawData, 1);
+        if(err != kSTkErrOk)
+            return err;
+
+        sfe_otos_status_t status;
+        status.value = rawData[0];
+        validity = getStatusValidity(status);
+        if(validity != kSfeOtosSampleValid)
+            return kSTkErrOk;
+
+        err = readRegs(transport(), kRegPosXL, rawData + 1, 18);
+        if(err != kSTkErrOk)
+            return err;
+    }
+    else
+    {
+        err = readRegs(transport(), kRegStatus, rawData, 19);
+        if(err != kSTkErrOk)
+            return err;
+
+        sfe_otos_status_t status;
+        status.value = rawData[0];
+        validity = getStatusValidity(status);
+        if(validity != kSfeOtosSampleValid)
+            return kSTkErrOk;
+    }
+
+    // Convert raw data to pose units
+    positionRegsToPose(rawData + 1, pos);
+    regsToPose(rawData + 7, vel, this->conversion(kGroupVel));
+    regsToPose(rawData + 13, acc, this->conversion(kGroupAcc));
+    rebaseIfDue();
+
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::getPosVelAccStdDev(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc)
+{
+    // Read all standard deviation registers
+    uint8_t rawData[18];
+    int err = readRegs(transport(), kRegPosStdXL, rawData, 18);
+    if(err != kSTkErrOk)
+        return err;
+
+    // Convert raw data to pose units
+    regsToPose(rawData, pos, this->conversion(kGroupPos));
+    regsToPose(rawData + 6, vel, this->conversion(kGroupVel));
+    regsToPose(rawData + 12, acc, this->conversion(kGroupAcc));
+
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::getPosVelAccAndStdDev(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc,
+                                    sfe_otos_pose2d_t &posStdDev, sfe_otos_pose2d_t &velStdDev,
+                                    sfe_otos_pose2d_t &accStdDev)
+{
+    // Read all pose registers
+    uint8_t rawData[36];
+    int err = readRegs(transport(), kRegPosXL, rawData, 36);
+    if(err != kSTkErrOk)
+        return err;
+
+    // Convert raw data to pose units
+    positionRegsToPose(rawData, pos);
+    regsToPose(rawData + 6, vel, this->conversion(kGroupVel));
+    regsToPose(rawData + 12, acc, this->conversion(kGroupAcc));
+    regsToPose(rawData + 18, posStdDev, this->conversion(kGroupPos));
+    regsToPose(rawData + 24, velStdDev, this->conversion(kGroupVel));
+    regsToPose(rawData + 30, accStdDev, this->conversion(kGroupAcc));
+    rebaseIfDue();
+
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::pollPosVelAccAsync(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc)
+{
+    // Make sure the pending read is the one we expect
+    if(_asyncLength != 18)
+        return kSTkErrFail;
+
+    // Check if the transfer has finished
+    int err = pollAsyncRead(transport());
+    if(err != kSTkErrOk)
+        return err;
+
+    const uint8_t *rawData = _asyncData;
+    // Convert raw data to pose units
+    positionRegsToPose(rawData, pos);
+    regsToPose(rawData + 6, vel, this->conversion(kGroupVel));
+    regsToPose(rawData + 12, acc, this->conversion(kGroupAcc));
+
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::pollPosVelAccAndStdDevAsync(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc,
+                                    sfe_otos_pose2d_t &posStdDev, sfe_otos_pose2d_t &velStdDev,
+                                    sfe_otos_pose2d_t &accStdDev)
+{
+    // Make sure the pending read is the one we expect
+    if(_asyncLength != 36)
+        return kSTkErrFail;
+
+    // Check if the transfer has finished
+    int err = pollAsyncRead(transport());
+    if(err != kSTkErrOk)
+        return err;
+
+    const uint8_t *rawData = _asyncData;
+    // Convert raw data to pose units
+    positionRegsToPose(rawData, pos);
+    regsToPose(rawData + 6, vel, this->conversion(kGroupVel));
+    regsToPose(rawData + 12, acc, this->conversion(kGroupAcc));
+    regsToPose(rawData + 18, posStdDev, this->conversion(kGroupPos));
+    regsToPose(rawData + 24, velStdDev, this->conversion(kGroupVel));
+    regsToPose(rawData + 30, accStdDev, this->conversion(kGroupAcc));
+
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::pollPosVelAccCheckedAsync(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel,
+                                                            sfe_otos_pose2d_t &acc, sfe_otos_validity_t &validity)
+{
+    // Make sure the pending read is the one we expect
+    if(_asyncLength != 19)
+        return kSTkErrFail;
+
+    // Check if the transfer has finished
+    int err = pollAsyncRead(transport());
+    if(err != kSTkErrOk)
+        return err;
+
+    // Skip the conversions of an invalid sample
+    sfe_otos_status_t status;
+    status.value = _asyncData[0];
+    validity = getStatusValidity(status);
+    if(validity != kSfeOtosSampleValid)
+        return kSTkErrOk;
+
+    const uint8_t *rawData = _asyncData + 1;
+    // Convert raw data to pose units
+    positionRegsToPose(rawData, pos);
+    regsToPose(rawData + 6, vel, this->conversion(kGroupVel));
+    regsToPose(rawData + 12, acc, this->conversion(kGroupAcc));
+
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::readPoseRegs(uint8_t reg, sfe_otos_pose2d_t &pose, int group)
+{
+    uint8_t rawData[6];
+
+    // Attempt to read the raw pose data
+    int err = readRegs(transport(), reg, rawData, 6);
+    if(err != kSTkErrOk)
+        return err;
+
+    regsToPose(rawData, pose, this->conversion(group));
+
+    // Done!
+    return kSTkErrOk;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::writePoseRegs(uint8_t reg, sfe_otos_pose2d_t &pose, int group)
+{
+    // Encode the registers once, the transports stream this buffer straight to
+    // the bus after the register address without copying it again
+    uint8_t rawData[6];
+    poseToRegs(rawData, pose, this->conversion(group));
+
+    // Write the raw data to the device
+    return writeRegs(transport(), reg, rawData, 6);
+}
+
+template <class Units, class Bus>
+inline void sfeQwiicOtosPose<Units, Bus>::regsToPose(const uint8_t *rawData, sfe_otos_pose2d_t &pose, const sfe_otos_conversion_t &conversion)
+{
+    // Store raw data
+    int32_t raw[3] = {(int16_t)((rawData[1] << 8) | rawData[0]), (int16_t)((rawData[3] << 8) | rawData[2]),
+                      (int16_t)((rawData[5] << 8) | rawData[4])};
+
+    // Store in pose and convert to units
+    sfeOtosFromRaw(raw, conversion, pose);
+}
+
+template <class Units, class Bus>
+void sfeQwiicOtosPose<Units, Bus>::decodeFrames(const uint8_t *frames, size_t numFrames, float *xs, float *ys,
+                                                float *hs, sfe_otos_group_t group, size_t stride)
+{
+    // Copies of the factors, the stores below could otherwise alias them and
+    // force a reload for every frame
+    const sfe_otos_conversion_t conversion = this->conversion(groupIndex(group));
+    const float rawToXY = conversion.rawToXY;
+    const float rawToH = conversion.rawToH;
+
+    // Two frames per iteration halve the loop overhead. The M0+ faults on
+    // unaligned halfword loads, so the registers are assembled from bytes
+    size_t i = 0;
+    for(; i + 2 <= numFrames; i += 2)
+    {
+        const uint8_t *a = frames + i * stride;
+        const uint8_t *b = a + stride;
+        xs[i] = (int16_t)((a[1] << 8) | a[0]) * rawToXY;
+        xs[i + 1] = (int16_t)((b[1] << 8) | b[0]) * rawToXY;
+        ys[i] = (int16_t)((a[3] << 8) | a[2]) * rawToXY;
+        ys[i + 1] = (int16_t)((b[3] << 8) | b[2]) * rawToXY;
+        hs[i] = (int16_t)((a[5] << 8) | a[4]) * rawToH;
+        hs[i + 1] = (int16_t)((b[5] << 8) | b[4]) * rawToH;
+    }
+
+    if(i < numFrames)
+    {
+        const uint8_t *a = frames + i * stride;
+        xs[i] = (int16_t)((a[1] << 8) | a[0]) * rawToXY;
+        ys[i] = (int16_t)((a[3] << 8) | a[2]) * rawToXY;
+        hs[i] = (int16_t)((a[5] << 8) | a[4]) * rawToH;
+    }
+}
+
+template <class Units, class Bus>
+inline void sfeQwiicOtosPose<Units, Bus>::positionRegsToPose(const uint8_t *rawData, sfe_otos_pose2d_t &pos)
+{
+    const sfe_otos_conversion_t &conversion = this->conversion(kGroupPos);
+    if(!_continuous)
+    {
+        regsToPose(rawData, pos, conversion);
+        return;
+    }
+
+    int32_t counts[3];
+    unwrapPosition(rawData, counts);
+    sfeOtosFromRaw(counts, conversion, pos);
+}
+
+template <class Units, class Bus>
+inline void sfeQwiicOtosPose<Units, Bus>::poseToRegs(uint8_t *rawData, const sfe_otos_pose2d_t &pose, const sfe_otos_conversion_t &conversion)
+{
+    // Convert pose units to raw data
+    int16_t rawX = pose.x * conversion.xyToRaw;
+    int16_t rawY = pose.y * conversion.xyToRaw;
+    int16_t rawH = pose.h * conversion.hToRaw;
+
+    // Store raw data in buffer
+    rawData[0] = rawX & 0xFF;
+    rawData[1] = (rawX >> 8) & 0xFF;
+    rawData[2] = rawY & 0xFF;
+    rawData[3] = (rawY >> 8) & 0xFF;
+    rawData[4] = rawH & 0xFF;
+    rawData[5] = (rawH >> 8) & 0xFF;
+}
+
+template <class Units, class Bus>
+int sfeQwiicOtosPose<Units, Bus>::read(uint8_t groups, sfe_otos_pose_groups_t &out)
+{
+    // Work out which bursts cover the requested groups
+    sfe_otos_group_plan_t plan;
+    planGroupRead(groups, plan);
+
+    // Read the raw data, each group lands at its offset from the position
+    uint8_t rawData[36];
+    int err = readGroupPlan(transport(), plan, rawData);
+    if(err != kSTkErrOk)
+        return err;
+
+    // Convert only the requested groups. Groups are ordered pos, vel, acc,
+    // then the same again for the standard deviations
+    sfe_otos_pose2d_t *poses[6] = {&out.pos, &out.vel, &out.acc, &out.posStdDev, &out.velStdDev, &out.accStdDev};
+    for(int i = 0; i < 6; i++)
+    {
+        if(!(groups & (1 << i)))
+            continue;
+
+        if(i == 0)
+            positionRegsToPose(rawData, out.pos);
+        else
+            regsToPose(rawData + 6 * i, *poses[i], this->conversion(i % kNumGroups));
+    }
+    rebaseIfDue();
+
+    // Done!
+    return kSTkErrOk;
+}
+
+extern template class sfeQwiicOtosPose<sfeOtosRuntimeUnits>;
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <cstring>
 #include "hardware/i2c.h"
 #include "hardware/gpio.h"
+#include "sfeOtosTransport.h"
+#include "OtosBusStats.h"
 
 namespace CONFIG {
 
@@ -18,25 +20,225 @@ namespace CONFIG {
 /// @brief Default I2C addresses of the Qwiic OTOS
 static constexpr uint8_t kDefaultAddress = 0x17;
 
-static constexpr int kSTkErrOk = 0;
-static constexpr int kSTkErrFail = -1;
-
-const int kSTkErrBaseBus = 0x1000;
-const int kSTkErrBusNotInit = kSTkErrFail * (kSTkErrBaseBus + 1);
-const int kSTkErrBusNullBuffer = kSTkErrFail * (kSTkErrBaseBus + 6);
-const int kSTkErrBusUnderRead = kSTkErrBaseBus + 7;
 static constexpr size_t kDefaultBufferChunk = 32;
 
+/// @brief Maximum number of bytes a single DMA register read can transfer
+static constexpr size_t kMaxDmaReadLength = 64;
+
+/// @brief Largest read chunk of OtosI2C::setReadChunk()
+static constexpr size_t kMaxReadChunk = 64;
+
+/// @brief Baud rate steps of OtosI2C::autoTune(), from Standard-mode to
+/// Fast-mode Plus
+static constexpr uint kTuneBaudRates[] = {100 * 1000, 200 * 1000, 400 * 1000, 600 * 1000, 800 * 1000, 1000 * 1000};
+static constexpr int kNumTuneBaudRates = sizeof(kTuneBaudRates) / sizeof(kTuneBaudRates[0]);
+
 void i2cBusRecovery(uint sda_pin, uint scl_pin);
-void initI2C(bool force_recovery);
 
+/// @brief Retry and recovery policy of the OtosI2C transfers
+typedef struct {
+    /// @brief Attempts per transfer, including the first. Pings are never
+    /// retried, a NAK there means the device is absent
+    uint8_t maxAttempts;
+
+    /// @brief Worst-case time of one transfer in microseconds, including its
+    /// retries and recoveries. Each attempt times out within what is left, and
+    /// a recovery that does not fit is deferred to the next transfer
+    uint32_t budgetUs;
+
+    /// @brief Whether repeated faults escalate to a reset of the hardware
+    /// block, then to a bus recovery clocking out a stuck device
+    bool recovery;
+} otos_i2c_retry_policy_t;
+
+/// @brief Default retry policy of the I2C transports, 3 attempts within 5 ms
+static constexpr otos_i2c_retry_policy_t kDefaultRetryPolicy = {3, 5000, true};
+
+/// @brief Faults seen by an OtosI2C, by class, and what was done about them
+typedef struct {
+    /// @brief Transfers the device did not acknowledge
+    uint32_t nacks;
+
+    /// @brief Transfers that did not finish in time
+    uint32_t timeouts;
+
+    /// @brief Faults with SDA or SCL held low after the transfer ended
+    uint32_t stuckBus;
+
+    /// @brief Attempts repeated after a fault
+    uint32_t retries;
+
+    /// @brief Resets of the hardware block
+    uint32_t blockResets;
+
+    /// @brief Bus recoveries, see i2cBusRecovery()
+    uint32_t busRecoveries;
+
+    /// @brief Transfer attempts, including retries and DMA reads, the
+    /// denominator of the fault rates
+    uint32_t attempts;
+} otos_i2c_fault_counters_t;
+
+/// @brief I2C connection to one device: the hardware block, pins, baud rate,
+/// and device address. Several instances can share a hardware block as long as
+/// their devices have different addresses; transfers on different hardware
+/// blocks can run at the same time using the DMA reads
+class OtosI2C final : public sfeOtosTransport {
+  public:
+    OtosI2C(i2c_inst_t *port = CONFIG::i2c_port, uint sdaPin = CONFIG::I2C_SDA_PIN,
+            uint sclPin = CONFIG::I2C_SCL_PIN, uint baudRate = CONFIG::I2C_BAUD_RATE,
+            uint8_t address = kDefaultAddress);
+
+    // Sets up the pins and the hardware block, optionally clocking out a stuck
+    // device first
+    void init(bool force_recovery);
+
+    // Changes the baud rate of the hardware block, returning the rate actually
+    // set. Must not be called while a transfer is in progress
+    uint setBaudRate(uint baudRate);
+    uint getBaudRate() const { return _baudRate; }
+
+    // Largest read done in one go, longer reads are split with a repeated
+    // start. Defaults to kDefaultBufferChunk, at most kMaxReadChunk
+    void setReadChunk(size_t chunk);
+    size_t getReadChunk() const { return _readChunk; }
+
+    // Finds the fastest reliable baud rate and read chunk of this bus. A
+    // block of constant registers is read at 100kHz as a reference, then
+    // repeatedly at every step of kTuneBaudRates up to maxBaudRate with every
+    // chunk size, stopping at the first rate where no chunk size gets
+    // through without a fault or a mismatch. The fastest combination is
+    // kept, and is the ceiling of the runtime tuning. Run it after init(),
+    // with the OTOS idle, ie. not calibrating. Instances sharing a hardware
+    // block share its clock, so only one of them should be tuned
+    int autoTune(uint maxBaudRate = 1000 * 1000);
+
+    // Runtime tuning: every I2C_TUNE_WINDOW attempts, the baud rate steps down
+    // one level if more than I2C_TUNE_MAX_FAULTS_PER_MILLE of them failed, and
+    // back up towards the autoTune() result after a run of clean windows. The
+    // run needed doubles with every step down, so a marginal bus settles
+    // instead of oscillating. On by default after autoTune()
+    void setAutoTune(bool enable) { _autoTune = enable; }
+    bool getAutoTune() const { return _autoTune; }
+
+    int ping() override;
+    int readRegisterByte(uint8_t devReg, uint8_t &dataToRead) override;
+    int readRegisterRegionAnyAddress(uint8_t *devReg, size_t regLength, uint8_t *data, size_t numBytes, size_t &readBytes);
+    int readRegisterRegion(uint8_t devReg, uint8_t *data, size_t numBytes, size_t &readBytes) override;
+    int writeRegisterByte(uint8_t devReg, uint8_t dataToWrite) override;
+    int writeRegisterRegionAddress(uint8_t *devReg, size_t regLength, const uint8_t *data, size_t length);
+    int writeRegisterRegion(uint8_t devReg, const uint8_t *data, size_t length) override;
+
+    // Non-blocking register reads. The transfer is started with
+    // startReadRegisterRegionDma() and runs in the background on two DMA
+    // channels feeding the I2C FIFOs; pollReadRegisterRegionDma() returns
+    // kSTkErrBusBusy until the data buffer has been filled. The buffer must
+    // stay valid until then. Every other transfer on the same hardware block
+    // returns kSTkErrBusBusy in the meantime
+    int startReadRegisterRegionDma(uint8_t devReg, uint8_t *data, size_t numBytes) override;
+    int pollReadRegisterRegionDma(size_t &readBytes) override;
+
+    i2c_inst_t *getPort() const { return _port; }
+    uint8_t getAddress() const { return _address; }
+
+    // Transfer statistics, only collected when built with OTOS_BUS_STATS
+    OtosBusStats &getStats() { return _stats; }
+
+    // Retry policy of the blocking transfers and the timeout of the DMA reads,
+    // see otos_i2c_retry_policy_t. Defaults to 3 attempts within 5 ms
+    void setRetryPolicy(const otos_i2c_retry_policy_t &policy) { _policy = policy; }
+    const otos_i2c_retry_policy_t &getRetryPolicy() const { return _policy; }
+
+    // Faults seen so far, by class
+    const otos_i2c_fault_counters_t &getFaultCounters() const { return _faults; }
+
+  private:
+    // Whether a DMA read owns the given hardware block
+    bool blockBusy() const;
+    void setBlockBusy(bool busy);
+
+    // Transfers behind the public methods, which time them into _stats. Each
+    // fails with kSTkErrBusTimeout once time_us_32() passes deadlineUs
+    int readRegion(uint8_t *devReg, size_t regLength, uint8_t *data, size_t numBytes, size_t &readBytes,
+                   uint32_t deadlineUs);
+    int writeRegion(uint8_t *devReg, size_t regLength, const uint8_t *data, size_t length, uint32_t deadlineUs);
+    int startDma(uint8_t devReg, uint8_t *data, size_t numBytes);
+
+    // Stops both DMA channels and the block's own transfer, leaving the
+    // FIFOs empty for the next one
+    void abortDma();
+
+    // Recovery steps, by increasing cost
+    enum {
+        kRecoveryNone = 0,
+        kRecoveryBlockReset,
+        kRecoveryBus
+    };
+
+    // Runs transfer(deadlineUs) under the retry policy, classifying each
+    // fault and escalating the recovery before the next attempt
+    template <class Transfer>
+    int withRetries(size_t numBytes, uint8_t maxAttempts, Transfer transfer);
+
+    // Expected time of a transfer moving numBytes, with margin for clock
+    // stretching
+    uint32_t transferTimeUs(size_t numBytes) const;
+
+    // Records a fault and picks the recovery for it, given how many attempts
+    // of the same transfer have failed so far
+    void classifyFault(int result, uint8_t failures);
+
+    // Performs the pending recovery if it fits before deadlineUs
+    int recover(uint32_t deadlineUs);
+
+    // Whether a device holds SDA or SCL low with the block idle
+    bool linesStuck() const;
+
+    // Reads the autoTune() reference block I2C_TUNE_PROBE_READS times at the
+    // current settings, returning the time taken, or 0 on any fault or
+    // mismatch
+    uint32_t probeReads(const uint8_t *reference, size_t length);
+
+    // Runtime tuning step, after every finished transfer
+    void adaptBaudRate();
+
+    i2c_inst_t *_port;
+    uint _sdaPin;
+    uint _sclPin;
+    uint _baudRate;
+    uint8_t _address;
+
+    // DMA state for the non-blocking register reads. The I2C block needs one
+    // command word in the TX FIFO for every byte clocked in, so the TX channel
+    // streams the register address followed by the read commands, while the RX
+    // channel drains the received bytes into the caller's buffer
+    int _dmaTxChannel;
+    int _dmaRxChannel;
+    uint32_t _dmaCommands[kMaxDmaReadLength + 1];
+    size_t _dmaLength;
+    volatile bool _dmaActive;
+
+    OtosBusStats _stats;
+    uint32_t _dmaStartUs;
+    uint8_t _dmaReg;
+
+    otos_i2c_retry_policy_t _policy;
+    otos_i2c_fault_counters_t _faults;
+    uint8_t _recoveryLevel;
+    uint32_t _dmaDeadlineUs;
+
+    size_t _readChunk;
 
-int ping();
-int readRegisterByte(uint8_t devReg, uint8_t &dataToRead);
-int readRegisterRegionAnyAddress(uint8_t *devReg, size_t regLength, uint8_t *data, size_t numBytes, size_t &readBytes);
-int readRegisterRegion(uint8_t devReg, uint8_t *data, size_t numBytes, size_t &readBytes);
-int writeRegisterByte(uint8_t devReg, uint8_t dataToWrite);
-int writeRegisterRegionAddress(uint8_t *devReg, size_t regLength, const uint8_t *data, size_t length);
-int writeRegisterRegion(uint8_t devReg, const uint8_t *data, size_t length);
+    // Runtime tuning state: current and highest kTuneBaudRates level, the
+    // counters at the start of the window, and the clean windows seen and
+    // needed before stepping up
+    bool _autoTune;
+    int8_t _tuneLevel;
+    int8_t _tuneMaxLevel;
+    uint32_t _tuneAttempts;
+    uint32_t _tuneFaults;
+    uint16_t _tuneCleanWindows;
+    uint16_t _tuneHoldWindows;
+};
 
-#endif // UTILS_H
\ No newline at end of file
+#endif // UTILS_H
@@ -0,0 +1,136 @@
+#include "OtosBusStats.h"
+
+#if OTOS_BUS_STATS
+
+#include <stdio.h>
+#include <string.h>
+#include "utils.h"
+
+// First pose register, every register group after it is 6 bytes long
+#define STATS_FIRST_POSE_REG 0x20
+#define STATS_GROUP_SIZE 6
+
+// Linear sub-buckets per power of two, see kOtosStatsNumBuckets
+#define STATS_SUB_BUCKET_BITS 2
+#define STATS_SUB_BUCKETS (1 << STATS_SUB_BUCKET_BITS)
+
+static const char *const groupNames[kOtosStatsNumGroups] = {
+    "config", "pos", "vel", "acc", "posStd", "velStd", "accStd"
+};
+
+OtosBusStats::OtosBusStats() {
+    reset();
+}
+
+int OtosBusStats::groupOf(uint8_t reg) {
+    if (reg < STATS_FIRST_POSE_REG) {
+        return kOtosStatsGroupConfig;
+    }
+
+    int group = kOtosStatsGroupPos + (reg - STATS_FIRST_POSE_REG) / STATS_GROUP_SIZE;
+    return (group < kOtosStatsNumGroups) ? group : kOtosStatsGroupConfig;
+}
+
+int OtosBusStats::bucketOf(uint32_t us) {
+    // Values below the first split are counted exactly
+    if (us < STATS_SUB_BUCKETS) {
+        return us;
+    }
+
+    // The power of two selects a row of sub-buckets, the bits below the
+    // leading one select the sub-bucket
+    int msb = 31 - __builtin_clz(us);
+    int bucket = ((msb - STATS_SUB_BUCKET_BITS + 1) << STATS_SUB_BUCKET_BITS)
+               + ((us >> (msb - STATS_SUB_BUCKET_BITS)) & (STATS_SUB_BUCKETS - 1));
+
+    return (bucket < kOtosStatsNumBuckets) ? bucket : kOtosStatsNumBuckets - 1;
+}
+
+uint32_t OtosBusStats::bucketUpperUs(int bucket) {
+    if (bucket < STATS_SUB_BUCKETS) {
+        return bucket;
+    }
+
+    int row = bucket >> STATS_SUB_BUCKET_BITS;
+    uint32_t sub = bucket & (STATS_SUB_BUCKETS - 1);
+    int shift = row - 1;
+
+    // One below the lower bound of the next sub-bucket
+    return ((STATS_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+int OtosBusStats::record(uint8_t reg, size_t bytes, int result, uint32_t startUs) {
+    otos_bus_stats_group_t &group = _groups[groupOf(reg)];
+
+    // A transfer refused up front never reached the bus
+    if (result == kSTkErrBusBusy) {
+        group.busy++;
+        return result;
+    }
+
+    uint32_t elapsed = time_us_32() - startUs;
+
+    group.transactions++;
+    group.bytes += bytes;
+    if (result < 0) {
+        group.errors++;
+    } else if (result == kSTkErrBusUnderRead) {
+        group.underReads++;
+    }
+
+    if (elapsed < group.minUs) {
+        group.minUs = elapsed;
+    }
+    if (elapsed > group.maxUs) {
+        group.maxUs = elapsed;
+    }
+    group.totalUs += elapsed;
+    group.histogram[bucketOf(elapsed)]++;
+
+    return result;
+}
+
+void OtosBusStats::reset() {
+    memset(_groups, 0, sizeof(_groups));
+    for (int i = 0; i < kOtosStatsNumGroups; ++i) {
+        _groups[i].minUs = UINT32_MAX;
+    }
+}
+
+uint32_t OtosBusStats::getPercentileUs(int group, uint32_t perMille) const {
+    const otos_bus_stats_group_t &stats = _groups[group];
+    if (stats.transactions == 0) {
+        return 0;
+    }
+
+    // Smallest bucket reaching the requested share of the transfers
+    uint64_t target = ((uint64_t)stats.transactions * perMille + 999) / 1000;
+    uint64_t count = 0;
+    for (int i = 0; i < kOtosStatsNumBuckets; ++i) {
+        count += stats.histogram[i];
+        if (count >= target && count > 0) {
+            return (bucketUpperUs(i) < stats.maxUs) ? bucketUpperUs(i) : stats.maxUs;
+        }
+    }
+
+    return stats.maxUs;
+}
+
+void OtosBusStats::dump() const {
+    printf("group   transfers    bytes  errors  short   busy  min_us  p50_us  p99_us  max_us\n");
+
+    for (int i = 0; i < kOtosStatsNumGroups; ++i) {
+        const otos_bus_stats_group_t &stats = _groups[i];
+        if (stats.transactions == 0 && stats.busy == 0) {
+            continue;
+        }
+
+        printf("%-7s %9lu %8lu %7lu %6lu %6lu %7lu %7lu %7lu %7lu\n", groupNames[i],
+               (unsigned long)stats.transactions, (unsigned long)stats.bytes, (unsigned long)stats.errors,
+               (unsigned long)stats.underReads, (unsigned long)stats.busy,
+               (unsigned long)(stats.transactions ? stats.minUs : 0), (unsigned long)getPercentileUs(i, 500),
+               (unsigned long)getPercentileUs(i, 990), (unsigned long)stats.maxUs);
+    }
+}
+
+#endif // OTOS_BUS_STATS
@@ -0,0 +1,156 @@
+#include "OtosFlashSnapshot.h"
+
+#include <string.h>
+#include "hardware/flash.h"
+#include "hardware/regs/addressmap.h"
+#include "pico/flash.h"
+#include "utils.h"
+
+// Identifies a snapshot record, and its layout version
+#define SNAPSHOT_MAGIC 0x534F544F
+#define SNAPSHOT_VERSION 1
+
+// Longest time to wait for the other core to pause before a flash operation
+#define SNAPSHOT_LOCKOUT_TIMEOUT_MS 100
+
+// Record stored at the start of a snapshot sector
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;
+    sfe_otos_snapshot_t snapshot;
+
+    // CRC-32 of everything above
+    uint32_t crc;
+} otos_snapshot_record_t;
+
+static_assert(sizeof(otos_snapshot_record_t) <= FLASH_PAGE_SIZE, "snapshot must fit in a flash page");
+
+// Flash operation run with both cores paused, see flash_safe_execute()
+typedef struct {
+    uint32_t offset;
+    const uint8_t *page;
+} otos_snapshot_flash_op_t;
+
+static uint32_t crc32(const uint8_t *data, size_t length) {
+    // Bitwise CRC-32 (IEEE), the record is only checked once per boot
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static bool slotOffset(uint8_t slot, uint32_t &offset) {
+    // Slots grow down from the last one, and must stay inside flash
+    if ((uint32_t)slot * FLASH_SECTOR_SIZE > OTOS_SNAPSHOT_FLASH_OFFSET) {
+        return false;
+    }
+
+    offset = OTOS_SNAPSHOT_FLASH_OFFSET - (uint32_t)slot * FLASH_SECTOR_SIZE;
+    return true;
+}
+
+static void flashOp(void *param) {
+    const otos_snapshot_flash_op_t *op = (const otos_snapshot_flash_op_t *)param;
+
+    flash_range_erase(op->offset, FLASH_SECTOR_SIZE);
+    if (op->page) {
+        flash_range_program(op->offset, op->page, FLASH_PAGE_SIZE);
+    }
+}
+
+static int runFlashOp(uint32_t offset, const uint8_t *page) {
+    // Both cores execute from flash, so the other one is paused for the
+    // duration, and interrupts are disabled on this one
+    otos_snapshot_flash_op_t op = {offset, page};
+    if (flash_safe_execute(flashOp, &op, SNAPSHOT_LOCKOUT_TIMEOUT_MS) != PICO_OK) {
+        return kSTkErrFail;
+    }
+
+    return kSTkErrOk;
+}
+
+int otosSnapshotWrite(const sfe_otos_snapshot_t &snapshot, uint8_t slot) {
+    uint32_t offset;
+    if (!slotOffset(slot, offset)) {
+        return kSTkErrFail;
+    }
+
+    // Build the record in a full page, the padding stays erased
+    static uint8_t page[FLASH_PAGE_SIZE];
+    memset(page, 0xFF, sizeof(page));
+
+    otos_snapshot_record_t record;
+    memset(&record, 0, sizeof(record));
+    record.magic = SNAPSHOT_MAGIC;
+    record.version = SNAPSHOT_VERSION;
+    record.length = sizeof(sfe_otos_snapshot_t);
+    record.snapshot = snapshot;
+    record.crc = crc32((const uint8_t *)&record, offsetof(otos_snapshot_record_t, crc));
+    memcpy(page, &record, sizeof(record));
+
+    // Nothing to do if the slot already holds this record, which saves an
+    // erase cycle
+    if (memcmp((const void *)(uintptr_t)(XIP_BASE + offset), page, sizeof(record)) == 0) {
+        return kSTkErrOk;
+    }
+
+    return runFlashOp(offset, page);
+}
+
+int otosSnapshotRead(sfe_otos_snapshot_t &snapshot, uint8_t slot) {
+    uint32_t offset;
+    if (!slotOffset(slot, offset)) {
+        return kSTkErrFail;
+    }
+
+    // Flash is memory mapped through the XIP window
+    otos_snapshot_record_t record;
+    memcpy(&record, (const void *)(uintptr_t)(XIP_BASE + offset), sizeof(record));
+
+    // Reject erased sectors, other layouts, and corrupted records
+    if (record.magic != SNAPSHOT_MAGIC || record.version != SNAPSHOT_VERSION ||
+        record.length != sizeof(sfe_otos_snapshot_t)) {
+        return kSTkErrFail;
+    }
+
+    if (record.crc != crc32((const uint8_t *)&record, offsetof(otos_snapshot_record_t, crc))) {
+        return kSTkErrFail;
+    }
+
+    snapshot = record.snapshot;
+    return kSTkErrOk;
+}
+
+int otosSnapshotErase(uint8_t slot) {
+    uint32_t offset;
+    if (!slotOffset(slot, offset)) {
+        return kSTkErrFail;
+    }
+
+    return runFlashOp(offset, nullptr);
+}
+
+int otosSnapshotSave(sfeQwiicOtosBase &otos, uint8_t slot) {
+    sfe_otos_snapshot_t snapshot;
+    int err = otos.getSnapshot(snapshot);
+    if (err != kSTkErrOk) {
+        return err;
+    }
+
+    return otosSnapshotWrite(snapshot, slot);
+}
+
+int otosSnapshotRestore(sfeQwiicOtosBase &otos, uint8_t slot) {
+    sfe_otos_snapshot_t snapshot;
+    int err = otosSnapshotRead(snapshot, slot);
+    if (err != kSTkErrOk) {
+        return err;
+    }
+
+    return otos.restoreSnapshot(snapshot);
+}
@@ -0,0 +1,467 @@
+#include "OtosPioI2C.h"
+#include "hardware/dma.h"
+#include "pico/stdlib.h"
+#include "otos_i2c.pio.h"
+
+// Fields of a 16 bit record, see otos_i2c.pio
+#define PIO_I2C_ICOUNT_LSB 10
+#define PIO_I2C_FINAL_LSB 9
+#define PIO_I2C_DATA_LSB 1
+#define PIO_I2C_NAK_LSB 0
+
+// Records of the longest condition, the repeated START: the escape record and
+// its four instructions
+#define PIO_I2C_MAX_CONDITION_RECORDS 5
+
+// SCL/SDA sequences of the bus conditions, as indices into the
+// otos_set_scl_sda table. Every sequence ends with SCL low except the STOP
+static const uint8_t kStartSequence[] = {I2C_SC1_SD0, I2C_SC0_SD0};
+static const uint8_t kRepeatedStartSequence[] = {I2C_SC0_SD1, I2C_SC1_SD1, I2C_SC1_SD0, I2C_SC0_SD0};
+static const uint8_t kStopSequence[] = {I2C_SC0_SD0, I2C_SC1_SD0, I2C_SC1_SD1};
+
+// Time allowed to send the STOP releasing the bus after a NAK
+#define PIO_I2C_RESUME_US 200
+
+#define NUM_PIOS 2
+#define NUM_PIO_SMS 4
+
+// Program offset of each PIO block, loaded by the first instance on it
+static int programOffset[NUM_PIOS] = {-1, -1};
+
+// SDA pin each claimed state machine drives, so instances on the same pins
+// share it, and which state machines are owned by a DMA read
+static int smSdaPin[NUM_PIOS][NUM_PIO_SMS] = {{-1, -1, -1, -1}, {-1, -1, -1, -1}};
+static volatile bool smDmaActive[NUM_PIOS][NUM_PIO_SMS] = {};
+
+// Whether a deadline has passed
+static inline bool expired(uint32_t deadlineUs) {
+    return (int32_t)(time_us_32() - deadlineUs) >= 0;
+}
+
+static size_t appendCondition(uint16_t *records, const uint8_t *sequence, size_t length) {
+    records[0] = (length - 1) << PIO_I2C_ICOUNT_LSB;
+    for (size_t i = 0; i < length; ++i) {
+        records[i + 1] = otos_set_scl_sda_program_instructions[sequence[i]];
+    }
+    return length + 1;
+}
+
+static inline uint16_t addressRecord(uint8_t address, bool read) {
+    return (((address << 1) | (read ? 1u : 0u)) << PIO_I2C_DATA_LSB) | (1u << PIO_I2C_NAK_LSB);
+}
+
+static inline uint16_t writeRecord(uint8_t data, bool last) {
+    return (data << PIO_I2C_DATA_LSB) | ((last ? 1u : 0u) << PIO_I2C_FINAL_LSB) | (1u << PIO_I2C_NAK_LSB);
+}
+
+// The master acknowledges every byte it reads except the last one
+static inline uint16_t readRecord(bool last) {
+    return (0xffu << PIO_I2C_DATA_LSB) | (last ? (1u << PIO_I2C_FINAL_LSB) | (1u << PIO_I2C_NAK_LSB) : 0u);
+}
+
+OtosPioI2C::OtosPioI2C(PIO pio, uint sdaPin, uint sclPin, uint baudRate, uint8_t address)
+    : _pio(pio), _sdaPin(sdaPin), _sclPin(sclPin), _baudRate(baudRate), _address(address), _sm(-1),
+      _dmaTxChannel(-1), _dmaRxChannel(-1), _dmaCommands{}, _dmaRxData{}, _dmaData(nullptr),
+      _dmaLength(0), _dmaSkip(0), _dmaDraining(false), _dmaActive(false),
+      _dmaStartUs(0), _dmaReg(0), _policy(kDefaultRetryPolicy), _deadlineUs(0), _timedOut(false),
+      _dmaDeadlineUs(0) {
+}
+
+bool OtosPioI2C::smBusy() const {
+    return smDmaActive[pio_get_index(_pio)][_sm];
+}
+
+void OtosPioI2C::setSmBusy(bool busy) {
+    smDmaActive[pio_get_index(_pio)][_sm] = busy;
+    _dmaActive = busy;
+}
+
+void OtosPioI2C::init(bool force_recovery) {
+    // The clock stretching wait addresses SCL relative to SDA
+    if (_sclPin != _sdaPin + 1) {
+        _sm = -1;
+        return;
+    }
+
+    uint index = pio_get_index(_pio);
+
+    // Share the state machine of another instance on the same pins
+    for (int sm = 0; sm < NUM_PIO_SMS; ++sm) {
+        if (smSdaPin[index][sm] == (int)_sdaPin) {
+            _sm = sm;
+            return;
+        }
+    }
+
+    if (programOffset[index] < 0) {
+        if (!pio_can_add_program(_pio, &otos_i2c_program)) {
+            _sm = -1;
+            return;
+        }
+        programOffset[index] = pio_add_program(_pio, &otos_i2c_program);
+    }
+
+    _sm = pio_claim_unused_sm(_pio, false);
+    if (_sm < 0) {
+        return;
+    }
+    smSdaPin[index][_sm] = _sdaPin;
+
+    // Attempt I2C bus recovery before handing the pins to the PIO
+    if (force_recovery) {
+        i2cBusRecovery(_sdaPin, _sclPin);
+    }
+
+    otos_i2c_program_init(_pio, _sm, programOffset[index], _sdaPin, _sclPin, _baudRate);
+}
+
+uint OtosPioI2C::setBaudRate(uint baudRate) {
+    _baudRate = baudRate;
+
+    if (_sm < 0) {
+        return 0;
+    }
+
+    // Each bit takes 32 cycles, see otos_i2c.pio
+    pio_sm_set_clkdiv(_pio, _sm, (float)clock_get_hz(clk_sys) / (32.0f * baudRate));
+    return baudRate;
+}
+
+bool OtosPioI2C::checkError() const {
+    return pio_interrupt_get(_pio, _sm);
+}
+
+void OtosPioI2C::resumeAfterError() {
+    // Jump back to the entry point from the IRQ wait, then release the bus.
+    // The STOP has a deadline of its own, a device may hold SCL after its NAK
+    pio_sm_drain_tx_fifo(_pio, _sm);
+    pio_sm_exec(_pio, _sm, (_pio->sm[_sm].execctrl & PIO_SM0_EXECCTRL_WRAP_BOTTOM_BITS) >> PIO_SM0_EXECCTRL_WRAP_BOTTOM_LSB);
+    pio_interrupt_clear(_pio, _sm);
+
+    _deadlineUs = time_us_32() + PIO_I2C_RESUME_US;
+    _timedOut = false;
+    putCondition(kStopSequence, sizeof(kStopSequence));
+    waitStall();
+}
+
+void OtosPioI2C::beginTransfer() {
+    _deadlineUs = time_us_32() + _policy.budgetUs;
+    _timedOut = false;
+}
+
+bool OtosPioI2C::linesStuck() const {
+    // The pins read back their level whatever function drives them
+    return !gpio_get(_sdaPin) || !gpio_get(_sclPin);
+}
+
+int OtosPioI2C::recoverStall() {
+    // The state machine may be stuck in the middle of a byte, waiting on SCL,
+    // so it restarts from scratch with empty FIFOs and the IRQ flag cleared
+    pio_sm_set_enabled(_pio, _sm, false);
+    _timedOut = false;
+
+    if (_policy.recovery && linesStuck()) {
+        // Back to plain GPIOs, the PIO inverts the output enables
+        gpio_set_oeover(_sdaPin, GPIO_OVERRIDE_NORMAL);
+        gpio_set_oeover(_sclPin, GPIO_OVERRIDE_NORMAL);
+        i2cBusRecovery(_sdaPin, _sclPin);
+    }
+
+    otos_i2c_program_init(_pio, _sm, programOffset[pio_get_index(_pio)], _sdaPin, _sclPin, _baudRate);
+
+    return linesStuck() ? kSTkErrBusStuck : kSTkErrBusTimeout;
+}
+
+void OtosPioI2C::put(uint16_t record) {
+    if (_timedOut) {
+        return;
+    }
+
+    // Every data record pushes a byte, so keep the RX FIFO drained or the
+    // state machine stalls on the autopush
+    while (pio_sm_is_tx_fifo_full(_pio, _sm)) {
+        if (checkError()) {
+            return;
+        }
+        if (expired(_deadlineUs)) {
+            _timedOut = true;
+            return;
+        }
+        while (!pio_sm_is_rx_fifo_empty(_pio, _sm)) {
+            (void)pio_sm_get(_pio, _sm);
+        }
+    }
+
+    if (checkError()) {
+        return;
+    }
+
+    // Halfword writes make the record available to the 16 bit autopull
+    *(io_rw_16 *)&_pio->txf[_sm] = record;
+}
+
+void OtosPioI2C::putCondition(const uint8_t *sequence, size_t length) {
+    uint16_t records[PIO_I2C_MAX_CONDITION_RECORDS];
+    size_t numRecords = appendCondition(records, sequence, length);
+    for (size_t i = 0; i < numRecords; ++i) {
+        put(records[i]);
+    }
+}
+
+bool OtosPioI2C::waitStall() {
+    // Finished when the TX FIFO runs dry or the state machine hits its IRQ
+    uint32_t stallBit = 1u << (PIO_FDEBUG_TXSTALL_LSB + _sm);
+    _pio->fdebug = stallBit;
+
+    while (!(_pio->fdebug & stallBit)) {
+        if (checkError() || _timedOut) {
+            return false;
+        }
+        if (expired(_deadlineUs)) {
+            _timedOut = true;
+            return false;
+        }
+        while (!pio_sm_is_rx_fifo_empty(_pio, _sm)) {
+            (void)pio_sm_get(_pio, _sm);
+        }
+    }
+
+    return !checkError();
+}
+
+int OtosPioI2C::waitIdle() {
+    if (!waitStall()) {
+        if (_timedOut) {
+            return recoverStall();
+        }
+
+        // Otherwise the state machine halted on an unexpected NAK
+        resumeAfterError();
+        return _timedOut ? recoverStall() : kSTkErrBusNoResponse;
+    }
+
+    return kSTkErrOk;
+}
+
+int OtosPioI2C::ping() {
+    if (_sm < 0) {
+        return kSTkErrBusNotInit;
+    }
+
+    if (smBusy()) {
+        return kSTkErrBusBusy;
+    }
+
+    // Address only, a NAK halts the state machine
+    uint32_t start = OtosBusStats::now();
+    beginTransfer();
+    putCondition(kStartSequence, sizeof(kStartSequence));
+    put(addressRecord(_address, false));
+    putCondition(kStopSequence, sizeof(kStopSequence));
+
+    return _stats.record(0, 0, waitIdle(), start);
+}
+
+int OtosPioI2C::readRegisterByte(uint8_t devReg, uint8_t &dataToRead) {
+    size_t readBytes;
+    return readRegisterRegionAnyAddress(&devReg, 1, &dataToRead, 1, readBytes);
+}
+
+int OtosPioI2C::readRegisterRegionAnyAddress(uint8_t *devReg, size_t regLength, uint8_t *data, size_t numBytes, size_t &readBytes) {
+    readBytes = 0;
+
+    // Same DMA transfer as the non-blocking reads, waited on from here. The
+    // poll times it out within the policy budget
+    int result = startReadDma(devReg, regLength, data, numBytes);
+    if (result != kSTkErrOk)
+        return result;
+
+    while ((result = pollReadRegisterRegionDma(readBytes)) == kSTkErrBusBusy)
+        tight_loop_contents();
+
+    return result;
+}
+
+int OtosPioI2C::readRegisterRegion(uint8_t devReg, uint8_t *data, size_t numBytes, size_t &readBytes)
+{
+    return readRegisterRegionAnyAddress(&devReg, 1, data, numBytes, readBytes);
+}
+
+int OtosPioI2C::writeRegisterByte(uint8_t devReg, uint8_t dataToWrite) {
+    return writeRegisterRegionAddress(&devReg, 1, &dataToWrite, 1);
+}
+
+int OtosPioI2C::writeRegisterRegionAddress(uint8_t *devReg, size_t regLength, const uint8_t *data, size_t length) {
+    uint32_t start = OtosBusStats::now();
+    int result = writeRegion(devReg, regLength, data, length);
+    return _stats.record(regLength ? devReg[0] : 0, length, result, start);
+}
+
+int OtosPioI2C::writeRegion(uint8_t *devReg, size_t regLength, const uint8_t *data, size_t length) {
+    if (_sm < 0)
+        return kSTkErrBusNotInit;
+
+    if (!data && length > 0)
+        return kSTkErrBusNullBuffer;
+
+    if (smBusy())
+        return kSTkErrBusBusy;
+
+    // The bytes are streamed straight from the caller's buffers, the NAK on
+    // the last one is not an error
+    size_t total = regLength + length;
+    beginTransfer();
+    putCondition(kStartSequence, sizeof(kStartSequence));
+    put(addressRecord(_address, false));
+    for (size_t i = 0; i < regLength; ++i) {
+        put(writeRecord(devReg[i], i + 1 == total));
+    }
+    for (size_t i = 0; i < length; ++i) {
+        put(writeRecord(data[i], regLength + i + 1 == total));
+    }
+    putCondition(kStopSequence, sizeof(kStopSequence));
+
+    return waitIdle();
+}
+
+int OtosPioI2C::writeRegisterRegion(uint8_t devReg, const uint8_t *data, size_t length)
+{
+    return writeRegisterRegionAddress(&devReg, 1, data, length);
+}
+
+int OtosPioI2C::startReadRegisterRegionDma(uint8_t devReg, uint8_t *data, size_t numBytes) {
+    return startReadDma(&devReg, 1, data, numBytes);
+}
+
+int OtosPioI2C::startReadDma(const uint8_t *devReg, size_t regLength, uint8_t *data, size_t numBytes) {
+    uint32_t start = OtosBusStats::now();
+    uint8_t reg = regLength ? devReg[0] : 0;
+    int result = beginReadDma(devReg, regLength, data, numBytes);
+    if (result != kSTkErrOk)
+        return _stats.record(reg, 0, result, start);
+
+    // The transfer is recorded once pollReadRegisterRegionDma() sees it end
+    _dmaStartUs = start;
+    _dmaReg = reg;
+    return kSTkErrOk;
+}
+
+int OtosPioI2C::beginReadDma(const uint8_t *devReg, size_t regLength, uint8_t *data, size_t numBytes) {
+    if (_sm < 0)
+        return kSTkErrBusNotInit;
+
+    if (!data)
+        return kSTkErrBusNullBuffer;
+
+    // Every byte on the bus is echoed into _dmaRxData
+    if (numBytes == 0 || regLength + numBytes > kMaxDmaReadLength + 1)
+        return kSTkErrBusDataTooLong;
+
+    if (smBusy())
+        return kSTkErrBusBusy;
+
+    // Claim the DMA channels on first use
+    if (_dmaTxChannel < 0) {
+        _dmaTxChannel = dma_claim_unused_channel(true);
+        _dmaRxChannel = dma_claim_unused_channel(true);
+    }
+
+    // Register address write, then a repeated START into the burst read with a
+    // STOP after the last byte. Without a register address the read starts
+    // right away
+    size_t n = appendCondition(_dmaCommands, kStartSequence, sizeof(kStartSequence));
+    if (regLength > 0) {
+        _dmaCommands[n++] = addressRecord(_address, false);
+        for (size_t i = 0; i < regLength; ++i) {
+            _dmaCommands[n++] = writeRecord(devReg[i], false);
+        }
+        n += appendCondition(_dmaCommands + n, kRepeatedStartSequence, sizeof(kRepeatedStartSequence));
+    }
+    _dmaCommands[n++] = addressRecord(_address, true);
+    for (size_t i = 0; i < numBytes; ++i) {
+        _dmaCommands[n++] = readRecord(i == numBytes - 1);
+    }
+    n += appendCondition(_dmaCommands + n, kStopSequence, sizeof(kStopSequence));
+
+    // Address and register bytes echoed ahead of the data
+    _dmaSkip = (regLength > 0 ? regLength + 1 : 0) + 1;
+
+    // Drop anything left over from a previous transfer
+    while (!pio_sm_is_rx_fifo_empty(_pio, _sm)) {
+        (void)pio_sm_get(_pio, _sm);
+    }
+
+    dma_channel_config rxConfig = dma_channel_get_default_config(_dmaRxChannel);
+    channel_config_set_transfer_data_size(&rxConfig, DMA_SIZE_8);
+    channel_config_set_read_increment(&rxConfig, false);
+    channel_config_set_write_increment(&rxConfig, true);
+    channel_config_set_dreq(&rxConfig, pio_get_dreq(_pio, _sm, false));
+    dma_channel_configure(_dmaRxChannel, &rxConfig, _dmaRxData, &_pio->rxf[_sm], _dmaSkip + numBytes, false);
+
+    dma_channel_config txConfig = dma_channel_get_default_config(_dmaTxChannel);
+    channel_config_set_transfer_data_size(&txConfig, DMA_SIZE_16);
+    channel_config_set_read_increment(&txConfig, true);
+    channel_config_set_write_increment(&txConfig, false);
+    channel_config_set_dreq(&txConfig, pio_get_dreq(_pio, _sm, true));
+    dma_channel_configure(_dmaTxChannel, &txConfig, &_pio->txf[_sm], _dmaCommands, n, false);
+
+    _dmaData = data;
+    _dmaLength = numBytes;
+    _dmaDraining = false;
+    _dmaDeadlineUs = time_us_32() + _policy.budgetUs;
+    setSmBusy(true);
+
+    dma_start_channel_mask((1u << _dmaRxChannel) | (1u << _dmaTxChannel));
+
+    return kSTkErrOk;
+}
+
+int OtosPioI2C::pollReadRegisterRegionDma(size_t &readBytes) {
+    readBytes = 0;
+
+    if (!_dmaActive)
+        return kSTkErrFail;
+
+    // A NAK halts the state machine and leaves both channels waiting forever,
+    // so they have to be stopped by hand
+    if (checkError()) {
+        dma_channel_abort(_dmaTxChannel);
+        dma_channel_abort(_dmaRxChannel);
+        resumeAfterError();
+        int result = _timedOut ? recoverStall() : kSTkErrBusNoResponse;
+        setSmBusy(false);
+        return _stats.record(_dmaReg, 0, result, _dmaStartUs);
+    }
+
+    // Stalled, eg. a device stretching the clock forever
+    uint32_t stallBit = 1u << (PIO_FDEBUG_TXSTALL_LSB + _sm);
+    bool done = !dma_channel_is_busy(_dmaRxChannel) && _dmaDraining && !dma_channel_is_busy(_dmaTxChannel) &&
+                (_pio->fdebug & stallBit);
+    if (!done && expired(_dmaDeadlineUs)) {
+        dma_channel_abort(_dmaTxChannel);
+        dma_channel_abort(_dmaRxChannel);
+        int result = recoverStall();
+        setSmBusy(false);
+        return _stats.record(_dmaReg, 0, result, _dmaStartUs);
+    }
+
+    if (dma_channel_is_busy(_dmaRxChannel))
+        return kSTkErrBusBusy;
+
+    // Once the last byte is in, the STOP records are still queued; the state
+    // machine stalls on the TX FIFO after sending them
+    if (!_dmaDraining) {
+        _pio->fdebug = stallBit;
+        _dmaDraining = true;
+        return kSTkErrBusBusy;
+    }
+
+    if (dma_channel_is_busy(_dmaTxChannel) || !(_pio->fdebug & stallBit))
+        return kSTkErrBusBusy;
+
+    memcpy(_dmaData, _dmaRxData + _dmaSkip, _dmaLength);
+    setSmBusy(false);
+
+    readBytes = _dmaLength;
+    return _stats.record(_dmaReg, _dmaLength, kSTkErrOk, _dmaStartUs);
+}
@@ -0,0 +1,146 @@
+#include "QwiicOtosDualCore.h"
+#include "utils.h"
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/flash.h"
+
+// Word pushed back by core1 once it has left the acquisition loop
+static constexpr uint32_t kCore1Stopped = 0x0705DEAD;
+
+QwiicOTOSDualCore::QwiicOTOSDualCore(sfeQwiicOtos &otos)
+    : _otos{otos}, _periodUs{0}, _running{false}, _stopRequested{false}, _sequence{0}, _latest{},
+      _numErrors{0}
+{
+    // Nothing to do here!
+}
+
+int QwiicOTOSDualCore::start(uint32_t periodUs)
+{
+    // Check if already running
+    if(_running)
+        return kSTkErrFail;
+
+    _periodUs = periodUs;
+    _stopRequested.store(false);
+    _sequence.store(0);
+    _numErrors.store(0);
+
+    // Launch core1 and hand it this instance
+    multicore_reset_core1();
+    multicore_launch_core1(core1Entry);
+    multicore_fifo_push_blocking((uint32_t)(uintptr_t)this);
+
+    _running = true;
+
+    // Done!
+    return kSTkErrOk;
+}
+
+void QwiicOTOSDualCore::stop()
+{
+    if(!_running)
+        return;
+
+    // Ask core1 to leave the loop and wait until it has, so it is not in the
+    // middle of a transfer when it gets reset
+    _stopRequested.store(true);
+    while(multicore_fifo_pop_blocking() != kCore1Stopped)
+        tight_loop_contents();
+
+    multicore_reset_core1();
+    _running = false;
+}
+
+bool QwiicOTOSDualCore::isRunning()
+{
+    return _running;
+}
+
+bool QwiicOTOSDualCore::getLatest(sfe_otos_sample_t &sample)
+{
+    uint32_t before;
+    uint32_t after;
+
+    do
+    {
+        // Wait out a write in progress
+        before = _sequence.load(std::memory_order_acquire);
+        if(before & 1)
+            continue;
+
+        sample = _latest;
+
+        // Check that core1 did not publish while we were copying
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = _sequence.load(std::memory_order_relaxed);
+    } while((before & 1) || before != after);
+
+    return before != 0;
+}
+
+uint32_t QwiicOTOSDualCore::getNumSamples()
+{
+    return _sequence.load(std::memory_order_acquire) / 2;
+}
+
+uint32_t QwiicOTOSDualCore::getNumErrors()
+{
+    return _numErrors.load(std::memory_order_relaxed);
+}
+
+void QwiicOTOSDualCore::core1Entry()
+{
+    // Let flash_safe_execute() on core0 pause this core, eg. while
+    // otosSnapshotSave() erases a sector
+    flash_safe_execute_core_init();
+
+    QwiicOTOSDualCore *self = (QwiicOTOSDualCore *)(uintptr_t)multicore_fifo_pop_blocking();
+    self->acquisitionLoop();
+
+    // Tell core0 we are done, then park until reset
+    multicore_fifo_push_blocking(kCore1Stopped);
+    while(true)
+        tight_loop_contents();
+}
+
+void QwiicOTOSDualCore::acquisitionLoop()
+{
+    absolute_time_t next = get_absolute_time();
+    sfe_otos_sample_t last = {};
+    bool haveLast = false;
+
+    while(!_stopRequested.load(std::memory_order_relaxed))
+    {
+        sfe_otos_sample_t sample;
+        sample.timestampUs = time_us_64();
+
+        if(_otos.getPosVelAcc(sample.pos, sample.vel, sample.acc) == kSTkErrOk)
+        {
+            sample.isRepeat = haveLast && sfeOtosSameReading(sample, last);
+            last = sample;
+            haveLast = true;
+            publish(sample);
+        }
+        else
+        {
+            _numErrors.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Keep a fixed rate regardless of how long the read took
+        next = delayed_by_us(next, _periodUs);
+        sleep_until(next);
+    }
+}
+
+void QwiicOTOSDualCore::publish(const sfe_otos_sample_t &sample)
+{
+    uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+
+    // Odd sequence marks the write in progress
+    _sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    _latest = sample;
+
+    _sequence.store(sequence + 2, std::memory_order_release);
+}
@@ -0,0 +1,131 @@
+#include "QwiicOtosFusion.h"
+
+QwiicOTOSFusion::QwiicOTOSFusion(sfe_otos_angular_unit_t angularUnit)
+    : _linearNoise{0.05f}, _angularNoise{0.05f}, _pose{0, 0, 0}, _p{}
+{
+    _unitToRad = sfeOtosUnitToRadians(angularUnit);
+    _halfTurn = sfeOtosHalfTurn(angularUnit);
+}
+
+void QwiicOTOSFusion::reset(const sfe_otos_pose2d_t &pose, const sfe_otos_pose2d_t &stdDev)
+{
+    _pose = pose;
+    _pose.h = sfeOtosWrapHeading(_pose.h, _halfTurn);
+
+    for(int i = 0; i < kNumCovariances; i++)
+        _p[i] = 0;
+    _p[kXX] = stdDev.x * stdDev.x;
+    _p[kYY] = stdDev.y * stdDev.y;
+    _p[kHH] = stdDev.h * stdDev.h;
+}
+
+void QwiicOTOSFusion::setOdometryNoise(float linearNoise, float angularNoise)
+{
+    _linearNoise = linearNoise;
+    _angularNoise = angularNoise;
+}
+
+void QwiicOTOSFusion::predict(const sfe_otos_pose2d_t &delta)
+{
+    // Rotate the delta into the field frame at the mid-point heading, which
+    // follows an arc better than the heading at either end
+    float midHeading = (_pose.h + 0.5f * delta.h) * _unitToRad;
+    float c = cosf(midHeading);
+    float s = sinf(midHeading);
+    float dx = c * delta.x - s * delta.y;
+    float dy = s * delta.x + c * delta.y;
+
+    _pose.x += dx;
+    _pose.y += dy;
+    _pose.h = sfeOtosWrapHeading(_pose.h + delta.h, _halfTurn);
+
+    // The Jacobian is the identity except for the dependence of the position on
+    // the heading, a = dx/dh and b = dy/dh, so F P F^T expands to a few terms
+    float a = -dy * _unitToRad;
+    float b = dx * _unitToRad;
+    float pxh = _p[kXH];
+    float pyh = _p[kYH];
+    float phh = _p[kHH];
+
+    _p[kXX] += 2 * a * pxh + a * a * phh;
+    _p[kXY] += a * pyh + b * pxh + a * b * phh;
+    _p[kXH] += a * phh;
+    _p[kYY] += 2 * b * pyh + b * b * phh;
+    _p[kYH] += b * phh;
+
+    // Odometry noise grows with the motion. The position noise is isotropic,
+    // so it needs no rotation into the field frame
+    float linear = _linearNoise * sqrtf(delta.x * delta.x + delta.y * delta.y);
+    float angular = _angularNoise * delta.h;
+    _p[kXX] += linear * linear;
+    _p[kYY] += linear * linear;
+    _p[kHH] += angular * angular;
+}
+
+bool QwiicOTOSFusion::update(const sfe_otos_pose2d_t &pos, const sfe_otos_pose2d_t &posStdDev)
+{
+    // The OTOS measures the state directly, so the innovation covariance is
+    // S = P + R and the gain K = P S^-1
+    float sxx = _p[kXX] + posStdDev.x * posStdDev.x;
+    float sxy = _p[kXY];
+    float sxh = _p[kXH];
+    float syy = _p[kYY] + posStdDev.y * posStdDev.y;
+    float syh = _p[kYH];
+    float shh = _p[kHH] + posStdDev.h * posStdDev.h;
+
+    // Inverse of the symmetric S from its cofactors
+    float cxx = syy * shh - syh * syh;
+    float cxy = sxh * syh - sxy * shh;
+    float cxh = sxy * syh - sxh * syy;
+    float det = sxx * cxx + sxy * cxy + sxh * cxh;
+    if(!(det > 0))
+        return false;
+
+    float invDet = 1.0f / det;
+    float m[3][3];
+    m[0][0] = cxx * invDet;
+    m[0][1] = m[1][0] = cxy * invDet;
+    m[0][2] = m[2][0] = cxh * invDet;
+    m[1][1] = (sxx * shh - sxh * sxh) * invDet;
+    m[1][2] = m[2][1] = (sxy * sxh - sxx * syh) * invDet;
+    m[2][2] = (sxx * syy - sxy * sxy) * invDet;
+
+    float p[3][3] = {{_p[kXX], _p[kXY], _p[kXH]}, {_p[kXY], _p[kYY], _p[kYH]}, {_p[kXH], _p[kYH], _p[kHH]}};
+
+    float k[3][3];
+    for(int i = 0; i < 3; i++)
+    {
+        for(int j = 0; j < 3; j++)
+            k[i][j] = p[i][0] * m[0][j] + p[i][1] * m[1][j] + p[i][2] * m[2][j];
+    }
+
+    float v[3] = {pos.x - _pose.x, pos.y - _pose.y, sfeOtosWrapHeading(pos.h - _pose.h, _halfTurn)};
+
+    _pose.x += k[0][0] * v[0] + k[0][1] * v[1] + k[0][2] * v[2];
+    _pose.y += k[1][0] * v[0] + k[1][1] * v[1] + k[1][2] * v[2];
+    _pose.h = sfeOtosWrapHeading(_pose.h + k[2][0] * v[0] + k[2][1] * v[1] + k[2][2] * v[2], _halfTurn);
+
+    // P = P - K P, only the unique terms
+    static const uint8_t rows[kNumCovariances] = {0, 0, 0, 1, 1, 2};
+    static const uint8_t cols[kNumCovariances] = {0, 1, 2, 1, 2, 2};
+    for(int n = 0; n < kNumCovariances; n++)
+    {
+        int i = rows[n];
+        int j = cols[n];
+        _p[n] = p[i][j] - (k[i][0] * p[0][j] + k[i][1] * p[1][j] + k[i][2] * p[2][j]);
+    }
+
+    return true;
+}
+
+void QwiicOTOSFusion::getPose(sfe_otos_pose2d_t &pose) const
+{
+    pose = _pose;
+}
+
+void QwiicOTOSFusion::getStdDev(sfe_otos_pose2d_t &stdDev) const
+{
+    stdDev.x = sqrtf(_p[kXX]);
+    stdDev.y = sqrtf(_p[kYY]);
+    stdDev.h = sqrtf(_p[kHH]);
+}
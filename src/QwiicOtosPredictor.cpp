@@ -0,0 +1,138 @@
+#include "QwiicOtosPredictor.h"
+
+// Turn angle below which the arc is integrated with its Taylor expansion, to
+// avoid dividing by a vanishing turn rate
+static constexpr float kSmallTurnRad = 1e-3f;
+
+QwiicOTOSPredictor::QwiicOTOSPredictor(sfe_otos_angular_unit_t angularUnit)
+    : _maxHorizonUs{20000}, _correctionUs{0}, _useAcceleration{true}, _state{}, _sequence{0}
+{
+    _unitToRad = sfeOtosUnitToRadians(angularUnit);
+    _halfTurn = sfeOtosHalfTurn(angularUnit);
+}
+
+void QwiicOTOSPredictor::reset()
+{
+    _sequence.store(0, std::memory_order_release);
+}
+
+void QwiicOTOSPredictor::setMaxHorizonUs(uint32_t horizonUs)
+{
+    _maxHorizonUs = horizonUs;
+}
+
+void QwiicOTOSPredictor::setCorrectionTimeUs(uint32_t correctionUs)
+{
+    _correctionUs = correctionUs;
+}
+
+void QwiicOTOSPredictor::setUseAcceleration(bool useAcceleration)
+{
+    _useAcceleration = useAcceleration;
+}
+
+void QwiicOTOSPredictor::extrapolate(const sfe_otos_sample_t &sample, float dt, sfe_otos_pose2d_t &pose) const
+{
+    // Heading swept during dt, in radians
+    float w = sample.vel.h * _unitToRad;
+    float turn = w * dt;
+
+    // Integrals of cos and sin of the swept heading over dt, which rotate the
+    // field frame velocity along the arc
+    float cosInt, sinInt;
+    if(fabsf(turn) < kSmallTurnRad)
+    {
+        cosInt = dt * (1.0f - turn * turn / 6.0f);
+        sinInt = dt * turn * 0.5f;
+    }
+    else
+    {
+        cosInt = sinf(turn) / w;
+        sinInt = (1.0f - cosf(turn)) / w;
+    }
+
+    pose.x = sample.pos.x + cosInt * sample.vel.x - sinInt * sample.vel.y;
+    pose.y = sample.pos.y + sinInt * sample.vel.x + cosInt * sample.vel.y;
+    pose.h = sample.pos.h + sample.vel.h * dt;
+
+    if(_useAcceleration)
+    {
+        // Rotating the velocity along the arc already accounts for the
+        // centripetal acceleration w x v, so only the tangential rest of the
+        // measured acceleration is integrated
+        float halfDt2 = 0.5f * dt * dt;
+        pose.x += (sample.acc.x + w * sample.vel.y) * halfDt2;
+        pose.y += (sample.acc.y - w * sample.vel.x) * halfDt2;
+        pose.h += sample.acc.h * halfDt2;
+    }
+
+    pose.h = sfeOtosWrapHeading(pose.h, _halfTurn);
+}
+
+bool QwiicOTOSPredictor::loadState(predictor_state_t &state) const
+{
+    uint32_t before;
+    uint32_t after;
+
+    do
+    {
+        before = _sequence.load(std::memory_order_acquire);
+        if(before == 0)
+            return false;
+
+        state = _state[before & 1];
+
+        // update() only writes the other state, unless it has published since
+        // we started copying
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = _sequence.load(std::memory_order_relaxed);
+    } while(before != after);
+
+    return true;
+}
+
+void QwiicOTOSPredictor::update(const sfe_otos_sample_t &sample)
+{
+    uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+    predictor_state_t &next = _state[(sequence + 1) & 1];
+
+    next.sample = sample;
+    next.correction = {0, 0, 0};
+
+    // Carry the difference between the prediction and the measurement over,
+    // to fade it out instead of jumping
+    sfe_otos_pose2d_t predicted;
+    if(_correctionUs && predictPose(sample.timestampUs, predicted))
+    {
+        next.correction.x = predicted.x - sample.pos.x;
+        next.correction.y = predicted.y - sample.pos.y;
+        next.correction.h = sfeOtosWrapHeading(predicted.h - sample.pos.h, _halfTurn);
+    }
+
+    _sequence.store((sequence + 1) ? sequence + 1 : 2, std::memory_order_release);
+}
+
+bool QwiicOTOSPredictor::predictPose(uint64_t nowUs, sfe_otos_pose2d_t &pose) const
+{
+    predictor_state_t state;
+    if(!loadState(state))
+        return false;
+
+    // Never extrapolate backwards, or past the horizon
+    uint64_t elapsedUs = (nowUs > state.sample.timestampUs) ? nowUs - state.sample.timestampUs : 0;
+    if(elapsedUs > _maxHorizonUs)
+        elapsedUs = _maxHorizonUs;
+
+    extrapolate(state.sample, elapsedUs * 1e-6f, pose);
+
+    // Fade out what is left of the correction
+    if(elapsedUs < _correctionUs)
+    {
+        float weight = 1.0f - (float)elapsedUs / _correctionUs;
+        pose.x += state.correction.x * weight;
+        pose.y += state.correction.y * weight;
+        pose.h = sfeOtosWrapHeading(pose.h + state.correction.h * weight, _halfTurn);
+    }
+
+    return true;
+}
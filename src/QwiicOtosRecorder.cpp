@@ -0,0 +1,348 @@
+#include "QwiicOtosRecorder.h"
+#include <atomic>
+
+static_assert(OTOS_RECORDER_BLOCK_SIZE % 8 == 0 && OTOS_RECORDER_BLOCK_SIZE >= 128,
+              "OTOS_RECORDER_BLOCK_SIZE must be a multiple of 8, at least 128");
+
+// Marks an arena prepared by begin(), "ORC2", with 32-bit registers
+static constexpr uint32_t kRecorderMagic = 0x3243524F;
+
+// Zig-zag folds small negative deltas into small unsigned values
+static inline uint32_t zigZag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t unZigZag(uint32_t value)
+{
+    return (int32_t)((value >> 1) ^ -(value & 1));
+}
+
+static void putVarint(uint8_t *&out, uint64_t value)
+{
+    while(value >= 0x80)
+    {
+        *out++ = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    *out++ = value;
+}
+
+// Returns false if the varint runs past end or beyond 64 bits
+static bool getVarint(const uint8_t *&in, const uint8_t *end, uint64_t &value)
+{
+    value = 0;
+    for(int shift = 0; shift < 64 && in < end; shift += 7)
+    {
+        uint8_t byte = *in++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if(!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// Keeps the compiler from reordering the arena writes, so a reset at any point
+// leaves a recording that scan() accepts
+static inline void arenaBarrier()
+{
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+QwiicOTOSRecorder::QwiicOTOSRecorder(void *arena, size_t size)
+    : _arena{(uint8_t *)arena}, _size{size}, _header{(recorder_header_t *)arena}, _numSamples{0},
+      _lastTimestampUs{0}, _lastRaw{}, _readBlock{0}, _readOffset{0}, _readSample{0}, _readTimestampUs{0},
+      _readRaw{}
+{
+}
+
+QwiicOTOSRecorder::recorder_block_t *QwiicOTOSRecorder::block(size_t index) const
+{
+    return (recorder_block_t *)(_arena + sizeof(recorder_header_t) + index * OTOS_RECORDER_BLOCK_SIZE);
+}
+
+uint8_t *QwiicOTOSRecorder::blockData(recorder_block_t *block) const
+{
+    return (uint8_t *)block + sizeof(recorder_block_t);
+}
+
+int QwiicOTOSRecorder::begin(sfe_otos_linear_unit_t linearUnit, sfe_otos_angular_unit_t angularUnit, bool resume)
+{
+    setLinearUnit(linearUnit);
+    setAngularUnit(angularUnit);
+
+    // The headers hold 64-bit fields, and the M0+ faults on unaligned access
+    size_t numBlocks = (_size > sizeof(recorder_header_t))
+                           ? (_size - sizeof(recorder_header_t)) / OTOS_RECORDER_BLOCK_SIZE
+                           : 0;
+    if(((uintptr_t)_arena & 7) || numBlocks < 2 || numBlocks > UINT16_MAX)
+        return kSTkErrFail;
+
+    bool valid = resume && _header->magic == kRecorderMagic && _header->blockSize == OTOS_RECORDER_BLOCK_SIZE &&
+                 _header->numBlocks == numBlocks && _header->first < numBlocks && _header->count <= numBlocks;
+
+    if(valid)
+    {
+        scan();
+    }
+    else
+    {
+        _header->magic = 0;
+        arenaBarrier();
+        _header->blockSize = OTOS_RECORDER_BLOCK_SIZE;
+        _header->numBlocks = numBlocks;
+        _header->reserved = 0;
+        clear();
+        arenaBarrier();
+        _header->magic = kRecorderMagic;
+    }
+
+    rewind();
+
+    // Done!
+    return kSTkErrOk;
+}
+
+void QwiicOTOSRecorder::clear()
+{
+    _header->count = 0;
+    _header->first = 0;
+    _numSamples = 0;
+    rewind();
+}
+
+size_t QwiicOTOSRecorder::decodeDelta(const uint8_t *data, uint64_t &timestampUs, int32_t raw[9], bool &isRepeat)
+{
+    const uint8_t *in = data;
+    const uint8_t *end = data + kMaxDeltaBytes;
+
+    uint64_t value;
+    if(!getVarint(in, end, value))
+        return 0;
+    timestampUs += value >> 1;
+    isRepeat = value & 1;
+
+    for(int i = 0; i < 9; i++)
+    {
+        if(!getVarint(in, end, value) || value > UINT32_MAX)
+            return 0;
+        raw[i] = (int32_t)((uint32_t)raw[i] + (uint32_t)unZigZag(value));
+    }
+
+    return in - data;
+}
+
+void QwiicOTOSRecorder::scan()
+{
+    // Drop whatever a reset interrupted: blocks without a sample end the
+    // recording, and the deltas of each block stop at the first bad one
+    _numSamples = 0;
+    for(size_t n = 0; n < _header->count; n++)
+    {
+        recorder_block_t *b = block((_header->first + n) % _header->numBlocks);
+        if(b->numSamples == 0 || b->used > kBlockData)
+        {
+            _header->count = n;
+            break;
+        }
+
+        _lastTimestampUs = b->timestampUs;
+        memcpy(_lastRaw, b->raw, sizeof(_lastRaw));
+
+        // Deltas are decoded into a scratch copy of the block, which ends with
+        // enough slack for the longest one
+        uint8_t data[kBlockData + kMaxDeltaBytes] = {};
+        memcpy(data, blockData(b), b->used);
+
+        size_t offset = 0;
+        uint16_t numSamples = 1;
+        while(numSamples < b->numSamples)
+        {
+            // A torn delta must not leave its values as the last sample
+            uint64_t timestampUs = _lastTimestampUs;
+            int32_t raw[9];
+            memcpy(raw, _lastRaw, sizeof(raw));
+            bool isRepeat;
+            size_t length = decodeDelta(data + offset, timestampUs, raw, isRepeat);
+            if(length == 0 || offset + length > b->used)
+                break;
+            _lastTimestampUs = timestampUs;
+            memcpy(_lastRaw, raw, sizeof(_lastRaw));
+            offset += length;
+            numSamples++;
+        }
+
+        b->numSamples = numSamples;
+        b->used = offset;
+        _numSamples += numSamples;
+    }
+}
+
+void QwiicOTOSRecorder::startBlock(uint64_t timestampUs, const int32_t raw[9], bool isRepeat)
+{
+    // Reuse the oldest block once the arena is full. It leaves the recording
+    // before it is overwritten
+    if(_header->count == _header->numBlocks)
+    {
+        _numSamples -= block(_header->first)->numSamples;
+        _header->first = (_header->first + 1) % _header->numBlocks;
+        _header->count--;
+        arenaBarrier();
+    }
+
+    recorder_block_t *b = block((_header->first + _header->count) % _header->numBlocks);
+    b->timestampUs = timestampUs;
+    memcpy(b->raw, raw, sizeof(b->raw));
+    b->numSamples = 1;
+    b->used = 0;
+    b->isRepeat = isRepeat;
+    b->reserved = 0;
+    arenaBarrier();
+
+    _header->count++;
+    _numSamples++;
+}
+
+void QwiicOTOSRecorder::record(const sfe_otos_sample_t &sample)
+{
+    const sfe_otos_pose2d_t *poses[3] = {&sample.pos, &sample.vel, &sample.acc};
+    int32_t raw[9];
+
+    // Continuous positions go past the registers, the other groups cannot
+    const sfe_otos_conversion_t &posFactors = conversion(0);
+    raw[0] = sfeOtosToCounts(sample.pos.x, posFactors.xyToRaw);
+    raw[1] = sfeOtosToCounts(sample.pos.y, posFactors.xyToRaw);
+    raw[2] = sfeOtosToCounts(sample.pos.h, posFactors.hToRaw);
+    for(int group = 1; group < 3; group++)
+    {
+        const sfe_otos_conversion_t &factors = conversion(group);
+        raw[group * 3 + 0] = sfeOtosToRaw(poses[group]->x, factors.xyToRaw);
+        raw[group * 3 + 1] = sfeOtosToRaw(poses[group]->y, factors.xyToRaw);
+        raw[group * 3 + 2] = sfeOtosToRaw(poses[group]->h, factors.hToRaw);
+    }
+
+    append(sample.timestampUs, raw, sample.isRepeat);
+}
+
+void QwiicOTOSRecorder::recordRaw(uint64_t timestampUs, const int16_t raw[9], bool isRepeat)
+{
+    int32_t wide[9];
+    for(int i = 0; i < 9; i++)
+        wide[i] = raw[i];
+    append(timestampUs, wide, isRepeat);
+}
+
+void QwiicOTOSRecorder::append(uint64_t timestampUs, const int32_t raw[9], bool isRepeat)
+{
+    // Deltas need a previous sample in the same block, and time moving forward
+    if(_header->count == 0 || timestampUs < _lastTimestampUs)
+    {
+        startBlock(timestampUs, raw, isRepeat);
+    }
+    else
+    {
+        uint8_t delta[kMaxDeltaBytes];
+        uint8_t *out = delta;
+        putVarint(out, ((timestampUs - _lastTimestampUs) << 1) | isRepeat);
+        for(int i = 0; i < 9; i++)
+            putVarint(out, zigZag((int32_t)((uint32_t)raw[i] - (uint32_t)_lastRaw[i])));
+        size_t length = out - delta;
+
+        recorder_block_t *b = block((_header->first + _header->count - 1) % _header->numBlocks);
+        if(b->used + length > kBlockData || b->numSamples == UINT16_MAX)
+        {
+            startBlock(timestampUs, raw, isRepeat);
+        }
+        else
+        {
+            // The data first, then its length, then the count that makes it
+            // part of the recording
+            memcpy(blockData(b) + b->used, delta, length);
+            arenaBarrier();
+            b->used += length;
+            arenaBarrier();
+            b->numSamples++;
+            _numSamples++;
+        }
+    }
+
+    _lastTimestampUs = timestampUs;
+    memcpy(_lastRaw, raw, sizeof(_lastRaw));
+}
+
+void QwiicOTOSRecorder::rewind()
+{
+    _readBlock = 0;
+    _readOffset = 0;
+    _readSample = 0;
+}
+
+bool QwiicOTOSRecorder::nextRaw(uint64_t &timestampUs, int16_t raw[9], bool &isRepeat)
+{
+    int32_t wide[9];
+    if(!nextCounts(timestampUs, wide, isRepeat))
+        return false;
+
+    for(int i = 0; i < 9; i++)
+        raw[i] = (int16_t)wide[i];
+    return true;
+}
+
+bool QwiicOTOSRecorder::nextCounts(uint64_t &timestampUs, int32_t raw[9], bool &isRepeat)
+{
+    while(_readBlock < _header->count)
+    {
+        recorder_block_t *b = block((_header->first + _readBlock) % _header->numBlocks);
+
+        if(_readSample == 0)
+        {
+            _readTimestampUs = b->timestampUs;
+            memcpy(_readRaw, b->raw, sizeof(_readRaw));
+            isRepeat = b->isRepeat;
+        }
+        else if(_readSample < b->numSamples)
+        {
+            _readOffset += decodeDelta(blockData(b) + _readOffset, _readTimestampUs, _readRaw, isRepeat);
+        }
+        else
+        {
+            _readBlock++;
+            _readOffset = 0;
+            _readSample = 0;
+            continue;
+        }
+
+        _readSample++;
+        timestampUs = _readTimestampUs;
+        memcpy(raw, _readRaw, sizeof(_readRaw));
+        return true;
+    }
+
+    return false;
+}
+
+bool QwiicOTOSRecorder::next(sfe_otos_sample_t &sample)
+{
+    int32_t raw[9];
+    if(!nextCounts(sample.timestampUs, raw, sample.isRepeat))
+        return false;
+
+    sfe_otos_pose2d_t *poses[3] = {&sample.pos, &sample.vel, &sample.acc};
+    for(int group = 0; group < 3; group++)
+        sfeOtosFromRaw(raw + group * 3, conversion(group), *poses[group]);
+
+    return true;
+}
+
+size_t QwiicOTOSRecorder::getNumSamples() const
+{
+    return _numSamples;
+}
+
+size_t QwiicOTOSRecorder::getUsedBytes() const
+{
+    size_t used = 0;
+    for(size_t n = 0; n < _header->count; n++)
+        used += sizeof(recorder_block_t) + block((_header->first + n) % _header->numBlocks)->used;
+    return used;
+}
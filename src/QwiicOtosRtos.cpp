@@ -0,0 +1,321 @@
+#include "QwiicOtosRtos.h"
+#include "utils.h"
+
+// Whether tasks can run concurrently yet, locking is pointless before
+static inline bool schedulerStarted()
+{
+    return xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED;
+}
+
+OtosRtosBusLock::OtosRtosBusLock() : _mutex{xSemaphoreCreateMutex()}
+{
+}
+
+OtosRtosBusLock::~OtosRtosBusLock()
+{
+    if(_mutex)
+        vSemaphoreDelete(_mutex);
+}
+
+bool OtosRtosBusLock::lock(TickType_t timeout)
+{
+    if(!schedulerStarted())
+        return true;
+
+    return _mutex && xSemaphoreTake(_mutex, timeout) == pdTRUE;
+}
+
+void OtosRtosBusLock::unlock()
+{
+    if(schedulerStarted())
+        xSemaphoreGive(_mutex);
+}
+
+OtosRtosBus::OtosRtosBus(sfeOtosTransport &bus, OtosRtosBusLock &lock, TickType_t timeout)
+    : _bus{bus}, _lock{lock}, _timeout{timeout}
+{
+}
+
+int OtosRtosBus::ping()
+{
+    if(!_lock.lock(_timeout))
+        return kSTkErrBusBusy;
+    int result = _bus.ping();
+    _lock.unlock();
+    return result;
+}
+
+int OtosRtosBus::readRegisterByte(uint8_t devReg, uint8_t &dataToRead)
+{
+    if(!_lock.lock(_timeout))
+        return kSTkErrBusBusy;
+    int result = _bus.readRegisterByte(devReg, dataToRead);
+    _lock.unlock();
+    return result;
+}
+
+int OtosRtosBus::readRegisterRegion(uint8_t devReg, uint8_t *data, size_t numBytes, size_t &readBytes)
+{
+    readBytes = 0;
+    if(!_lock.lock(_timeout))
+        return kSTkErrBusBusy;
+    int result = _bus.readRegisterRegion(devReg, data, numBytes, readBytes);
+    _lock.unlock();
+    return result;
+}
+
+int OtosRtosBus::writeRegisterByte(uint8_t devReg, uint8_t dataToWrite)
+{
+    if(!_lock.lock(_timeout))
+        return kSTkErrBusBusy;
+    int result = _bus.writeRegisterByte(devReg, dataToWrite);
+    _lock.unlock();
+    return result;
+}
+
+int OtosRtosBus::writeRegisterRegion(uint8_t devReg, const uint8_t *data, size_t length)
+{
+    if(!_lock.lock(_timeout))
+        return kSTkErrBusBusy;
+    int result = _bus.writeRegisterRegion(devReg, data, length);
+    _lock.unlock();
+    return result;
+}
+
+int OtosRtosBus::startReadRegisterRegionDma(uint8_t devReg, uint8_t *data, size_t numBytes)
+{
+    if(!_lock.lock(_timeout))
+        return kSTkErrBusBusy;
+    int result = _bus.startReadRegisterRegionDma(devReg, data, numBytes);
+    _lock.unlock();
+    return result;
+}
+
+int OtosRtosBus::pollReadRegisterRegionDma(size_t &readBytes)
+{
+    readBytes = 0;
+    if(!_lock.lock(_timeout))
+        return kSTkErrBusBusy;
+    int result = _bus.pollReadRegisterRegionDma(readBytes);
+    _lock.unlock();
+    return result;
+}
+
+QwiicOTOSRtos::QwiicOTOSRtos(sfeQwiicOtos &otos)
+    : _otos{otos}, _task{nullptr}, _queue{nullptr}, _priority{0}, _state{nullptr}, _pending{0}, _numRequests{0},
+      _numTransactions{0}
+{
+}
+
+QwiicOTOSRtos::~QwiicOTOSRtos()
+{
+    stop();
+}
+
+int QwiicOTOSRtos::start(UBaseType_t priority, configSTACK_DEPTH_TYPE stackDepth)
+{
+    // Check if already running
+    if(_task)
+        return kSTkErrFail;
+
+    _queue = xQueueCreate(OTOS_RTOS_QUEUE_LENGTH, sizeof(otos_rtos_request_t *));
+    _state = xSemaphoreCreateMutex();
+    _priority = priority;
+    _pending = 0;
+    _numRequests = 0;
+    _numTransactions = 0;
+
+    if(!_queue || !_state || xTaskCreate(serverEntry, "otos", stackDepth, this, priority, &_task) != pdPASS)
+    {
+        _task = nullptr;
+        stop();
+        return kSTkErrFail;
+    }
+
+    // Done!
+    return kSTkErrOk;
+}
+
+void QwiicOTOSRtos::stop()
+{
+    // The stop request is served after every request queued before it, and
+    // the server deletes itself once it has answered
+    if(_task)
+    {
+        otos_rtos_request_t request = {};
+        submit(request);
+        _task = nullptr;
+    }
+
+    if(_queue)
+    {
+        vQueueDelete(_queue);
+        _queue = nullptr;
+    }
+
+    if(_state)
+    {
+        vSemaphoreDelete(_state);
+        _state = nullptr;
+    }
+}
+
+int QwiicOTOSRtos::read(uint8_t groups, sfe_otos_pose_groups_t &out)
+{
+    if(!_task)
+        return kSTkErrFail;
+
+    // Nothing to read
+    if((groups & kSfeOtosGroupAll) == 0)
+        return kSTkErrOk;
+
+    otos_rtos_request_t request = {};
+    request.groups = groups & kSfeOtosGroupAll;
+    request.out = &out;
+    return submit(request);
+}
+
+int QwiicOTOSRtos::getPosVelAcc(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc)
+{
+    sfe_otos_pose_groups_t out;
+    int err = read(kSfeOtosGroupPos | kSfeOtosGroupVel | kSfeOtosGroupAcc, out);
+    if(err != kSTkErrOk)
+        return err;
+
+    pos = out.pos;
+    vel = out.vel;
+    acc = out.acc;
+
+    // Done!
+    return kSTkErrOk;
+}
+
+int QwiicOTOSRtos::execute(int (*function)(sfeQwiicOtos &otos, void *context), void *context)
+{
+    if(!_task || !function)
+        return kSTkErrFail;
+
+    otos_rtos_request_t request = {};
+    request.function = function;
+    request.context = context;
+    return submit(request);
+}
+
+int QwiicOTOSRtos::submit(otos_rtos_request_t &request)
+{
+    request.task = xTaskGetCurrentTaskHandle();
+    request.result = kSTkErrFail;
+    otos_rtos_request_t *pointer = &request;
+
+    // Lend the server our priority while it works for us. It is only lowered
+    // again once nothing is pending, see serve()
+    xSemaphoreTake(_state, portMAX_DELAY);
+    _pending++;
+    UBaseType_t priority = uxTaskPriorityGet(nullptr);
+    if(priority > uxTaskPriorityGet(_task))
+        vTaskPrioritySet(_task, priority);
+    xSemaphoreGive(_state);
+
+    // The request lives on this stack, so the wait cannot time out: the bus
+    // retry policy bounds how long the server takes
+    xQueueSend(_queue, &pointer, portMAX_DELAY);
+    ulTaskNotifyTakeIndexed(OTOS_RTOS_NOTIFY_INDEX, pdTRUE, portMAX_DELAY);
+
+    return request.result;
+}
+
+void QwiicOTOSRtos::serverEntry(void *parameter)
+{
+    ((QwiicOTOSRtos *)parameter)->serve();
+    vTaskDelete(nullptr);
+}
+
+void QwiicOTOSRtos::reply(otos_rtos_request_t *request, int result)
+{
+    request->result = result;
+    xTaskNotifyGiveIndexed(request->task, OTOS_RTOS_NOTIFY_INDEX);
+}
+
+void QwiicOTOSRtos::serveReads(otos_rtos_request_t **batch, size_t count)
+{
+    if(count == 0)
+        return;
+
+    uint8_t groups = 0;
+    for(size_t i = 0; i < count; i++)
+        groups |= batch[i]->groups;
+
+    sfe_otos_pose_groups_t data;
+    int err = _otos.read(groups, data);
+    _numTransactions++;
+
+    // Only the requested groups of each destination are written
+    const sfe_otos_pose2d_t *from[6] = {&data.pos,       &data.vel,       &data.acc,
+                                        &data.posStdDev, &data.velStdDev, &data.accStdDev};
+    for(size_t i = 0; i < count; i++)
+    {
+        sfe_otos_pose_groups_t *out = batch[i]->out;
+        sfe_otos_pose2d_t *to[6] = {&out->pos, &out->vel, &out->acc, &out->posStdDev, &out->velStdDev, &out->accStdDev};
+        if(err == kSTkErrOk)
+        {
+            for(int g = 0; g < 6; g++)
+            {
+                if(batch[i]->groups & (1 << g))
+                    *to[g] = *from[g];
+            }
+        }
+        reply(batch[i], err);
+    }
+}
+
+void QwiicOTOSRtos::serve()
+{
+    otos_rtos_request_t *request = nullptr;
+
+    while(true)
+    {
+        if(!request)
+            xQueueReceive(_queue, &request, portMAX_DELAY);
+
+        // Take every read already waiting, up to the first other request,
+        // which has to run after them
+        otos_rtos_request_t *batch[OTOS_RTOS_QUEUE_LENGTH];
+        size_t count = 0;
+        size_t received = 1;
+        while(request && request->groups)
+        {
+            batch[count++] = request;
+            request = nullptr;
+            if(count == OTOS_RTOS_QUEUE_LENGTH || xQueueReceive(_queue, &request, 0) != pdTRUE)
+                break;
+            received++;
+        }
+
+        xSemaphoreTake(_state, portMAX_DELAY);
+        _pending -= received;
+        _numRequests += count;
+        xSemaphoreGive(_state);
+
+        serveReads(batch, count);
+
+        if(request)
+        {
+            otos_rtos_request_t *other = request;
+            request = nullptr;
+
+            if(!other->function)
+            {
+                reply(other, kSTkErrOk);
+                return;
+            }
+
+            reply(other, other->function(_otos, other->context));
+        }
+
+        // Back to the base priority once nobody is waiting for the server
+        xSemaphoreTake(_state, portMAX_DELAY);
+        if(_pending == 0)
+            vTaskPrioritySet(nullptr, _priority);
+        xSemaphoreGive(_state);
+    }
+}
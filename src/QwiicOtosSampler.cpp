@@ -0,0 +1,380 @@
+#include "QwiicOtosSampler.h"
+#include "pico/stdlib.h"
+
+QwiicOTOSSampler::QwiicOTOSSampler(sfeQwiicOtos &otos)
+    : _otos{otos}, _timer{}, _running{false}, _periodUs{0}, _policy{kOtosSamplerReadAlways}, _pending{kPendingNone},
+      _pendingTimestampUs{0}, _trackingLost{false}, _idlePeriodUs{0}, _stillLinear{0}, _stillAngular{0},
+      _stillSamples{0}, _stillCount{0}, _idle{false}, _idleRead{false}, _batchSize{1}, _unsignalled{0},
+      _dropRepeats{false}, _haveLast{false}, _last{},
+      _callback{nullptr}, _callbackContext{nullptr}, _numDropped{0}, _numErrors{0}, _numInvalid{0}, _numRepeats{0}
+{
+    sem_init(&_newSample, 0, 1);
+}
+
+QwiicOTOSSampler::~QwiicOTOSSampler()
+{
+    stop();
+}
+
+int QwiicOTOSSampler::start(uint32_t periodUs)
+{
+    // Check if already running
+    if(_running)
+        return kSTkErrFail;
+
+    // Each idle wake needs a regular period to collect its read
+    if(_idlePeriodUs != 0 && _idlePeriodUs <= periodUs)
+        return kSTkErrFail;
+
+    _periodUs = periodUs;
+    _stillCount = 0;
+    _idle = false;
+    _idleRead = false;
+    _unsignalled = 0;
+    _pending = kPendingNone;
+    _trackingLost = false;
+    _haveLast = false;
+    sem_reset(&_newSample, 0);
+    _running = true;
+
+    // A negative delay keeps a fixed rate from one callback start to the next,
+    // regardless of how long the callback takes
+    if(!add_repeating_timer_us(-(int64_t)periodUs, timerCallback, this, &_timer))
+    {
+        _running = false;
+        return kSTkErrFail;
+    }
+
+    // Done!
+    return kSTkErrOk;
+}
+
+int QwiicOTOSSampler::setPolicy(otos_sampler_policy_t policy)
+{
+    // The policy decides which read is on the bus, so it cannot change under
+    // the timer
+    if(_running)
+        return kSTkErrFail;
+
+    _policy = policy;
+
+    // Done!
+    return kSTkErrOk;
+}
+
+int QwiicOTOSSampler::setDropRepeats(bool drop)
+{
+    if(_running)
+        return kSTkErrFail;
+
+    _dropRepeats = drop;
+
+    // Done!
+    return kSTkErrOk;
+}
+
+int QwiicOTOSSampler::setIdleRate(uint32_t idlePeriodUs, float linearThreshold, float angularThreshold,
+                                  uint16_t stillSamples)
+{
+    // The timer switches between the rates on its own
+    if(_running)
+        return kSTkErrFail;
+
+    _idlePeriodUs = idlePeriodUs;
+    _stillLinear = linearThreshold;
+    _stillAngular = angularThreshold;
+    _stillSamples = stillSamples ? stillSamples : 1;
+
+    // Done!
+    return kSTkErrOk;
+}
+
+int QwiicOTOSSampler::setBatchSize(size_t numSamples)
+{
+    if(_running || numSamples == 0 || numSamples > OTOS_SAMPLER_BUFFER_SIZE)
+        return kSTkErrFail;
+
+    _batchSize = numSamples;
+
+    // Done!
+    return kSTkErrOk;
+}
+
+bool QwiicOTOSSampler::isIdle()
+{
+    return _idle;
+}
+
+int QwiicOTOSSampler::setSampleCallback(void (*callback)(void *context), void *context)
+{
+    // The timer may call the callback at any time while running
+    if(_running)
+        return kSTkErrFail;
+
+    _callback = callback;
+    _callbackContext = context;
+
+    // Done!
+    return kSTkErrOk;
+}
+
+void QwiicOTOSSampler::stop()
+{
+    if(!_running)
+        return;
+
+    cancel_repeating_timer(&_timer);
+    _running = false;
+
+    // Let the last read finish so the bus is free again. Its result is
+    // discarded, since it would arrive out of period anyway
+    if(_pending != kPendingNone)
+    {
+        sfe_otos_sample_t sample;
+        sfe_otos_validity_t validity;
+        while(pollPending(sample, validity) == kSTkErrBusBusy)
+            tight_loop_contents();
+        _pending = kPendingNone;
+    }
+}
+
+int QwiicOTOSSampler::serviceRebase()
+{
+    if(!_otos.isRebaseDue())
+        return kSTkErrOk;
+
+    if(!_running)
+        return _otos.serviceRebase();
+
+    // The timer must not start a read in the middle of the write
+    uint32_t periodUs = _periodUs;
+    stop();
+    int err = _otos.serviceRebase();
+    int restarted = start(periodUs);
+    return (err != kSTkErrOk) ? err : restarted;
+}
+
+bool QwiicOTOSSampler::isRunning()
+{
+    return _running;
+}
+
+bool QwiicOTOSSampler::getSample(sfe_otos_sample_t &sample)
+{
+    return _samples.pop(sample);
+}
+
+bool QwiicOTOSSampler::waitForSample(uint32_t timeoutUs)
+{
+    return sem_acquire_timeout_us(&_newSample, timeoutUs);
+}
+
+size_t QwiicOTOSSampler::getNumSamples()
+{
+    return _samples.size();
+}
+
+uint32_t QwiicOTOSSampler::getNumDropped()
+{
+    return _numDropped;
+}
+
+uint32_t QwiicOTOSSampler::getNumErrors()
+{
+    return _numErrors;
+}
+
+uint32_t QwiicOTOSSampler::getNumInvalid()
+{
+    return _numInvalid;
+}
+
+uint32_t QwiicOTOSSampler::getNumRepeats()
+{
+    return _numRepeats;
+}
+
+bool QwiicOTOSSampler::timerCallback(repeating_timer_t *rt)
+{
+    QwiicOTOSSampler *sampler = static_cast<QwiicOTOSSampler *>(rt->user_data);
+    sampler->onTimer();
+    return sampler->_running;
+}
+
+void QwiicOTOSSampler::setDelay(uint32_t delayUs)
+{
+    // The SDK reschedules with the delay of the timer after every callback,
+    // negative from the previous tick's target, so the rate stays fixed
+    _timer.delay_us = -(int64_t)delayUs;
+}
+
+bool QwiicOTOSSampler::updateIdle(const sfe_otos_sample_t &sample)
+{
+    if(_idlePeriodUs == 0)
+        return false;
+
+    bool still = fabsf(sample.vel.x) < _stillLinear && fabsf(sample.vel.y) < _stillLinear &&
+                 fabsf(sample.vel.h) < _stillAngular;
+
+    if(still)
+    {
+        // The read just collected counts as the first idle one, so this tick
+        // goes straight to sleep
+        if(!_idle && ++_stillCount >= _stillSamples)
+        {
+            _idle = true;
+            _idleRead = true;
+        }
+        return false;
+    }
+
+    _stillCount = 0;
+    if(!_idle)
+        return false;
+
+    _idle = false;
+    setDelay(_periodUs);
+    return true;
+}
+
+void QwiicOTOSSampler::queue(sfe_otos_sample_t &sample, bool wakeNow)
+{
+    // Identical registers mean the OTOS has not updated since the last read
+    sample.isRepeat = _haveLast && sfeOtosSameReading(sample, _last);
+    _last = sample;
+    _haveLast = true;
+
+    if(sample.isRepeat)
+    {
+        _numRepeats = _numRepeats + 1;
+        if(_dropRepeats)
+            return;
+    }
+
+    if(!_samples.push(sample))
+    {
+        _numDropped = _numDropped + 1;
+        return;
+    }
+
+    // Only wake the consumers for new data, and once per batch unless it
+    // would wait for several idle periods
+    if(!sample.isRepeat && (++_unsignalled >= _batchSize || wakeNow || _idle))
+    {
+        _unsignalled = 0;
+        sem_release(&_newSample);
+        if(_callback)
+            _callback(_callbackContext);
+    }
+}
+
+int QwiicOTOSSampler::pollPending(sfe_otos_sample_t &sample, sfe_otos_validity_t &validity)
+{
+    validity = kSfeOtosSampleValid;
+
+    switch(_pending)
+    {
+    case kPendingPose:
+        return _otos.pollPosVelAccAsync(sample.pos, sample.vel, sample.acc);
+
+    case kPendingChecked:
+        return _otos.pollPosVelAccCheckedAsync(sample.pos, sample.vel, sample.acc, validity);
+
+    case kPendingStatus:
+    {
+        // Only the status was read, so there is no sample either way
+        sfe_otos_status_t status;
+        int err = _otos.pollStatusAsync(status);
+        if(err == kSTkErrOk)
+            validity = sfeQwiicOtos::getStatusValidity(status);
+        return err;
+    }
+
+    default:
+        return kSTkErrFail;
+    }
+}
+
+void QwiicOTOSSampler::onTimer()
+{
+    // Collect the read started on the previous tick
+    if(_pending != kPendingNone)
+    {
+        sfe_otos_sample_t sample;
+        sfe_otos_validity_t validity;
+        int err = pollPending(sample, validity);
+
+        // Still on the bus, the period is too short. Skip this tick rather
+        // than stalling the timer interrupt
+        if(err == kSTkErrBusBusy)
+        {
+            _numErrors = _numErrors + 1;
+            return;
+        }
+
+        bool statusOnly = (_pending == kPendingStatus);
+        _pending = kPendingNone;
+
+        if(err != kSTkErrOk)
+        {
+            _numErrors = _numErrors + 1;
+        }
+        else
+        {
+            _trackingLost = (validity != kSfeOtosSampleValid);
+
+            if(_trackingLost)
+            {
+                _numInvalid = _numInvalid + 1;
+            }
+            else if(!statusOnly)
+            {
+                sample.timestampUs = _pendingTimestampUs;
+                bool resumed = updateIdle(sample);
+                queue(sample, resumed);
+            }
+        }
+    }
+
+    // While idle, a wake only starts a read. The next tick, one regular
+    // period later, collects it and leaves the core asleep until the next
+    // wake, unless the sample showed motion
+    if(_idle)
+    {
+        if(_idleRead)
+        {
+            _idleRead = false;
+            setDelay(_idlePeriodUs - _periodUs);
+            return;
+        }
+
+        _idleRead = true;
+        setDelay(_periodUs);
+    }
+
+    // Start the next read, just the status while tracking is lost if the
+    // policy says so
+    int err;
+    uint8_t pending;
+    _pendingTimestampUs = time_us_64();
+    if(_policy == kOtosSamplerReadAlways)
+    {
+        err = _otos.startPosVelAccAsync();
+        pending = kPendingPose;
+    }
+    else if(_policy == kOtosSamplerSkipWhenLost && _trackingLost)
+    {
+        err = _otos.startStatusAsync();
+        pending = kPendingStatus;
+    }
+    else
+    {
+        err = _otos.startPosVelAccCheckedAsync();
+        pending = kPendingChecked;
+    }
+
+    if(err == kSTkErrOk)
+        _pending = pending;
+    else
+        _numErrors = _numErrors + 1;
+}
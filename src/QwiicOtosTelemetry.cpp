@@ -0,0 +1,310 @@
+#include "QwiicOtosTelemetry.h"
+
+// Payload lengths of each frame type
+static constexpr size_t kHeaderPayload = 3;
+static constexpr size_t kTimePayload = 8 + 12;
+static constexpr size_t kSamplePayload = 2 + 18;
+
+// Register groups in a sample frame, position, velocity and acceleration
+static constexpr int kNumGroups = 3;
+
+// Sync, type, and CRC around every payload
+static constexpr size_t kFrameOverhead = 4;
+
+// CRC-16/CCITT-FALSE, a nibble at a time so the table stays small
+static uint16_t crc16(const uint8_t *data, size_t length)
+{
+    static const uint16_t table[16] = {0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+                                       0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF};
+
+    uint16_t crc = 0xFFFF;
+    for(size_t i = 0; i < length; i++)
+    {
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+    return crc;
+}
+
+// Writes the sync byte and type, returns where the payload goes
+static uint8_t *beginFrame(uint8_t *out, uint8_t type)
+{
+    out[0] = kOtosTelemetrySync;
+    out[1] = type;
+    return out + 2;
+}
+
+// Appends the CRC of the type and payload, returns the frame length
+static size_t endFrame(uint8_t *out, size_t payloadLength)
+{
+    uint16_t crc = crc16(out + 1, 1 + payloadLength);
+    out[2 + payloadLength] = crc & 0xFF;
+    out[3 + payloadLength] = crc >> 8;
+    return payloadLength + kFrameOverhead;
+}
+
+static void putRaw(uint8_t *&out, int16_t raw)
+{
+    *out++ = raw & 0xFF;
+    *out++ = (raw >> 8) & 0xFF;
+}
+
+QwiicOTOSTelemetryEncoder::QwiicOTOSTelemetryEncoder(sfe_otos_linear_unit_t linearUnit,
+                                                     sfe_otos_angular_unit_t angularUnit)
+    : _resyncInterval{256}, _sinceResync{0}, _lastTimestampUs{0}, _origin{}
+{
+    setLinearUnit(linearUnit);
+    setAngularUnit(angularUnit);
+    resync();
+}
+
+void QwiicOTOSTelemetryEncoder::setResyncInterval(uint32_t numSamples)
+{
+    _resyncInterval = numSamples;
+}
+
+void QwiicOTOSTelemetryEncoder::resync()
+{
+    _sinceResync = _resyncInterval;
+}
+
+size_t QwiicOTOSTelemetryEncoder::encodeHeader(uint8_t *out)
+{
+    uint8_t *payload = beginFrame(out, kOtosTelemetryHeader);
+    payload[0] = kOtosTelemetryVersion;
+    payload[1] = _linearUnit;
+    payload[2] = _angularUnit;
+    return endFrame(out, kHeaderPayload);
+}
+
+size_t QwiicOTOSTelemetryEncoder::encodeTime(uint64_t timestampUs, uint8_t *out)
+{
+    uint8_t *payload = beginFrame(out, kOtosTelemetryTime);
+    for(int i = 0; i < 8; i++)
+        payload[i] = (timestampUs >> (8 * i)) & 0xFF;
+    for(int i = 0; i < 3; i++)
+    {
+        for(int j = 0; j < 4; j++)
+            payload[8 + 4 * i + j] = ((uint32_t)_origin[i] >> (8 * j)) & 0xFF;
+    }
+    return endFrame(out, kTimePayload);
+}
+
+size_t QwiicOTOSTelemetryEncoder::encode(const sfe_otos_sample_t &sample, uint8_t *out)
+{
+    size_t length = 0;
+
+    // Continuous positions overflow the registers. Their low 16 bits are sent
+    // as the registers, the rest as the origin of the time frame
+    const sfe_otos_conversion_t &posFactors = conversion(0);
+    int32_t counts[3] = {sfeOtosToCounts(sample.pos.x, posFactors.xyToRaw),
+                         sfeOtosToCounts(sample.pos.y, posFactors.xyToRaw),
+                         sfeOtosToCounts(sample.pos.h, posFactors.hToRaw)};
+    bool sendTime = false;
+    for(int i = 0; i < 3; i++)
+    {
+        int32_t origin = (int32_t)((uint32_t)counts[i] - (uint32_t)(int32_t)(int16_t)counts[i]);
+        if(origin != _origin[i])
+        {
+            _origin[i] = origin;
+            sendTime = true;
+        }
+    }
+
+    // Repeat the header now and then for decoders joining late, and restart
+    // the timestamps whenever the delta would not fit
+    if(_sinceResync >= _resyncInterval)
+    {
+        length += encodeHeader(out);
+        sendTime = true;
+        _sinceResync = 0;
+    }
+    if(sendTime || sample.timestampUs < _lastTimestampUs || sample.timestampUs - _lastTimestampUs > 0xFFFF)
+    {
+        length += encodeTime(sample.timestampUs, out + length);
+        _lastTimestampUs = sample.timestampUs;
+    }
+
+    uint8_t type = kOtosTelemetrySample | (sample.isRepeat ? kOtosTelemetryRepeatFlag : 0);
+    uint8_t *frame = out + length;
+    uint8_t *payload = beginFrame(frame, type);
+
+    uint16_t deltaUs = sample.timestampUs - _lastTimestampUs;
+    *payload++ = deltaUs & 0xFF;
+    *payload++ = deltaUs >> 8;
+
+    for(int i = 0; i < 3; i++)
+        putRaw(payload, (int16_t)counts[i]);
+
+    const sfe_otos_pose2d_t *poses[kNumGroups] = {&sample.pos, &sample.vel, &sample.acc};
+    for(int group = 1; group < kNumGroups; group++)
+    {
+        const sfe_otos_conversion_t &factors = conversion(group);
+        putRaw(payload, sfeOtosToRaw(poses[group]->x, factors.xyToRaw));
+        putRaw(payload, sfeOtosToRaw(poses[group]->y, factors.xyToRaw));
+        putRaw(payload, sfeOtosToRaw(poses[group]->h, factors.hToRaw));
+    }
+
+    length += endFrame(frame, kSamplePayload);
+    _lastTimestampUs = sample.timestampUs;
+    _sinceResync++;
+
+    return length;
+}
+
+QwiicOTOSTelemetryDecoder::QwiicOTOSTelemetryDecoder()
+    : _frame{}, _length{0}, _expected{0}, _inFrame{false}, _supported{true}, _haveTime{false}, _timestampUs{0},
+      _origin{}, _numCrcErrors{0}, _numUnsynced{0}, _numUnsupported{0}
+{
+}
+
+size_t QwiicOTOSTelemetryDecoder::payloadLength(uint8_t type)
+{
+    switch(type & ~kOtosTelemetryRepeatFlag)
+    {
+    case kOtosTelemetryHeader:
+        return kHeaderPayload;
+    case kOtosTelemetryTime:
+        return kTimePayload;
+    case kOtosTelemetrySample:
+        return kSamplePayload;
+    default:
+        return 0;
+    }
+}
+
+bool QwiicOTOSTelemetryDecoder::push(uint8_t byte, sfe_otos_sample_t &sample)
+{
+    // Hunt for the sync byte between frames
+    if(!_inFrame)
+    {
+        _inFrame = (byte == kOtosTelemetrySync);
+        _length = 0;
+        return false;
+    }
+
+    // The type gives the frame length. A sync byte followed by an unknown type
+    // was payload data, so go back to hunting
+    if(_length == 0)
+    {
+        size_t payload = payloadLength(byte);
+        if(payload == 0)
+        {
+            _inFrame = (byte == kOtosTelemetrySync);
+            return false;
+        }
+        _expected = 1 + payload + 2;
+    }
+
+    _frame[_length++] = byte;
+    if(_length < _expected)
+        return false;
+
+    _inFrame = false;
+
+    uint16_t crc = _frame[_length - 2] | (_frame[_length - 1] << 8);
+    if(crc != crc16(_frame, _length - 2))
+    {
+        // The deltas of the samples after a lost frame would be off, so wait
+        // for the next time frame
+        _numCrcErrors++;
+        _haveTime = false;
+        return false;
+    }
+
+    return decodeFrame(sample);
+}
+
+bool QwiicOTOSTelemetryDecoder::decodeFrame(sfe_otos_sample_t &sample)
+{
+    const uint8_t *payload = _frame + 1;
+
+    if(_frame[0] == kOtosTelemetryHeader)
+    {
+        // A newer encoder may have changed the payloads, so its time and
+        // sample frames are dropped until a supported header arrives
+        _supported = payload[0] == kOtosTelemetryVersion;
+        if(!_supported)
+        {
+            _haveTime = false;
+            _numUnsupported++;
+            return false;
+        }
+    }
+    else if(!_supported)
+    {
+        _numUnsupported++;
+        return false;
+    }
+
+    switch(_frame[0] & ~kOtosTelemetryRepeatFlag)
+    {
+    case kOtosTelemetryHeader:
+        // setLinearUnit() and setAngularUnit() rebuild the same factors as
+        // the driver that produced the stream
+        setLinearUnit(payload[1] == kSfeOtosLinearUnitMeters ? kSfeOtosLinearUnitMeters : kSfeOtosLinearUnitInches);
+        setAngularUnit(payload[2] == kSfeOtosAngularUnitRadians ? kSfeOtosAngularUnitRadians
+                                                                : kSfeOtosAngularUnitDegrees);
+        return false;
+
+    case kOtosTelemetryTime:
+        _timestampUs = 0;
+        for(int i = 0; i < 8; i++)
+            _timestampUs |= (uint64_t)payload[i] << (8 * i);
+        for(int i = 0; i < 3; i++)
+        {
+            uint32_t origin = 0;
+            for(int j = 0; j < 4; j++)
+                origin |= (uint32_t)payload[8 + 4 * i + j] << (8 * j);
+            _origin[i] = (int32_t)origin;
+        }
+        _haveTime = true;
+        return false;
+
+    default:
+        break;
+    }
+
+    if(!_haveTime)
+    {
+        _numUnsynced++;
+        return false;
+    }
+
+    _timestampUs += payload[0] | (payload[1] << 8);
+    sample.timestampUs = _timestampUs;
+    sample.isRepeat = (_frame[0] & kOtosTelemetryRepeatFlag) != 0;
+
+    // The positions are continuous counts once the origin is added
+    sfe_otos_pose2d_t *poses[kNumGroups] = {&sample.pos, &sample.vel, &sample.acc};
+    const uint8_t *regs = payload + 2;
+    for(int group = 0; group < kNumGroups; group++)
+    {
+        int32_t raw[3];
+        for(int i = 0; i < 3; i++)
+        {
+            raw[i] = (int16_t)((regs[2 * i + 1] << 8) | regs[2 * i]);
+            if(group == 0)
+                raw[i] += _origin[i];
+        }
+        sfeOtosFromRaw(raw, conversion(group), *poses[group]);
+        regs += 6;
+    }
+
+    return true;
+}
+
+uint32_t QwiicOTOSTelemetryDecoder::getNumCrcErrors() const
+{
+    return _numCrcErrors;
+}
+
+uint32_t QwiicOTOSTelemetryDecoder::getNumUnsynced() const
+{
+    return _numUnsynced;
+}
+
+uint32_t QwiicOTOSTelemetryDecoder::getNumUnsupported() const
+{
+    return _numUnsupported;
+}
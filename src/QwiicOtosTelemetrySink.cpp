@@ -0,0 +1,135 @@
+#include "QwiicOtosTelemetrySink.h"
+#include "utils.h"
+#include "hardware/dma.h"
+#include "pico/stdio.h"
+
+static_assert(OTOS_TELEMETRY_BUFFER_SIZE >= kOtosTelemetryMaxEncodeBytes,
+              "OTOS_TELEMETRY_BUFFER_SIZE must hold at least one encode()");
+
+QwiicOTOSTelemetrySink::QwiicOTOSTelemetrySink(QwiicOTOSSampler &sampler, sfeQwiicOtos &otos, uart_inst_t *uart)
+    : _sampler{sampler}, _otos{otos}, _uart{uart}, _running{false}, _dmaChannel{-1}, _active{0}, _fill{0},
+      _numBytes{0}, _numSamples{0}
+{
+}
+
+QwiicOTOSTelemetrySink::~QwiicOTOSTelemetrySink()
+{
+    stop();
+}
+
+int QwiicOTOSTelemetrySink::start()
+{
+    if(_running)
+        return kSTkErrFail;
+
+    // The samples are in the driver's units, so the decoder needs the same
+    _encoder = QwiicOTOSTelemetryEncoder(_otos.getLinearUnit(), _otos.getAngularUnit());
+    _active = 0;
+    _fill = 0;
+
+    if(_uart)
+    {
+        _dmaChannel = dma_claim_unused_channel(false);
+        if(_dmaChannel < 0)
+            return kSTkErrFail;
+
+        // Bytes into the UART data register, paced by its TX FIFO
+        dma_channel_config config = dma_channel_get_default_config(_dmaChannel);
+        channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+        channel_config_set_read_increment(&config, true);
+        channel_config_set_write_increment(&config, false);
+        channel_config_set_dreq(&config, uart_get_dreq(_uart, true));
+        dma_channel_configure(_dmaChannel, &config, &uart_get_hw(_uart)->dr, _buffer[0], 0, false);
+    }
+
+    _running = true;
+
+    // Done!
+    return kSTkErrOk;
+}
+
+void QwiicOTOSTelemetrySink::stop()
+{
+    if(!_running)
+        return;
+
+    if(_dmaChannel >= 0)
+    {
+        // Send what is still buffered, so the last samples are not lost
+        dma_channel_wait_for_finish_blocking(_dmaChannel);
+        flush();
+        dma_channel_wait_for_finish_blocking(_dmaChannel);
+        dma_channel_unclaim(_dmaChannel);
+        _dmaChannel = -1;
+    }
+
+    _running = false;
+}
+
+void QwiicOTOSTelemetrySink::flush()
+{
+    if(_fill == 0)
+        return;
+
+    if(_uart)
+    {
+        // Keep filling until the DMA has drained the other buffer
+        if(dma_channel_is_busy(_dmaChannel))
+            return;
+
+        dma_channel_transfer_from_buffer_now(_dmaChannel, _buffer[_active], _fill);
+    }
+    else
+    {
+        // putchar_raw() skips the CRLF translation, which would corrupt the
+        // frames
+        for(size_t i = 0; i < _fill; i++)
+            putchar_raw(_buffer[_active][i]);
+    }
+
+    _numBytes += _fill;
+    _active ^= 1;
+    _fill = 0;
+}
+
+size_t QwiicOTOSTelemetrySink::poll()
+{
+    if(!_running)
+        return 0;
+
+    size_t numEncoded = 0;
+    sfe_otos_sample_t sample;
+
+    while(true)
+    {
+        // Hand the full buffer over first, if the DMA is still busy the
+        // samples wait in the sampler's buffer
+        if(_fill + kOtosTelemetryMaxEncodeBytes > OTOS_TELEMETRY_BUFFER_SIZE)
+        {
+            flush();
+            if(_fill != 0)
+                break;
+        }
+
+        if(!_sampler.getSample(sample))
+            break;
+
+        _fill += _encoder.encode(sample, _buffer[_active] + _fill);
+        numEncoded++;
+    }
+
+    flush();
+    _numSamples += numEncoded;
+
+    return numEncoded;
+}
+
+uint64_t QwiicOTOSTelemetrySink::getNumBytes()
+{
+    return _numBytes;
+}
+
+uint32_t QwiicOTOSTelemetrySink::getNumSamples()
+{
+    return _numSamples;
+}
@@ -0,0 +1,350 @@
+/*******************************************************************************
+    sfeOtosSimTransport.cpp - Simulated OTOS register map for host-side testing
+    and profiling of the driver.
+*******************************************************************************/
+
+#include "sfeOtosSimTransport.h"
+#include <string.h>
+
+// Register values of a real sensor
+static constexpr uint8_t kSimProductId = 0x5F;
+static constexpr uint8_t kSimVersion = 0x10;
+static constexpr uint8_t kSimSignalProcess = 0x0F;
+static constexpr uint8_t kSimSelfTestStart = 0x01;
+static constexpr uint8_t kSimSelfTestPass = 0x04;
+
+// Time the sensor takes per IMU calibration sample
+static constexpr uint32_t kSimCalibSampleUs = 2400;
+
+// Constant standard deviations reported for each group
+static constexpr float kSimStdDevXY = 0.001f;
+static constexpr float kSimStdDevH = 0.001f;
+
+typedef sfeQwiicOtosBase Otos;
+
+static float wrapAngle(float angle)
+{
+    while(angle >= M_PI)
+        angle -= 2 * M_PI;
+    while(angle < -M_PI)
+        angle += 2 * M_PI;
+    return angle;
+}
+
+sfeOtosSimTransport::sfeOtosSimTransport()
+    : _regs{}, _radius{1.0f}, _angularRate{1.0f}, _updatePeriodUs{2400}, _transferUs{75}, _byteUs{23},
+      _errorPpm{0}, _underReadPpm{0}, _asyncPolls{1}, _timeUs{0}, _lastRefreshUs{0}, _trajectory{},
+      _truePos{}, _bias{}, _calibSamples{0}, _calibStartUs{0}, _asyncActive{false}, _asyncReg{0},
+      _asyncData{nullptr}, _asyncLength{0}, _asyncPollsLeft{0}, _rng{0x12345678}, _numTransfers{0},
+      _numInjected{0}
+{
+    _regs[Otos::kRegProductId] = kSimProductId;
+    _regs[Otos::kRegHwVersion] = kSimVersion;
+    _regs[Otos::kRegFwVersion] = kSimVersion;
+    _regs[Otos::kRegSignalProcess] = kSimSignalProcess;
+
+    refresh(true);
+}
+
+void sfeOtosSimTransport::setCircle(float radius, float angularRate)
+{
+    _radius = radius;
+    _angularRate = angularRate;
+    refresh(true);
+}
+
+void sfeOtosSimTransport::setUpdatePeriodUs(uint32_t periodUs)
+{
+    _updatePeriodUs = periodUs;
+}
+
+void sfeOtosSimTransport::setLatency(uint32_t transferUs, uint32_t byteUs)
+{
+    _transferUs = transferUs;
+    _byteUs = byteUs;
+}
+
+void sfeOtosSimTransport::setErrorRate(uint32_t errorPpm, uint32_t underReadPpm)
+{
+    _errorPpm = errorPpm;
+    _underReadPpm = underReadPpm;
+}
+
+void sfeOtosSimTransport::setAsyncPolls(uint32_t polls)
+{
+    _asyncPolls = polls;
+}
+
+void sfeOtosSimTransport::setStatus(uint8_t status)
+{
+    _regs[Otos::kRegStatus] = status;
+}
+
+void sfeOtosSimTransport::advanceUs(uint64_t us)
+{
+    _timeUs += us;
+}
+
+uint64_t sfeOtosSimTransport::getTimeUs() const
+{
+    return _timeUs;
+}
+
+void sfeOtosSimTransport::getTruePosition(sfe_otos_pose2d_t &pos) const
+{
+    pos = _truePos;
+}
+
+uint32_t sfeOtosSimTransport::getNumTransfers() const
+{
+    return _numTransfers;
+}
+
+uint32_t sfeOtosSimTransport::getNumInjectedErrors() const
+{
+    return _numInjected;
+}
+
+bool sfeOtosSimTransport::inject(uint32_t ppm)
+{
+    if(ppm == 0)
+        return false;
+
+    // xorshift32
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+
+    if(_rng % 1000000 >= ppm)
+        return false;
+
+    _numInjected++;
+    return true;
+}
+
+void sfeOtosSimTransport::beginTransfer(size_t numBytes)
+{
+    _numTransfers++;
+    _timeUs += _transferUs + numBytes * _byteUs;
+    refresh(false);
+
+    // Count down a calibration in progress
+    if(_calibSamples > 0)
+    {
+        uint64_t done = (_timeUs - _calibStartUs) / kSimCalibSampleUs;
+        _regs[Otos::kRegImuCalib] = (done >= _calibSamples) ? 0 : _calibSamples - done;
+        if(done >= _calibSamples)
+            _calibSamples = 0;
+    }
+}
+
+void sfeOtosSimTransport::packPose(uint8_t *rawData, float x, float y, float h, float xyToRaw, float hToRaw,
+                                   bool wrap)
+{
+    float values[3] = {x * xyToRaw, y * xyToRaw, h * hToRaw};
+    for(int i = 0; i < 3; i++)
+    {
+        float value = values[i];
+
+        // The position registers of the sensor wrap around, the others
+        // saturate
+        int16_t raw;
+        if(wrap)
+        {
+            raw = (int16_t)(uint16_t)(int32_t)value;
+        }
+        else
+        {
+            if(value > 32767.0f)
+                value = 32767.0f;
+            if(value < -32768.0f)
+                value = -32768.0f;
+            raw = (int16_t)value;
+        }
+
+        rawData[2 * i] = raw & 0xFF;
+        rawData[2 * i + 1] = (raw >> 8) & 0xFF;
+    }
+}
+
+void sfeOtosSimTransport::refresh(bool force)
+{
+    // The sensor only updates its registers once per period
+    uint64_t tick = _updatePeriodUs ? (_timeUs / _updatePeriodUs) * _updatePeriodUs : _timeUs;
+    if(!force && tick == _lastRefreshUs)
+        return;
+    _lastRefreshUs = tick;
+
+    // Circle around the origin with the heading along the direction of travel
+    float t = tick * 1e-6f;
+    float w = _angularRate;
+    float theta = w * t;
+    float c = cosf(theta);
+    float s = sinf(theta);
+
+    _trajectory.x = _radius * c;
+    _trajectory.y = _radius * s;
+    _trajectory.h = wrapAngle(theta + (w >= 0 ? M_PI / 2 : -M_PI / 2));
+
+    _truePos.x = _trajectory.x + _bias.x;
+    _truePos.y = _trajectory.y + _bias.y;
+    _truePos.h = wrapAngle(_trajectory.h + _bias.h);
+
+    packPose(_regs + Otos::kRegPosXL, _truePos.x, _truePos.y, _truePos.h, Otos::kMeterToInt16, Otos::kRadToInt16,
+             true);
+    packPose(_regs + Otos::kRegVelXL, -_radius * w * s, _radius * w * c, w, Otos::kMpsToInt16, Otos::kRpsToInt16);
+    packPose(_regs + Otos::kRegAccXL, -_radius * w * w * c, -_radius * w * w * s, 0, Otos::kMpssToInt16,
+             Otos::kRpssToInt16);
+
+    packPose(_regs + Otos::kRegPosStdXL, kSimStdDevXY, kSimStdDevXY, kSimStdDevH, Otos::kMeterToInt16,
+             Otos::kRadToInt16);
+    packPose(_regs + Otos::kRegVelStdXL, kSimStdDevXY, kSimStdDevXY, kSimStdDevH, Otos::kMpsToInt16,
+             Otos::kRpsToInt16);
+    packPose(_regs + Otos::kRegAccStdXL, kSimStdDevXY, kSimStdDevXY, kSimStdDevH, Otos::kMpssToInt16,
+             Otos::kRpssToInt16);
+}
+
+void sfeOtosSimTransport::writeRegs(uint8_t devReg, const uint8_t *data, size_t length)
+{
+    memcpy(_regs + devReg, data, length);
+
+    // Side effects of the command registers
+    for(size_t i = 0; i < length; i++)
+    {
+        uint8_t reg = devReg + i;
+        if(reg == Otos::kRegReset && (data[i] & 0x01))
+        {
+            _bias.x = -_trajectory.x;
+            _bias.y = -_trajectory.y;
+            _bias.h = -_trajectory.h;
+            _regs[reg] = 0;
+        }
+        else if(reg == Otos::kRegImuCalib)
+        {
+            _calibSamples = data[i];
+            _calibStartUs = _timeUs;
+        }
+        else if(reg == Otos::kRegSelfTest && (data[i] & kSimSelfTestStart))
+        {
+            _regs[reg] = kSimSelfTestPass;
+        }
+    }
+
+    // A complete position write moves the tracked position
+    if(devReg <= Otos::kRegPosXL && devReg + length >= Otos::kRegPosXL + 6u)
+    {
+        const uint8_t *raw = _regs + Otos::kRegPosXL;
+        int16_t rawX = (raw[1] << 8) | raw[0];
+        int16_t rawY = (raw[3] << 8) | raw[2];
+        int16_t rawH = (raw[5] << 8) | raw[4];
+
+        _bias.x = rawX * Otos::kInt16ToMeter - _trajectory.x;
+        _bias.y = rawY * Otos::kInt16ToMeter - _trajectory.y;
+        _bias.h = rawH * Otos::kInt16ToRad - _trajectory.h;
+    }
+
+    refresh(true);
+}
+
+int sfeOtosSimTransport::ping()
+{
+    if(_asyncActive)
+        return kSTkErrBusBusy;
+
+    beginTransfer(0);
+    return inject(_errorPpm) ? kSTkErrFail : kSTkErrOk;
+}
+
+int sfeOtosSimTransport::readRegisterByte(uint8_t devReg, uint8_t &dataToRead)
+{
+    size_t readBytes;
+    return readRegisterRegion(devReg, &dataToRead, 1, readBytes);
+}
+
+int sfeOtosSimTransport::readRegisterRegion(uint8_t devReg, uint8_t *data, size_t numBytes, size_t &readBytes)
+{
+    readBytes = 0;
+
+    if(_asyncActive)
+        return kSTkErrBusBusy;
+
+    if(devReg + numBytes > kNumRegs)
+        return kSTkErrFail;
+
+    beginTransfer(numBytes);
+    if(inject(_errorPpm))
+        return kSTkErrFail;
+
+    // A short read delivers the first half of the data
+    if(inject(_underReadPpm))
+    {
+        readBytes = numBytes / 2;
+        memcpy(data, _regs + devReg, readBytes);
+        return kSTkErrBusUnderRead;
+    }
+
+    memcpy(data, _regs + devReg, numBytes);
+    readBytes = numBytes;
+    return kSTkErrOk;
+}
+
+int sfeOtosSimTransport::writeRegisterByte(uint8_t devReg, uint8_t dataToWrite)
+{
+    return writeRegisterRegion(devReg, &dataToWrite, 1);
+}
+
+int sfeOtosSimTransport::writeRegisterRegion(uint8_t devReg, const uint8_t *data, size_t length)
+{
+    if(_asyncActive)
+        return kSTkErrBusBusy;
+
+    if(devReg + length > kNumRegs)
+        return kSTkErrFail;
+
+    beginTransfer(length);
+    if(inject(_errorPpm))
+        return kSTkErrFail;
+
+    writeRegs(devReg, data, length);
+    return kSTkErrOk;
+}
+
+int sfeOtosSimTransport::startReadRegisterRegionDma(uint8_t devReg, uint8_t *data, size_t numBytes)
+{
+    if(_asyncActive)
+        return kSTkErrBusBusy;
+
+    if(numBytes == 0 || devReg + numBytes > kNumRegs)
+        return kSTkErrFail;
+
+    _asyncActive = true;
+    _asyncReg = devReg;
+    _asyncData = data;
+    _asyncLength = numBytes;
+    _asyncPollsLeft = _asyncPolls;
+    return kSTkErrOk;
+}
+
+int sfeOtosSimTransport::pollReadRegisterRegionDma(size_t &readBytes)
+{
+    readBytes = 0;
+
+    if(!_asyncActive)
+        return kSTkErrFail;
+
+    if(_asyncPollsLeft > 0)
+    {
+        _asyncPollsLeft--;
+        return kSTkErrBusBusy;
+    }
+
+    // The data is sampled when the transfer completes
+    _asyncActive = false;
+    beginTransfer(_asyncLength);
+    if(inject(_errorPpm))
+        return kSTkErrFail;
+
+    memcpy(_asyncData, _regs + _asyncReg, _asyncLength);
+    readBytes = _asyncLength;
+    return kSTkErrOk;
+}
@@ -10,26 +10,36 @@
 *******************************************************************************/
 
 #include "sfeQwiicOtos.h"
-#include "utils.h"
 
 
-sfeQwiicOtos::sfeQwiicOtos()
-    : _linearUnit{kSfeOtosLinearUnitInches}, _angularUnit{kSfeOtosAngularUnitDegrees},
-      _meterToUnit{kMeterToInch}, _radToUnit{kRadianToDegree}
+sfeQwiicOtosBase::sfeQwiicOtosBase()
+    : _bus{nullptr}, _asyncLength{0}, _operation{kOpNone}, _operationSteps{0}, _continuous{false},
+      _continuousSeeded{false}, _continuousRaw{}, _continuousOrigin{}, _autoRebase{false}, _rebaseThreshold{0},
+      _rebaseDue{false}, _numRebases{0}
 {
     // Nothing to do here!
 }
 
-int sfeQwiicOtos::isConnected()
+void sfeQwiicOtosBase::setBus(sfeOtosTransport &bus)
+{
+    _bus = &bus;
+}
+
+sfeOtosTransport &sfeQwiicOtosBase::getBus()
+{
+    return *_bus;
+}
+
+int sfeQwiicOtosBase::isConnected()
 {
     // First ping the device address
-    int err = ping();
+    int err = _bus->ping();
     if(err != kSTkErrOk)
         return err;
     
     // Read the product ID
     uint8_t prodId;
-    err = readRegisterByte(kRegProductId, prodId);
+    err = _bus->readRegisterByte(kRegProductId, prodId);
     if(err != kSTkErrOk)
         return err;
 
@@ -41,12 +51,12 @@ int sfeQwiicOtos::isConnected()
     return kSTkErrOk;
 }
 
-int sfeQwiicOtos::getVersionInfo(sfe_otos_version_t &hwVersion, sfe_otos_version_t &fwVersion)
+int sfeQwiicOtosBase::getVersionInfo(sfe_otos_version_t &hwVersion, sfe_otos_version_t &fwVersion)
 {
     // Read hardware and firmware version registers
     uint8_t rawData[2];
     size_t readBytes;
-    int err = readRegisterRegion(kRegHwVersion, rawData, 2, readBytes);
+    int err = _bus->readRegisterRegion(kRegHwVersion, rawData, 2, readBytes);
     if(err != kSTkErrOk)
         return err;
 
@@ -62,123 +72,175 @@ int sfeQwiicOtos::getVersionInfo(sfe_otos_version_t &hwVersion, sfe_otos_version
     return kSTkErrOk;
 }
 
-int sfeQwiicOtos::selfTest()
+int sfeQwiicOtosBase::selfTest()
+{
+    // Run the self test state machine, sleeping between the steps
+    uint32_t nextStepUs;
+    int err = startSelfTest(nextStepUs);
+    if(err != kSTkErrOk)
+        return err;
+
+    do
+    {
+        delayMs((nextStepUs + 999) / 1000);
+        err = stepSelfTest(nextStepUs);
+    } while(err == kSTkErrBusBusy);
+
+    return err;
+}
+
+int sfeQwiicOtosBase::startSelfTest(uint32_t &nextStepUs)
 {
     // Write the self-test register to start the test
     sfe_otos_self_test_config_t selfTest;
+    selfTest.value = 0;
     selfTest.start = 1;
-    int err = writeRegisterByte(kRegSelfTest, selfTest.value);
+    int err = _bus->writeRegisterByte(kRegSelfTest, selfTest.value);
     if(err != kSTkErrOk)
         return err;
 
-    // Loop until self-test is done, should only take ~20ms as of firmware v1.0
-    for(int i = 0; i < 10; i++)
-    {
-        // Give a short delay between reads
-        delayMs(5);
+    // Should only take ~20ms as of firmware v1.0
+    _operation = kOpSelfTest;
+    _operationSteps = kSelfTestMaxSteps;
+    nextStepUs = kSelfTestStepUs;
 
-        // Read the self-test register
-        err = readRegisterByte(kRegSelfTest, selfTest.value);
-        if(err != kSTkErrOk)
-            return err;
-        
-        // Check if the self-test is done
-        if(selfTest.inProgress == 0)
-        {
-            break;
-        }
+    // Done!
+    return kSTkErrOk;
+}
+
+int sfeQwiicOtosBase::stepSelfTest(uint32_t &nextStepUs)
+{
+    // Make sure a self test was started
+    if(_operation != kOpSelfTest)
+        return kSTkErrFail;
+
+    nextStepUs = kSelfTestStepUs;
+
+    // Read the self-test register. A busy bus does not use up a step
+    sfe_otos_self_test_config_t selfTest;
+    int err = _bus->readRegisterByte(kRegSelfTest, selfTest.value);
+    if(err == kSTkErrBusBusy)
+        return err;
+    if(err != kSTkErrOk)
+    {
+        _operation = kOpNone;
+        return err;
     }
 
+    // Check if the self-test is done, giving up after the last step
+    if(selfTest.inProgress && --_operationSteps > 0)
+        return kSTkErrBusBusy;
+
+    _operation = kOpNone;
+
     // Check if the self-test passed
     return (selfTest.pass == 1) ? kSTkErrOk : kSTkErrFail;
 }
 
-int sfeQwiicOtos::calibrateImu(uint8_t numSamples, bool waitUntilDone)
+int sfeQwiicOtosBase::calibrateImu(uint8_t numSamples, bool waitUntilDone)
 {
-    // Write the number of samples to the device
-    int err = writeRegisterByte(kRegImuCalib, numSamples);
+    uint32_t nextStepUs;
+    int err = startImuCalibration(numSamples, nextStepUs);
     if(err != kSTkErrOk)
         return err;
-    
-    // Wait 1 sample period (2.4ms) to ensure the register updates
-    delayMs(3);
-    
+
     // Do we need to wait until the calibration finishes?
     if(!waitUntilDone)
-        return kSTkErrOk;
-    
-    // Wait for the calibration to finish, which is indicated by the IMU
-    // calibration register reading zero, or until we reach the maximum number
-    // of read attempts
-    for(uint8_t numAttempts = numSamples; numAttempts > 0; numAttempts--)
     {
-        // Read the gryo calibration register value
-        uint8_t calibrationValue;
-        err = readRegisterByte(kRegImuCalib, calibrationValue);
-        if(err != kSTkErrOk)
-            return err;
-        
-        // Check if calibration is done
-        if(calibrationValue == 0)
-            return kSTkErrOk;
-
-        // Give a short delay between reads. As of firmware v1.0, samples take
-        // 2.4ms each, so 3ms should guarantee the next sample is done. This
-        // also ensures the max attempts is not exceeded in normal operation
+        // Wait 1 sample period (2.4ms) to ensure the register updates
         delayMs(3);
+        return kSTkErrOk;
     }
 
-    // Max number of attempts reached, calibration failed
-    return kSTkErrFail;
+    return waitForImuCalibration(nextStepUs);
 }
 
-int sfeQwiicOtos::getImuCalibrationProgress(uint8_t &numSamples)
+int sfeQwiicOtosBase::startImuCalibration(uint8_t numSamples, uint32_t &nextStepUs)
 {
-    // Read the IMU calibration register
-    return readRegisterByte(kRegImuCalib, numSamples);
-}
+    // Write the number of samples to the device
+    int err = _bus->writeRegisterByte(kRegImuCalib, numSamples);
+    if(err != kSTkErrOk)
+        return err;
 
-sfe_otos_linear_unit_t sfeQwiicOtos::getLinearUnit()
-{
-    return _linearUnit;
+    beginImuCalibration(nextStepUs);
+
+    // Done!
+    return kSTkErrOk;
 }
 
-void sfeQwiicOtos::setLinearUnit(sfe_otos_linear_unit_t unit)
+void sfeQwiicOtosBase::beginImuCalibration(uint32_t &nextStepUs)
 {
-    // Check if this unit is already set
-    if(unit == _linearUnit)
-        return;
+    _operation = kOpImuCalibration;
+    _operationSteps = kImuCalibrationMaxSteps;
 
-    // Store new unit
-    _linearUnit = unit;
-    
-    // Compute conversion factor to new units
-    _meterToUnit = (unit == kSfeOtosLinearUnitMeters) ? 1.0f : kMeterToInch;
+    // Wait 1 sample period (2.4ms) to ensure the register updates, plus some
+    // margin, before the first read
+    nextStepUs = 3000;
 }
 
-sfe_otos_angular_unit_t sfeQwiicOtos::getAngularUnit()
+int sfeQwiicOtosBase::stepImuCalibration(uint32_t &nextStepUs)
 {
-    return _angularUnit;
+    // Make sure a calibration was started
+    if(_operation != kOpImuCalibration)
+        return kSTkErrFail;
+
+    nextStepUs = 1000;
+
+    // Read the gryo calibration register value. A busy bus does not use up a
+    // step
+    uint8_t calibrationValue;
+    int err = _bus->readRegisterByte(kRegImuCalib, calibrationValue);
+    if(err == kSTkErrBusBusy)
+        return err;
+    if(err != kSTkErrOk)
+    {
+        _operation = kOpNone;
+        return err;
+    }
+
+    // Calibration is done once the register reads zero
+    if(calibrationValue == 0)
+    {
+        _operation = kOpNone;
+        return kSTkErrOk;
+    }
+
+    // Max number of steps reached, calibration failed
+    if(--_operationSteps == 0)
+    {
+        _operation = kOpNone;
+        return kSTkErrFail;
+    }
+
+    // Sleep through the samples left instead of polling every one of them
+    nextStepUs = calibrationValue * kImuSampleUs;
+
+    return kSTkErrBusBusy;
 }
 
-void sfeQwiicOtos::setAngularUnit(sfe_otos_angular_unit_t unit)
+int sfeQwiicOtosBase::waitForImuCalibration(uint32_t nextStepUs)
 {
-    // Check if this unit is already set
-    if(unit == _angularUnit)
-        return;
+    int err;
+    do
+    {
+        delayMs((nextStepUs + 999) / 1000);
+        err = stepImuCalibration(nextStepUs);
+    } while(err == kSTkErrBusBusy);
 
-    // Store new unit
-    _angularUnit = unit;
+    return err;
+}
 
-    // Compute conversion factor to new units
-    _radToUnit = (unit == kSfeOtosAngularUnitRadians) ? 1.0f : kRadianToDegree;
+int sfeQwiicOtosBase::getImuCalibrationProgress(uint8_t &numSamples)
+{
+    // Read the IMU calibration register
+    return _bus->readRegisterByte(kRegImuCalib, numSamples);
 }
 
-int sfeQwiicOtos::getLinearScalar(float &scalar)
+int sfeQwiicOtosBase::getLinearScalar(float &scalar)
 {
     // Read the linear scalar from the device
     uint8_t rawScalar;
-    int err = readRegisterByte(kRegScalarLinear, rawScalar);
+    int err = _bus->readRegisterByte(kRegScalarLinear, rawScalar);
     if(err != kSTkErrOk)
         return kSTkErrFail;
 
@@ -189,24 +251,23 @@ int sfeQwiicOtos::getLinearScalar(float &scalar)
     return kSTkErrOk;
 }
 
-int sfeQwiicOtos::setLinearScalar(float scalar)
+int sfeQwiicOtosBase::setLinearScalar(float scalar)
 {
-    // Check if the scalar is out of bounds
-    if(scalar < kMinScalar || scalar > kMaxScalar)
-        return kSTkErrFail;
-    
-    // Convert to integer, multiples of 0.1% (+0.5 to round instead of truncate)
-    uint8_t rawScalar = (int8_t)((scalar - 1.0f) * 1000 + 0.5f);
+    // Check the scalar and convert it to a register value
+    uint8_t rawScalar;
+    int err = scalarToRaw(scalar, rawScalar);
+    if(err != kSTkErrOk)
+        return err;
 
     // Write the scalar to the device
-    return writeRegisterByte(kRegScalarLinear, rawScalar);
+    return _bus->writeRegisterByte(kRegScalarLinear, rawScalar);
 }
 
-int sfeQwiicOtos::getAngularScalar(float &scalar)
+int sfeQwiicOtosBase::getAngularScalar(float &scalar)
 {
     // Read the angular scalar from the device
     uint8_t rawScalar;
-    int err = readRegisterByte(kRegScalarAngular, rawScalar);
+    int err = _bus->readRegisterByte(kRegScalarAngular, rawScalar);
     if(err != kSTkErrOk)
         return kSTkErrFail;
 
@@ -217,212 +278,524 @@ int sfeQwiicOtos::getAngularScalar(float &scalar)
     return kSTkErrOk;
 }
 
-int sfeQwiicOtos::setAngularScalar(float scalar)
+int sfeQwiicOtosBase::setAngularScalar(float scalar)
+{
+    // Check the scalar and convert it to a register value
+    uint8_t rawScalar;
+    int err = scalarToRaw(scalar, rawScalar);
+    if(err != kSTkErrOk)
+        return err;
+
+    // Write the scalar to the device
+    return _bus->writeRegisterByte(kRegScalarAngular, rawScalar);
+}
+
+int sfeQwiicOtosBase::scalarToRaw(float scalar, uint8_t &rawScalar)
 {
     // Check if the scalar is out of bounds
     if(scalar < kMinScalar || scalar > kMaxScalar)
         return kSTkErrFail;
-    
+
     // Convert to integer, multiples of 0.1% (+0.5 to round instead of truncate)
-    uint8_t rawScalar = (int8_t)((scalar - 1.0f) * 1000 + 0.5f);
+    rawScalar = (int8_t)((scalar - 1.0f) * 1000 + 0.5f);
 
-    // Write the scalar to the device
-    return writeRegisterByte(kRegScalarAngular, rawScalar);
+    // Done!
+    return kSTkErrOk;
 }
 
-int sfeQwiicOtos::resetTracking()
+int sfeQwiicOtosBase::writeRegImage(const uint8_t *image, uint64_t mask)
 {
-    // Set tracking reset bit
-    return writeRegisterByte(kRegReset, 0x01);
+    uint8_t reg = 0;
+    while(reg < kConfigImageSize)
+    {
+        // Skip to the next flagged register
+        if(!(mask & (1ull << reg)))
+        {
+            reg++;
+            continue;
+        }
+
+        // Extend the burst over every adjacent flagged register
+        uint8_t end = reg;
+        while(end < kConfigImageSize && (mask & (1ull << end)))
+            end++;
+
+        int err = _bus->writeRegisterRegion(reg, image + reg, end - reg);
+        if(err != kSTkErrOk)
+            return err;
+
+        reg = end;
+    }
+
+    // Done!
+    return kSTkErrOk;
 }
 
-int sfeQwiicOtos::getSignalProcessConfig(sfe_otos_signal_process_config_t &config)
+int sfeQwiicOtosBase::verifyRegImage(const uint8_t *image, uint64_t mask)
 {
-    // Read the signal process register
-    return readRegisterByte(kRegSignalProcess, config.value);
+    if(mask == 0)
+        return kSTkErrOk;
+
+    // Read from the first to the last flagged register in one burst, the
+    // registers in between are only read
+    uint8_t first = 0;
+    while(!(mask & (1ull << first)))
+        first++;
+    uint8_t last = kConfigImageSize - 1;
+    while(!(mask & (1ull << last)))
+        last--;
+
+    uint8_t readback[kConfigImageSize];
+    size_t readBytes;
+    int err = _bus->readRegisterRegion(first, readback + first, last - first + 1, readBytes);
+    if(err != kSTkErrOk)
+        return err;
+
+    // Check if we read the correct number of bytes
+    if(readBytes != (size_t)(last - first + 1))
+        return kSTkErrFail;
+
+    for(uint8_t reg = first; reg <= last; reg++)
+    {
+        if((mask & (1ull << reg)) && readback[reg] != image[reg])
+            return kSTkErrFail;
+    }
+
+    // Done!
+    return kSTkErrOk;
 }
 
-int sfeQwiicOtos::setSignalProcessConfig(sfe_otos_signal_process_config_t &config)
+int sfeQwiicOtosBase::getSnapshot(sfe_otos_snapshot_t &snapshot)
 {
-    // Write the signal process register
-    return writeRegisterByte(kRegSignalProcess, config.value);
+    // Read from the scalars to the end of the position in one burst
+    uint8_t image[kConfigImageSize];
+    size_t readBytes;
+    size_t length = kRegPosHH - kRegScalarLinear + 1;
+    int err = _bus->readRegisterRegion(kRegScalarLinear, image + kRegScalarLinear, length, readBytes);
+    if(err != kSTkErrOk)
+        return err;
+
+    // Check if we read the correct number of bytes
+    if(readBytes != length)
+        return kSTkErrFail;
+
+    snapshot.scalarLinear = image[kRegScalarLinear];
+    snapshot.scalarAngular = image[kRegScalarAngular];
+    snapshot.signalProcess.value = image[kRegSignalProcess];
+    memcpy(snapshot.offset, image + kRegOffXL, 6);
+    memcpy(snapshot.position, image + kRegPosXL, 6);
+
+    // Done!
+    return kSTkErrOk;
+}
+
+int sfeQwiicOtosBase::restoreSnapshot(const sfe_otos_snapshot_t &snapshot)
+{
+    uint8_t image[kConfigImageSize];
+    image[kRegScalarLinear] = snapshot.scalarLinear;
+    image[kRegScalarAngular] = snapshot.scalarAngular;
+    image[kRegSignalProcess] = snapshot.signalProcess.value;
+    memcpy(image + kRegOffXL, snapshot.offset, 6);
+    memcpy(image + kRegPosXL, snapshot.position, 6);
+
+    uint64_t verifyMask = (1ull << kRegScalarLinear) | (1ull << kRegScalarAngular) | (1ull << kRegSignalProcess) |
+                          (0x3Full << kRegOffXL);
+
+    int err = writeRegImage(image, verifyMask | (0x3Full << kRegPosXL));
+    if(err != kSTkErrOk)
+        return err;
+    resyncContinuous();
+
+    // The position moves as soon as it is written, so only the configuration
+    // is checked
+    return verifyRegImage(image, verifyMask);
 }
 
-int sfeQwiicOtos::getStatus(sfe_otos_status_t &status)
+int sfeQwiicOtosBase::resetTracking()
 {
-    return readRegisterByte(kRegStatus, status.value);
+    // Set tracking reset bit
+    int err = _bus->writeRegisterByte(kRegReset, 0x01);
+    if(err == kSTkErrOk)
+        resyncContinuous();
+    return err;
 }
 
-int sfeQwiicOtos::getOffset(sfe_otos_pose2d_t &pose)
+void sfeQwiicOtosBase::setContinuousTracking(bool enable)
 {
-    return readPoseRegs(kRegOffXL, pose, kInt16ToMeter, kInt16ToRad);
+    _continuous = enable;
+    _continuousSeeded = false;
+    _rebaseDue = false;
 }
 
-int sfeQwiicOtos::setOffset(sfe_otos_pose2d_t &pose)
+bool sfeQwiicOtosBase::getContinuousTracking()
 {
-    return writePoseRegs(kRegOffXL, pose, kMeterToInt16, kRadToInt16);
+    return _continuous;
 }
 
-int sfeQwiicOtos::getPosition(sfe_otos_pose2d_t &pose)
+void sfeQwiicOtosBase::setAutoRebase(bool enable, float thresholdMeters)
 {
-    return readPoseRegs(kRegPosXL, pose, kInt16ToMeter, kInt16ToRad);
+    // 10 meters is one count past the register range
+    float counts = thresholdMeters * kMeterToInt16;
+    if(counts > 32767.0f)
+        counts = 32767.0f;
+    else if(counts < 0.0f)
+        counts = 0.0f;
+
+    _autoRebase = enable;
+    _rebaseThreshold = (int16_t)counts;
 }
 
-int sfeQwiicOtos::setPosition(sfe_otos_pose2d_t &pose)
+uint32_t sfeQwiicOtosBase::getNumRebases()
 {
-    return writePoseRegs(kRegPosXL, pose, kMeterToInt16, kRadToInt16);
+    return _numRebases;
 }
 
-int sfeQwiicOtos::getVelocity(sfe_otos_pose2d_t &pose)
+bool sfeQwiicOtosBase::isRebaseDue()
 {
-    return readPoseRegs(kRegVelXL, pose, kInt16ToMps, kInt16ToRps);
+    return _rebaseDue;
 }
 
-int sfeQwiicOtos::getAcceleration(sfe_otos_pose2d_t &pose)
+int sfeQwiicOtosBase::serviceRebase()
 {
-    return readPoseRegs(kRegAccXL, pose, kInt16ToMpss, kInt16ToRpss);
+    if(!_rebaseDue)
+        return kSTkErrOk;
+
+    // The bus belongs to the background read until it is polled
+    if(_asyncLength != 0)
+        return kSTkErrBusBusy;
+
+    // The flag may be several reads old, so the position is read again right
+    // before the write, losing as little motion as a rebase in a blocking read
+    uint8_t rawData[6];
+    int err = readRegs(*_bus, kRegPosXL, rawData, sizeof(rawData));
+    if(err != kSTkErrOk)
+        return err;
+
+    int32_t counts[3];
+    unwrapPosition(rawData, counts);
+    return rebasePosition();
 }
 
-int sfeQwiicOtos::getPositionStdDev(sfe_otos_pose2d_t &pose)
+void sfeQwiicOtosBase::rebaseIfDue()
 {
-    return readPoseRegs(kRegPosStdXL, pose, kInt16ToMeter, kInt16ToRad);
+    // A failed write leaves the flag set for the next blocking read
+    if(_rebaseDue)
+        rebasePosition();
 }
 
-int sfeQwiicOtos::getVelocityStdDev(sfe_otos_pose2d_t &pose)
+bool sfeQwiicOtosBase::getContinuousPositionRaw(int32_t raw[3])
 {
-    return readPoseRegs(kRegVelStdXL, pose, kInt16ToMps, kInt16ToRps);
+    if(!_continuous || !_continuousSeeded)
+        return false;
+
+    raw[0] = _continuousOrigin[0] + _continuousRaw[0];
+    raw[1] = _continuousOrigin[1] + _continuousRaw[1];
+    raw[2] = _continuousRaw[2];
+    return true;
 }
 
-int sfeQwiicOtos::getAccelerationStdDev(sfe_otos_pose2d_t &pose)
+void sfeQwiicOtosBase::resyncContinuous()
 {
-    return readPoseRegs(kRegAccStdXL, pose, kInt16ToMpss, kInt16ToRpss);
+    _continuousSeeded = false;
+    _rebaseDue = false;
 }
 
-int sfeQwiicOtos::getPosVelAcc(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc)
+void sfeQwiicOtosBase::unwrapPosition(const uint8_t *rawData, int32_t counts[3])
 {
-    // Read all pose registers
-    uint8_t rawData[18];
-    size_t bytesRead;
-    int err = readRegisterRegion(kRegPosXL, rawData, 18, bytesRead);
-    if(err != kSTkErrOk)
-        return err;
+    int16_t raw[3];
+    regsToRaw(rawData, raw, 3);
 
-    // Check if we read the correct number of bytes
-    if(bytesRead != 18)
-        return kSTkErrFail;
+    if(!_continuousSeeded)
+    {
+        for(int i = 0; i < 3; i++)
+            _continuousRaw[i] = raw[i];
+        _continuousOrigin[0] = 0;
+        _continuousOrigin[1] = 0;
+        _continuousSeeded = true;
+    }
+    else
+    {
+        // The difference to the low 16 bits of the counts, taken modulo 2^16,
+        // is the motion since the last read even across a wrap, with no
+        // branch or float math. It only goes wrong past half the register
+        // range
+        for(int i = 0; i < 3; i++)
+            _continuousRaw[i] += (int16_t)(uint16_t)(raw[i] - (uint16_t)_continuousRaw[i]);
+    }
 
-    // Convert raw data to pose units
-    regsToPose(rawData, pos, kInt16ToMeter, kInt16ToRad);
-    regsToPose(rawData + 6, vel, kInt16ToMps, kInt16ToRps);
-    regsToPose(rawData + 12, acc, kInt16ToMpss, kInt16ToRpss);
+    // The unwrapped registers can also leave the int16 range if rebasing was
+    // off, so compare them as 32-bit values. The decode also runs in the
+    // background polls, possibly in an interrupt, so the write is only flagged
+    // here and done by the blocking reads or serviceRebase()
+    if(_autoRebase && (_continuousRaw[0] > _rebaseThreshold || _continuousRaw[0] < -_rebaseThreshold ||
+                       _continuousRaw[1] > _rebaseThreshold || _continuousRaw[1] < -_rebaseThreshold))
+        _rebaseDue = true;
 
-    // Done!
-    return kSTkErrOk;
+    getContinuousPositionRaw(counts);
 }
 
-int sfeQwiicOtos::getPosVelAccStdDev(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc)
+int sfeQwiicOtosBase::rebasePosition()
 {
-    // Read all pose registers
-    uint8_t rawData[18];
-    size_t bytesRead;
-    int err = readRegisterRegion(kRegPosStdXL, rawData, 18, bytesRead);
+    // x and y back to zero. The sensor takes a position as a whole, so the
+    // heading just read goes along. After a failed write the registers are as
+    // they were, and the rebase stays due
+    uint8_t rawData[6] = {0, 0, 0, 0, (uint8_t)(_continuousRaw[2] & 0xFF), (uint8_t)((_continuousRaw[2] >> 8) & 0xFF)};
+    int err = writeRegs(*_bus, kRegPosXL, rawData, sizeof(rawData));
     if(err != kSTkErrOk)
         return err;
 
-    // Check if we read the correct number of bytes
-    if(bytesRead != 18)
-        return kSTkErrFail;
-
-    // Convert raw data to pose units
-    regsToPose(rawData, pos, kInt16ToMeter, kInt16ToRad);
-    regsToPose(rawData + 6, vel, kInt16ToMps, kInt16ToRps);
-    regsToPose(rawData + 12, acc, kInt16ToMpss, kInt16ToRpss);
+    _continuousOrigin[0] += _continuousRaw[0];
+    _continuousOrigin[1] += _continuousRaw[1];
+    _continuousRaw[0] = 0;
+    _continuousRaw[1] = 0;
+    _rebaseDue = false;
+    _numRebases++;
 
     // Done!
     return kSTkErrOk;
 }
 
-int sfeQwiicOtos::getPosVelAccAndStdDev(sfe_otos_pose2d_t &pos, sfe_otos_pose2d_t &vel, sfe_otos_pose2d_t &acc,
-                                    sfe_otos_pose2d_t &posStdDev, sfe_otos_pose2d_t &velStdDev, sfe_otos_pose2d_t &accStdDev)
+int sfeQwiicOtosBase::getSignalProcessConfig(sfe_otos_signal_process_config_t &config)
 {
-    // Read all pose registers
-    uint8_t rawData[36];
-    size_t bytesRead;
-    int err = readRegisterRegion(kRegPosXL, rawData, 36, bytesRead);
-    if(err != kSTkErrOk)
-        return err;
+    // Read the signal process register
+    return _bus->readRegisterByte(kRegSignalProcess, config.value);
+}
 
-    // Check if we read the correct number of bytes
-    if(bytesRead != 36)
-        return kSTkErrFail;
+int sfeQwiicOtosBase::setSignalProcessConfig(sfe_otos_signal_process_config_t &config)
+{
+    // Write the signal process register
+    return _bus->writeRegisterByte(kRegSignalProcess, config.value);
+}
 
-    // Convert raw data to pose units
-    regsToPose(rawData, pos, kInt16ToMeter, kInt16ToRad);
-    regsToPose(rawData + 6, vel, kInt16ToMps, kInt16ToRps);
-    regsToPose(rawData + 12, acc, kInt16ToMpss, kInt16ToRpss);
-    regsToPose(rawData + 18, posStdDev, kInt16ToMeter, kInt16ToRad);
-    regsToPose(rawData + 24, velStdDev, kInt16ToMps, kInt16ToRps);
-    regsToPose(rawData + 30, accStdDev, kInt16ToMpss, kInt16ToRpss);
+int sfeQwiicOtosBase::getStatus(sfe_otos_status_t &status)
+{
+    return _bus->readRegisterByte(kRegStatus, status.value);
+}
 
-    // Done!
-    return kSTkErrOk;
+int sfeQwiicOtosBase::startStatusAsync()
+{
+    return startAsyncRead(*_bus, kRegStatus, 1);
 }
 
-int sfeQwiicOtos::readPoseRegs(uint8_t reg, sfe_otos_pose2d_t &pose, float rawToXY, float rawToH)
+int sfeQwiicOtosBase::pollStatusAsync(sfe_otos_status_t &status)
 {
-    size_t bytesRead;
-    uint8_t rawData[6];
+    // Make sure the pending read is the one we expect
+    if(_asyncLength != 1)
+        return kSTkErrFail;
 
-    // Attempt to read the raw pose data
-    int err = readRegisterRegion(reg, rawData, 6, bytesRead);
-    if (err != kSTkErrOk)
+    // Check if the transfer has finished
+    int err = pollAsyncRead(*_bus);
+    if(err != kSTkErrOk)
         return err;
 
-    // Check if we read the correct number of bytes
-    if (bytesRead != 6)
-        return kSTkErrFail;
-
-    regsToPose(rawData, pose, rawToXY, rawToH);
+    status.value = _asyncData[0];
 
     // Done!
     return kSTkErrOk;
 }
 
-int sfeQwiicOtos::writePoseRegs(uint8_t reg, sfe_otos_pose2d_t &pose, float xyToRaw, float hToRaw)
+sfe_otos_validity_t sfeQwiicOtosBase::getStatusValidity(sfe_otos_status_t status)
 {
-    // Store raw data in a temporary buffer
-    uint8_t rawData[6];
-    poseToRegs(rawData, pose, xyToRaw, hToRaw);
+    // Fatal errors first, the pose means nothing without either sensor
+    if(status.errorPaa || status.errorLsm)
+        return kSfeOtosSampleSensorFault;
+
+    if(status.warnOpticalTracking)
+        return kSfeOtosSampleTrackingLost;
+
+    return kSfeOtosSampleValid;
+}
+
+void sfeQwiicOtosBase::planGroupRead(uint8_t groups, sfe_otos_group_plan_t &plan)
+{
+    // Each group is 6 bytes, ordered from kRegPosXL to kRegAccStdHH
+    const int groupSize = 6;
+    const int numGroups = 6;
 
-    // Write the raw data to the device
-    return writeRegisterRegion(reg, rawData, 6);
+    // Starting a second burst costs the register address write and the
+    // repeated device address, plus the start, restart, and stop conditions,
+    // which is about 4 bytes on the bus
+    const int burstOverhead = 4;
+
+    plan.numBursts = 0;
+    groups &= kSfeOtosGroupAll;
+    if(groups == 0)
+        return;
+
+    // Find the first and last requested groups
+    int first = 0;
+    while(!(groups & (1 << first)))
+        first++;
+    int last = numGroups - 1;
+    while(!(groups & (1 << last)))
+        last--;
+
+    // Find the longest run of unrequested groups between them
+    int gapStart = 0;
+    int gapLength = 0;
+    for(int i = first + 1; i < last;)
+    {
+        if(groups & (1 << i))
+        {
+            i++;
+            continue;
+        }
+
+        int start = i;
+        while(!(groups & (1 << i)))
+            i++;
+
+        if(i - start > gapLength)
+        {
+            gapStart = start;
+            gapLength = i - start;
+        }
+    }
+
+    // Split around the gap only if skipping it saves more than a new burst costs
+    if(gapLength * groupSize > burstOverhead)
+    {
+        plan.reg[0] = kRegPosXL + first * groupSize;
+        plan.length[0] = (gapStart - first) * groupSize;
+        plan.reg[1] = kRegPosXL + (gapStart + gapLength) * groupSize;
+        plan.length[1] = (last + 1 - gapStart - gapLength) * groupSize;
+        plan.numBursts = 2;
+    }
+    else
+    {
+        plan.reg[0] = kRegPosXL + first * groupSize;
+        plan.length[0] = (last + 1 - first) * groupSize;
+        plan.numBursts = 1;
+    }
+}
+
+void sfeQwiicOtosBase::regsToRaw(const uint8_t *rawData, int16_t *raw, size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+        raw[i] = (rawData[2 * i + 1] << 8) | rawData[2 * i];
 }
 
-void sfeQwiicOtos::regsToPose(uint8_t *rawData, sfe_otos_pose2d_t &pose, float rawToXY, float rawToH)
+void sfeQwiicOtosBase::regsToPoseQ(const uint8_t *rawData, sfe_otos_pose2d_q_t &pose, sfe_otos_q_scale_t rawToXY,
+                               sfe_otos_q_scale_t rawToH)
 {
     // Store raw data
     int16_t rawX = (rawData[1] << 8) | rawData[0];
     int16_t rawY = (rawData[3] << 8) | rawData[2];
     int16_t rawH = (rawData[5] << 8) | rawData[4];
 
-    // Store in pose and convert to units
-    pose.x = rawX * rawToXY * _meterToUnit;
-    pose.y = rawY * rawToXY * _meterToUnit;
-    pose.h = rawH * rawToH * _radToUnit;
+    // Scale to Q16.16, the products always fit in 32 bits
+    pose.x = (rawX * rawToXY.mult) >> rawToXY.shift;
+    pose.y = (rawY * rawToXY.mult) >> rawToXY.shift;
+    pose.h = (rawH * rawToH.mult) >> rawToH.shift;
+}
+
+void sfeQwiicOtosBase::positionRegsToPoseQ(const uint8_t *rawData, sfe_otos_pose2d_q_t &pose)
+{
+    if(!_continuous)
+    {
+        regsToPoseQ(rawData, pose, kQScaleMeter, kQScaleRad);
+        return;
+    }
+
+    // The counts outgrow 16 bits, so the products take 64. Q16.16 still spans
+    // +/-32 km and +/-5000 turns
+    int32_t counts[3];
+    unwrapPosition(rawData, counts);
+    pose.x = ((int64_t)counts[0] * kQScaleMeter.mult) >> kQScaleMeter.shift;
+    pose.y = ((int64_t)counts[1] * kQScaleMeter.mult) >> kQScaleMeter.shift;
+    pose.h = ((int64_t)counts[2] * kQScaleRad.mult) >> kQScaleRad.shift;
+}
+
+void sfeQwiicOtosBase::decodeFramesQ(const uint8_t *frames, size_t numFrames, int32_t *xs, int32_t *ys, int32_t *hs,
+                                     sfe_otos_group_t group, size_t stride)
+{
+    static constexpr sfe_otos_q_scale_t kScalesXY[kNumGroups] = {kQScaleMeter, kQScaleMps, kQScaleMpss};
+    static constexpr sfe_otos_q_scale_t kScalesH[kNumGroups] = {kQScaleRad, kQScaleRps, kQScaleRpss};
+
+    int index = groupIndex(group);
+    const int32_t multXY = kScalesXY[index].mult;
+    const int32_t multH = kScalesH[index].mult;
+    const uint8_t shiftXY = kScalesXY[index].shift;
+    const uint8_t shiftH = kScalesH[index].shift;
+
+    // Integer multiplies and shifts only, a few cycles per value on the M0+
+    for(size_t i = 0; i < numFrames; i++, frames += stride)
+    {
+        xs[i] = ((int16_t)((frames[1] << 8) | frames[0]) * multXY) >> shiftXY;
+        ys[i] = ((int16_t)((frames[3] << 8) | frames[2]) * multXY) >> shiftXY;
+        hs[i] = ((int16_t)((frames[5] << 8) | frames[4]) * multH) >> shiftH;
+    }
+}
+
+sfeOtosRuntimeUnits::sfeOtosRuntimeUnits()
+    : _linearUnit{kSfeOtosLinearUnitInches}, _angularUnit{kSfeOtosAngularUnitDegrees}
+{
+    // Compute conversion factors for the default units
+    updateConversionFactors();
 }
 
-void sfeQwiicOtos::poseToRegs(uint8_t *rawData, sfe_otos_pose2d_t &pose, float xyToRaw, float hToRaw)
+sfe_otos_linear_unit_t sfeOtosRuntimeUnits::getLinearUnit()
 {
-    // Convert pose units to raw data
-    int16_t rawX = pose.x * xyToRaw / _meterToUnit;
-    int16_t rawY = pose.y * xyToRaw / _meterToUnit;
-    int16_t rawH = pose.h * hToRaw / _radToUnit;
+    return _linearUnit;
+}
+
+void sfeOtosRuntimeUnits::setLinearUnit(sfe_otos_linear_unit_t unit)
+{
+    // Check if this unit is already set
+    if(unit == _linearUnit)
+        return;
+
+    // Store new unit
+    _linearUnit = unit;
     
-    // Store raw data in buffer
-    rawData[0] = rawX & 0xFF;
-    rawData[1] = (rawX >> 8) & 0xFF;
-    rawData[2] = rawY & 0xFF;
-    rawData[3] = (rawY >> 8) & 0xFF;
-    rawData[4] = rawH & 0xFF;
-    rawData[5] = (rawH >> 8) & 0xFF;
+    // Compute conversion factors to new units
+    updateConversionFactors();
+}
+
+sfe_otos_angular_unit_t sfeOtosRuntimeUnits::getAngularUnit()
+{
+    return _angularUnit;
+}
+
+void sfeOtosRuntimeUnits::setAngularUnit(sfe_otos_angular_unit_t unit)
+{
+    // Check if this unit is already set
+    if(unit == _angularUnit)
+        return;
+
+    // Store new unit
+    _angularUnit = unit;
+
+    // Compute conversion factors to new units
+    updateConversionFactors();
 }
+
+void sfeOtosRuntimeUnits::updateConversionFactors()
+{
+    float meterToUnit = (_linearUnit == kSfeOtosLinearUnitMeters) ? 1.0f : sfeQwiicOtosBase::kMeterToInch;
+    float radToUnit = (_angularUnit == kSfeOtosAngularUnitRadians) ? 1.0f : sfeQwiicOtosBase::kRadianToDegree;
+
+    // Register resolution of each group, in meters and radians
+    const float rawToXY[sfeQwiicOtosBase::kNumGroups] = {
+        sfeQwiicOtosBase::kInt16ToMeter, sfeQwiicOtosBase::kInt16ToMps, sfeQwiicOtosBase::kInt16ToMpss};
+    const float rawToH[sfeQwiicOtosBase::kNumGroups] = {
+        sfeQwiicOtosBase::kInt16ToRad, sfeQwiicOtosBase::kInt16ToRps, sfeQwiicOtosBase::kInt16ToRpss};
+    const float xyToRaw[sfeQwiicOtosBase::kNumGroups] = {
+        sfeQwiicOtosBase::kMeterToInt16, sfeQwiicOtosBase::kMpsToInt16, sfeQwiicOtosBase::kMpssToInt16};
+    const float hToRaw[sfeQwiicOtosBase::kNumGroups] = {
+        sfeQwiicOtosBase::kRadToInt16, sfeQwiicOtosBase::kRpsToInt16, sfeQwiicOtosBase::kRpssToInt16};
+
+    // Fuse the register resolution with the unit conversion, so reads and
+    // writes only need a single multiply per axis
+    for(int i = 0; i < sfeQwiicOtosBase::kNumGroups; i++)
+    {
+        _conversion[i].rawToXY = rawToXY[i] * meterToUnit;
+        _conversion[i].rawToH = rawToH[i] * radToUnit;
+        _conversion[i].xyToRaw = xyToRaw[i] / meterToUnit;
+        _conversion[i].hToRaw = hToRaw[i] / radToUnit;
+    }
+}
+
+// Run-time unit variant used by sfeQwiicOtos, so its pose methods are only
+// compiled once
+template class sfeQwiicOtosPose<sfeOtosRuntimeUnits>;
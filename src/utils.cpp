@@ -1,7 +1,77 @@
 #include "utils.h"
+#include "hardware/dma.h"
+#include "pico/stdlib.h"
 
 #define I2C_RECOVERY_CLOCKS 9
 
+// Worst-case cost of each recovery step. A block reset re-runs i2c_init(), a
+// bus recovery adds up to 9 clocks and a stop at 100kHz
+#define I2C_BLOCK_RESET_US 50
+#define I2C_BUS_RECOVERY_US 250
+
+// Shortest attempt worth starting, below this the budget is spent
+#define I2C_MIN_ATTEMPT_US 100
+
+// Slack added to every transfer timeout for clock stretching by the OTOS
+#define I2C_TIMEOUT_SLACK_US 200
+
+// Reference block of autoTune(), product ID to offsets, and the reads of it
+// at every step
+#define I2C_TUNE_PROBE_REG 0x00
+#define I2C_TUNE_PROBE_LENGTH 22
+#define I2C_TUNE_PROBE_READS 32
+
+// Bytes of the reference block compared, the ones that only change when
+// written: product ID, versions, scalars, signal process and offsets. The IMU
+// calibration counts down on its own, and the reset and self-test registers
+// change while those run
+static constexpr uint32_t kTuneProbeStatic = (1u << 0x00) | (1u << 0x01) | (1u << 0x02) | (1u << 0x04) |
+                                             (1u << 0x05) | (1u << 0x0E) | (0x3Fu << 0x10);
+
+// Runtime tuning, see OtosI2C::setAutoTune(). The clean windows needed before
+// stepping up start at I2C_TUNE_HOLD_WINDOWS and go up to
+// I2C_TUNE_MAX_HOLD_WINDOWS
+#define I2C_TUNE_WINDOW 256
+#define I2C_TUNE_MAX_FAULTS_PER_MILLE 10
+#define I2C_TUNE_HOLD_WINDOWS 16
+#define I2C_TUNE_MAX_HOLD_WINDOWS 1024
+
+// Read chunks tried by autoTune(), the last one reads any OTOS block whole
+static constexpr uint8_t kTuneReadChunks[] = {8, 16, 32, kMaxReadChunk};
+
+// Hardware blocks currently owned by a DMA read, shared by every OtosI2C
+// instance on the same block
+static volatile bool blockDmaActive[2] = {false, false};
+
+// Whether a probe read matches the reference on its static bytes
+static bool probeMatches(const uint8_t *data, const uint8_t *reference, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        if ((kTuneProbeStatic & (1u << i)) && data[i] != reference[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether a deadline has passed
+static inline bool expired(uint32_t deadlineUs) {
+    return (int32_t)(time_us_32() - deadlineUs) >= 0;
+}
+
+// Time left until a deadline, for the SDK timeout transfers
+static uint timeLeftUs(uint32_t deadlineUs) {
+    int32_t left = (int32_t)(deadlineUs - time_us_32());
+    return (left > 0) ? left : 0;
+}
+
+// Converts a result of the SDK timeout transfers to an error code
+static int sdkResultToError(int result) {
+    if (result == PICO_ERROR_TIMEOUT) {
+        return kSTkErrBusTimeout;
+    }
+    return (result < 0) ? kSTkErrBusNoResponse : kSTkErrOk;
+}
+
 void i2cBusRecovery(uint sda_pin, uint scl_pin) {
     gpio_init(sda_pin);
     gpio_init(scl_pin);
@@ -34,60 +104,360 @@ void i2cBusRecovery(uint sda_pin, uint scl_pin) {
     busy_wait_us(5);
 }
 
-void initI2C(bool force_recovery) {
+OtosI2C::OtosI2C(i2c_inst_t *port, uint sdaPin, uint sclPin, uint baudRate, uint8_t address)
+    : _port(port), _sdaPin(sdaPin), _sclPin(sclPin), _baudRate(baudRate), _address(address),
+      _dmaTxChannel(-1), _dmaRxChannel(-1), _dmaCommands{}, _dmaLength(0), _dmaActive(false),
+      _dmaStartUs(0), _dmaReg(0), _policy(kDefaultRetryPolicy), _faults{},
+      _recoveryLevel(kRecoveryNone), _dmaDeadlineUs(0), _readChunk(kDefaultBufferChunk), _autoTune(false),
+      _tuneLevel(0), _tuneMaxLevel(0), _tuneAttempts(0), _tuneFaults(0), _tuneCleanWindows(0),
+      _tuneHoldWindows(I2C_TUNE_HOLD_WINDOWS) {
+}
+
+bool OtosI2C::blockBusy() const {
+    return blockDmaActive[i2c_hw_index(_port)];
+}
+
+void OtosI2C::setBlockBusy(bool busy) {
+    blockDmaActive[i2c_hw_index(_port)] = busy;
+    _dmaActive = busy;
+}
+
+void OtosI2C::init(bool force_recovery) {
     // Attempt I2C bus recovery before de-initializing pins
     if (force_recovery) {
-        i2cBusRecovery(CONFIG::I2C_SDA_PIN, CONFIG::I2C_SCL_PIN);
+        i2cBusRecovery(_sdaPin, _sclPin);
     }
     // de-initialise I2C pins in case
-    gpio_disable_pulls(CONFIG::I2C_SDA_PIN);
-    gpio_set_function(CONFIG::I2C_SDA_PIN, GPIO_FUNC_NULL);
-    gpio_disable_pulls(CONFIG::I2C_SCL_PIN);
-    gpio_set_function(CONFIG::I2C_SCL_PIN, GPIO_FUNC_NULL);
+    gpio_disable_pulls(_sdaPin);
+    gpio_set_function(_sdaPin, GPIO_FUNC_NULL);
+    gpio_disable_pulls(_sclPin);
+    gpio_set_function(_sclPin, GPIO_FUNC_NULL);
 
     // initialise I2C with baudrate
-    i2c_init(CONFIG::i2c_port, CONFIG::I2C_BAUD_RATE);
+    i2c_init(_port, _baudRate);
 
-    gpio_set_function(CONFIG::I2C_SDA_PIN, GPIO_FUNC_I2C);
-    gpio_set_function(CONFIG::I2C_SCL_PIN, GPIO_FUNC_I2C);
-    gpio_pull_up(CONFIG::I2C_SDA_PIN);
-    gpio_pull_up(CONFIG::I2C_SCL_PIN);
+    gpio_set_function(_sdaPin, GPIO_FUNC_I2C);
+    gpio_set_function(_sclPin, GPIO_FUNC_I2C);
+    gpio_pull_up(_sdaPin);
+    gpio_pull_up(_sclPin);
 }
 
-int ping() {
-    if (!CONFIG::i2c_port) {
-        return kSTkErrBusNotInit;
+uint OtosI2C::setBaudRate(uint baudRate) {
+    _baudRate = baudRate;
+
+    if (!_port) {
+        return 0;
     }
 
-    uint8_t data = 0;
-    int result = i2c_write_blocking(CONFIG::i2c_port, kDefaultAddress, &data, 1, false);
+    return i2c_set_baudrate(_port, baudRate);
+}
+
+void OtosI2C::setReadChunk(size_t chunk) {
+    _readChunk = (chunk == 0) ? kDefaultBufferChunk : (chunk > kMaxReadChunk) ? kMaxReadChunk : chunk;
+}
+
+uint32_t OtosI2C::probeReads(const uint8_t *reference, size_t length) {
+    uint8_t devReg = I2C_TUNE_PROBE_REG;
+    uint8_t data[I2C_TUNE_PROBE_LENGTH];
+    uint32_t start = time_us_32();
+
+    for (int i = 0; i < I2C_TUNE_PROBE_READS; ++i) {
+        // No retries, a single fault disqualifies the settings
+        size_t readBytes = 0;
+        memset(data, 0, length);
+        int result = readRegion(&devReg, 1, data, length, readBytes, time_us_32() + transferTimeUs(length));
+        if (result == kSTkErrBusTimeout || result == kSTkErrBusNoResponse) {
+            classifyFault(result, 1);
+            recover(time_us_32() + _policy.budgetUs);
+            return 0;
+        }
 
-    return (result >= 0) ? kSTkErrOk : kSTkErrFail;
+        // Corrupted bits do not always show up as a NAK
+        if (result != kSTkErrOk || !probeMatches(data, reference, length)) {
+            return 0;
+        }
+    }
+
+    uint32_t elapsed = time_us_32() - start;
+    return elapsed ? elapsed : 1;
 }
 
-int readRegisterByte(uint8_t devReg, uint8_t &dataToRead) {
-    if (!CONFIG::i2c_port) {
+int OtosI2C::autoTune(uint maxBaudRate) {
+    if (!_port) {
         return kSTkErrBusNotInit;
     }
 
-    // Envoyer l'adresse du registre
-    int result = i2c_write_blocking(CONFIG::i2c_port, kDefaultAddress, &devReg, 1, true);
-    if (result < 0) {
+    if (blockBusy()) {
+        return kSTkErrBusBusy;
+    }
+
+    // The reference is read at the slowest step, under the retry policy
+    uint baudRate = _baudRate;
+    size_t chunk = _readChunk;
+    setBaudRate(kTuneBaudRates[0]);
+    _readChunk = kDefaultBufferChunk;
+
+    uint8_t reference[I2C_TUNE_PROBE_LENGTH];
+    size_t readBytes;
+    int err = readRegisterRegion(I2C_TUNE_PROBE_REG, reference, sizeof(reference), readBytes);
+    if (err != kSTkErrOk) {
+        setBaudRate(baudRate);
+        _readChunk = chunk;
+        return err;
+    }
+
+    int bestLevel = -1;
+    size_t bestChunk = kDefaultBufferChunk;
+    uint32_t bestUs = UINT32_MAX;
+
+    for (int level = 0; level < kNumTuneBaudRates && kTuneBaudRates[level] <= maxBaudRate; ++level) {
+        setBaudRate(kTuneBaudRates[level]);
+
+        // A faster clock is not always faster: the OTOS stretches it, and
+        // every extra chunk costs a repeated start and address
+        bool reliable = false;
+        for (uint8_t readChunk : kTuneReadChunks) {
+            _readChunk = readChunk;
+            uint32_t us = probeReads(reference, sizeof(reference));
+            if (us == 0) {
+                continue;
+            }
+
+            reliable = true;
+            if (us < bestUs) {
+                bestUs = us;
+                bestLevel = level;
+                bestChunk = readChunk;
+            }
+        }
+
+        // Rates above the first failing one are not worth the faults
+        if (!reliable) {
+            break;
+        }
+    }
+
+    // Nothing got through reliably, not even the reference rate
+    if (bestLevel < 0) {
+        setBaudRate(baudRate);
+        _readChunk = chunk;
         return kSTkErrFail;
     }
 
-    // Lire le byte à partir du registre
-    result = i2c_read_blocking(CONFIG::i2c_port, kDefaultAddress, &dataToRead, 1, false);
-    return (result == 1) ? kSTkErrOk : kSTkErrFail;
+    setBaudRate(kTuneBaudRates[bestLevel]);
+    _readChunk = bestChunk;
+
+    _tuneLevel = bestLevel;
+    _tuneMaxLevel = bestLevel;
+    _tuneAttempts = _faults.attempts;
+    _tuneFaults = _faults.nacks + _faults.timeouts;
+    _tuneCleanWindows = 0;
+    _tuneHoldWindows = I2C_TUNE_HOLD_WINDOWS;
+    _autoTune = true;
+
+    // Done!
+    return kSTkErrOk;
+}
+
+void OtosI2C::adaptBaudRate() {
+    if (!_autoTune) {
+        return;
+    }
+
+    uint32_t attempts = _faults.attempts - _tuneAttempts;
+    if (attempts < I2C_TUNE_WINDOW) {
+        return;
+    }
+
+    // The clock can only change between transfers, try again after the next
+    // one if another instance has a DMA read on the block
+    if (blockBusy()) {
+        return;
+    }
+
+    uint32_t faults = _faults.nacks + _faults.timeouts - _tuneFaults;
+    _tuneAttempts = _faults.attempts;
+    _tuneFaults = _faults.nacks + _faults.timeouts;
+
+    if (faults * 1000 > attempts * I2C_TUNE_MAX_FAULTS_PER_MILLE) {
+        _tuneCleanWindows = 0;
+        if (_tuneLevel > 0) {
+            setBaudRate(kTuneBaudRates[--_tuneLevel]);
+            if (_tuneHoldWindows < I2C_TUNE_MAX_HOLD_WINDOWS) {
+                _tuneHoldWindows *= 2;
+            }
+        }
+    } else if (faults == 0) {
+        if (++_tuneCleanWindows >= _tuneHoldWindows && _tuneLevel < _tuneMaxLevel) {
+            setBaudRate(kTuneBaudRates[++_tuneLevel]);
+            _tuneCleanWindows = 0;
+        }
+    }
+}
+
+uint32_t OtosI2C::transferTimeUs(size_t numBytes) const {
+    // Device address, register address, repeated device address, and the
+    // data, 9 clocks each
+    uint64_t bits = (uint64_t)(numBytes + 3) * 9;
+    uint32_t baudRate = _baudRate ? _baudRate : CONFIG::I2C_BAUD_RATE;
+    return (uint32_t)(bits * 1000000 / baudRate) * 2 + I2C_TIMEOUT_SLACK_US;
+}
+
+bool OtosI2C::linesStuck() const {
+    // The pins read back their level whatever function drives them
+    return !gpio_get(_sdaPin) || !gpio_get(_sclPin);
+}
+
+void OtosI2C::classifyFault(int result, uint8_t failures) {
+    uint8_t level = kRecoveryNone;
+
+    if (result == kSTkErrBusTimeout) {
+        // The block may still be in the middle of the transfer, so it always
+        // needs a reset
+        _faults.timeouts++;
+        level = kRecoveryBlockReset;
+    } else {
+        // A NAK alone is retried as is, the OTOS may just have been busy.
+        // Repeated ones escalate
+        _faults.nacks++;
+        level = (failures > 2) ? kRecoveryBus : (failures > 1) ? kRecoveryBlockReset : kRecoveryNone;
+    }
+
+    // A device holding a line low will not let go without being clocked out
+    if (level != kRecoveryBlockReset && linesStuck()) {
+        _faults.stuckBus++;
+        level = kRecoveryBus;
+    }
+
+    if (_policy.recovery && level > _recoveryLevel) {
+        _recoveryLevel = level;
+    }
+}
+
+int OtosI2C::recover(uint32_t deadlineUs) {
+    if (_recoveryLevel == kRecoveryNone) {
+        return kSTkErrOk;
+    }
+
+    // Another instance may have a DMA read on the same block
+    if (blockBusy()) {
+        return kSTkErrBusBusy;
+    }
+
+    // Defer the recovery if it would overrun the budget of this transfer
+    uint32_t cost = (_recoveryLevel == kRecoveryBus) ? I2C_BUS_RECOVERY_US : I2C_BLOCK_RESET_US;
+    if ((int32_t)(deadlineUs - time_us_32()) < (int32_t)cost) {
+        return kSTkErrBusTimeout;
+    }
+
+    if (_recoveryLevel == kRecoveryBlockReset) {
+        i2c_init(_port, _baudRate);
+        _faults.blockResets++;
+
+        // With the block reset, anything still holding a line low is a device
+        if (!linesStuck()) {
+            _recoveryLevel = kRecoveryNone;
+            return kSTkErrOk;
+        }
+
+        _faults.stuckBus++;
+        _recoveryLevel = kRecoveryBus;
+        if ((int32_t)(deadlineUs - time_us_32()) < I2C_BUS_RECOVERY_US) {
+            return kSTkErrBusTimeout;
+        }
+    }
+
+    init(true);
+    _faults.busRecoveries++;
+    _recoveryLevel = kRecoveryNone;
+
+    return linesStuck() ? kSTkErrBusStuck : kSTkErrOk;
 }
 
-int readRegisterRegionAnyAddress(uint8_t *devReg, size_t regLength, uint8_t *data, size_t numBytes, size_t &readBytes) {
-    if (!CONFIG::i2c_port)
+template <class Transfer>
+int OtosI2C::withRetries(size_t numBytes, uint8_t maxAttempts, Transfer transfer) {
+    uint32_t deadline = time_us_32() + _policy.budgetUs;
+    int result = kSTkErrBusTimeout;
+
+    for (uint8_t attempt = 0; attempt < maxAttempts; ++attempt) {
+        // Clean up after the previous fault first, possibly one left over by
+        // an earlier transfer
+        int err = recover(deadline);
+        if (err != kSTkErrOk) {
+            return (attempt == 0) ? err : result;
+        }
+
+        // Time out within the budget left, and give up when too little is
+        // left for a meaningful attempt
+        int32_t left = (int32_t)(deadline - time_us_32());
+        if (left < I2C_MIN_ATTEMPT_US) {
+            break;
+        }
+        uint32_t timeout = transferTimeUs(numBytes);
+        uint32_t attemptDeadline = time_us_32() + ((timeout < (uint32_t)left) ? timeout : (uint32_t)left);
+
+        if (attempt > 0) {
+            _faults.retries++;
+        }
+        _faults.attempts++;
+
+        result = transfer(attemptDeadline);
+
+        // Only bus faults are worth retrying
+        if (result != kSTkErrBusTimeout && result != kSTkErrBusNoResponse) {
+            return result;
+        }
+
+        classifyFault(result, attempt + 1);
+    }
+
+    return result;
+}
+
+int OtosI2C::ping() {
+    if (!_port) {
+        return kSTkErrBusNotInit;
+    }
+
+    if (blockBusy()) {
+        return kSTkErrBusBusy;
+    }
+
+    uint32_t start = OtosBusStats::now();
+    int result = withRetries(1, 1, [this](uint32_t deadlineUs) {
+        uint8_t data = 0;
+        return sdkResultToError(i2c_write_timeout_us(_port, _address, &data, 1, false, timeLeftUs(deadlineUs)));
+    });
+
+    return _stats.record(0, 1, result, start);
+}
+
+int OtosI2C::readRegisterByte(uint8_t devReg, uint8_t &dataToRead) {
+    size_t readBytes;
+    return readRegisterRegionAnyAddress(&devReg, 1, &dataToRead, 1, readBytes);
+}
+
+int OtosI2C::readRegisterRegionAnyAddress(uint8_t *devReg, size_t regLength, uint8_t *data, size_t numBytes, size_t &readBytes) {
+    uint32_t start = OtosBusStats::now();
+    readBytes = 0;
+    int result = withRetries(regLength + numBytes, _policy.maxAttempts, [&](uint32_t deadlineUs) {
+        return readRegion(devReg, regLength, data, numBytes, readBytes, deadlineUs);
+    });
+    adaptBaudRate();
+    return _stats.record(regLength ? devReg[0] : 0, readBytes, result, start);
+}
+
+int OtosI2C::readRegion(uint8_t *devReg, size_t regLength, uint8_t *data, size_t numBytes, size_t &readBytes,
+                        uint32_t deadlineUs) {
+    if (!_port)
         return kSTkErrBusNotInit;
 
     if (!data)
         return kSTkErrBusNullBuffer;
 
+    if (blockBusy())
+        return kSTkErrBusBusy;
+
     readBytes = 0;
     size_t nOrig = numBytes;
     uint8_t nChunk;
@@ -96,17 +466,17 @@ int readRegisterRegionAnyAddress(uint8_t *devReg, size_t regLength, uint8_t *dat
 
     while (numBytes > 0) {
         if (firstIteration) {
-            int result = i2c_write_blocking(CONFIG::i2c_port, kDefaultAddress, devReg, regLength, true);
+            int result = i2c_write_timeout_us(_port, _address, devReg, regLength, true, timeLeftUs(deadlineUs));
             if (result < 0)
-                return kSTkErrFail;
+                return sdkResultToError(result);
             firstIteration = false;
         }
 
-        nChunk = numBytes > kDefaultBufferChunk ? kDefaultBufferChunk : numBytes;
-        nReturned = i2c_read_blocking(CONFIG::i2c_port, kDefaultAddress, data, nChunk, numBytes > nChunk);
+        nChunk = numBytes > _readChunk ? _readChunk : numBytes;
+        nReturned = i2c_read_timeout_us(_port, _address, data, nChunk, numBytes > nChunk, timeLeftUs(deadlineUs));
 
         if (nReturned < 0)
-            return kSTkErrFail;
+            return sdkResultToError(nReturned);
 
         numBytes -= nReturned;
         data += nReturned;
@@ -116,42 +486,236 @@ int readRegisterRegionAnyAddress(uint8_t *devReg, size_t regLength, uint8_t *dat
     return (readBytes == nOrig) ? kSTkErrOk : kSTkErrBusUnderRead;
 }
 
-int readRegisterRegion(uint8_t devReg, uint8_t *data, size_t numBytes, size_t &readBytes)
+int OtosI2C::readRegisterRegion(uint8_t devReg, uint8_t *data, size_t numBytes, size_t &readBytes)
 {
     return readRegisterRegionAnyAddress(&devReg, 1, data, numBytes, readBytes);
 }
 
-int writeRegisterByte(uint8_t devReg, uint8_t dataToWrite) {
-    if (!CONFIG::i2c_port)
+int OtosI2C::writeRegisterByte(uint8_t devReg, uint8_t dataToWrite) {
+    return writeRegisterRegionAddress(&devReg, 1, &dataToWrite, 1);
+}
+
+int OtosI2C::writeRegisterRegionAddress(uint8_t *devReg, size_t regLength, const uint8_t *data, size_t length) {
+    uint32_t start = OtosBusStats::now();
+    int result = withRetries(regLength + length, _policy.maxAttempts, [&](uint32_t deadlineUs) {
+        return writeRegion(devReg, regLength, data, length, deadlineUs);
+    });
+    adaptBaudRate();
+    return _stats.record(regLength ? devReg[0] : 0, length, result, start);
+}
+
+int OtosI2C::writeRegion(uint8_t *devReg, size_t regLength, const uint8_t *data, size_t length,
+                         uint32_t deadlineUs) {
+    if (!_port)
         return kSTkErrBusNotInit;
 
-    uint8_t buffer[2];
-    buffer[0] = devReg;       
-    buffer[1] = dataToWrite;  
+    if (!data && length > 0)
+        return kSTkErrBusNullBuffer;
+
+    if (regLength + length == 0)
+        return kSTkErrFail;
+
+    if (blockBusy())
+        return kSTkErrBusBusy;
+
+    i2c_hw_t *hw = i2c_get_hw(_port);
+
+    // The target address can only be changed while the block is disabled
+    hw->enable = 0;
+    hw->tar = _address;
+    hw->enable = 1;
+
+    (void)hw->clr_tx_abrt;
+    (void)hw->clr_stop_det;
+
+    // Gather the register address and the payload straight into the TX FIFO,
+    // so neither is copied into a combined buffer first. A NAK flushes the
+    // FIFO, so stop feeding it as soon as the block aborts. A stalled bus
+    // leaves the block mid-transfer, the retry policy resets it
+    size_t total = regLength + length;
+    bool aborted = false;
+    for (size_t i = 0; i < total && !aborted; ++i) {
+        uint8_t byte = (i < regLength) ? devReg[i] : data[i - regLength];
+
+        while (!(hw->status & I2C_IC_STATUS_TFNF_BITS)) {
+            if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+                aborted = true;
+                break;
+            }
+            if (expired(deadlineUs)) {
+                return kSTkErrBusTimeout;
+            }
+        }
+
+        if (!aborted) {
+            hw->data_cmd = byte | (i == total - 1 ? I2C_IC_DATA_CMD_STOP_BITS : 0);
+        }
+    }
+
+    // The block sends the stop after the last byte, or right after an abort
+    while (!(hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_STOP_DET_BITS)) {
+        if (expired(deadlineUs)) {
+            return kSTkErrBusTimeout;
+        }
+    }
+    (void)hw->clr_stop_det;
 
-    int result = i2c_write_blocking(CONFIG::i2c_port, kDefaultAddress, buffer, 2, false);
+    if (aborted || (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS)) {
+        (void)hw->clr_tx_abrt;
+        return kSTkErrBusNoResponse;
+    }
+
+    return kSTkErrOk;
+}
 
-    return result == 2 ? kSTkErrOk : kSTkErrFail;
+int OtosI2C::writeRegisterRegion(uint8_t devReg, const uint8_t *data, size_t length)
+{
+    return writeRegisterRegionAddress(&devReg, 1, data, length);
 }
 
-int writeRegisterRegionAddress(uint8_t *devReg, size_t regLength, const uint8_t *data, size_t length) {
-    if (!CONFIG::i2c_port)
+int OtosI2C::startReadRegisterRegionDma(uint8_t devReg, uint8_t *data, size_t numBytes) {
+    uint32_t start = OtosBusStats::now();
+    int result = startDma(devReg, data, numBytes);
+    if (result != kSTkErrOk)
+        return _stats.record(devReg, 0, result, start);
+
+    // The transfer is recorded once pollReadRegisterRegionDma() sees it end
+    _dmaStartUs = start;
+    _dmaReg = devReg;
+    return kSTkErrOk;
+}
+
+int OtosI2C::startDma(uint8_t devReg, uint8_t *data, size_t numBytes) {
+    if (!_port)
         return kSTkErrBusNotInit;
 
-    uint8_t buffer[regLength + length];
+    if (!data)
+        return kSTkErrBusNullBuffer;
+
+    if (numBytes == 0 || numBytes > kMaxDmaReadLength)
+        return kSTkErrBusDataTooLong;
+
+    if (blockBusy())
+        return kSTkErrBusBusy;
+
+    // Clean up after an earlier fault first, then time out within what is
+    // left of the budget, as withRetries() does for a single attempt
+    uint32_t deadline = time_us_32() + _policy.budgetUs;
+    int err = recover(deadline);
+    if (err != kSTkErrOk)
+        return err;
+
+    int32_t left = (int32_t)(deadline - time_us_32());
+    if (left < I2C_MIN_ATTEMPT_US)
+        return kSTkErrBusTimeout;
+    uint32_t timeout = transferTimeUs(numBytes + 1);
 
-    if (devReg != nullptr && regLength > 0) {
-        memcpy(buffer, devReg, regLength);
+    // Claim the DMA channels on first use
+    if (_dmaTxChannel < 0) {
+        _dmaTxChannel = dma_claim_unused_channel(true);
+        _dmaRxChannel = dma_claim_unused_channel(true);
     }
 
-    memcpy(buffer + regLength, data, length);
+    i2c_hw_t *hw = i2c_get_hw(_port);
 
-    int result = i2c_write_blocking(CONFIG::i2c_port, kDefaultAddress, buffer, regLength + length, false);
+    // The target address can only be changed while the block is disabled
+    hw->enable = 0;
+    hw->tar = _address;
+    hw->enable = 1;
 
-    return result == (int)(regLength + length) ? kSTkErrOk : kSTkErrFail;
+    // Register address write, then a restart into the burst read with a stop
+    // after the last byte
+    _dmaCommands[0] = devReg;
+    for (size_t i = 0; i < numBytes; ++i) {
+        _dmaCommands[i + 1] = I2C_IC_DATA_CMD_CMD_BITS
+                           | (i == 0 ? I2C_IC_DATA_CMD_RESTART_BITS : 0)
+                           | (i == numBytes - 1 ? I2C_IC_DATA_CMD_STOP_BITS : 0);
+    }
+
+    // Clear any abort or stop left over from a previous transfer
+    (void)hw->clr_tx_abrt;
+    (void)hw->clr_stop_det;
+
+    dma_channel_config rxConfig = dma_channel_get_default_config(_dmaRxChannel);
+    channel_config_set_transfer_data_size(&rxConfig, DMA_SIZE_8);
+    channel_config_set_read_increment(&rxConfig, false);
+    channel_config_set_write_increment(&rxConfig, true);
+    channel_config_set_dreq(&rxConfig, i2c_get_dreq(_port, false));
+    dma_channel_configure(_dmaRxChannel, &rxConfig, data, &hw->data_cmd, numBytes, false);
+
+    dma_channel_config txConfig = dma_channel_get_default_config(_dmaTxChannel);
+    channel_config_set_transfer_data_size(&txConfig, DMA_SIZE_32);
+    channel_config_set_read_increment(&txConfig, true);
+    channel_config_set_write_increment(&txConfig, false);
+    channel_config_set_dreq(&txConfig, i2c_get_dreq(_port, true));
+    dma_channel_configure(_dmaTxChannel, &txConfig, &hw->data_cmd, _dmaCommands, numBytes + 1, false);
+
+    _dmaLength = numBytes;
+    _dmaDeadlineUs = time_us_32() + ((timeout < (uint32_t)left) ? timeout : (uint32_t)left);
+    _faults.attempts++;
+    setBlockBusy(true);
+
+    // Start both channels together, the RX channel only moves data once the
+    // I2C block has received a byte
+    dma_start_channel_mask((1u << _dmaRxChannel) | (1u << _dmaTxChannel));
+
+    return kSTkErrOk;
 }
 
-int writeRegisterRegion(uint8_t devReg, const uint8_t *data, size_t length)
-{
-    return writeRegisterRegionAddress(&devReg, 1, data, length);
+void OtosI2C::abortDma() {
+    dma_channel_abort(_dmaTxChannel);
+    dma_channel_abort(_dmaRxChannel);
+
+    // Disabling the block flushes both FIFOs. It only takes effect once the
+    // byte on the bus is done, so wait just as long as a block reset would
+    i2c_hw_t *hw = i2c_get_hw(_port);
+    hw->enable = 0;
+    uint32_t deadline = time_us_32() + I2C_BLOCK_RESET_US;
+    while ((hw->enable_status & I2C_IC_ENABLE_STATUS_IC_EN_BITS) && !expired(deadline)) {
+        tight_loop_contents();
+    }
+    hw->enable = 1;
+
+    (void)hw->clr_tx_abrt;
+    (void)hw->clr_stop_det;
+}
+
+int OtosI2C::pollReadRegisterRegionDma(size_t &readBytes) {
+    readBytes = 0;
+
+    if (!_dmaActive)
+        return kSTkErrFail;
+
+    i2c_hw_t *hw = i2c_get_hw(_port);
+
+    // A NAK flushes the TX FIFO and leaves both channels waiting forever, so
+    // they have to be stopped by hand
+    if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+        abortDma();
+        setBlockBusy(false);
+        classifyFault(kSTkErrBusNoResponse, 1);
+        adaptBaudRate();
+        return _stats.record(_dmaReg, 0, kSTkErrBusNoResponse, _dmaStartUs);
+    }
+
+    // Done once every byte has been received and the stop has been sent
+    if (dma_channel_is_busy(_dmaRxChannel) || !(hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_STOP_DET_BITS)) {
+        if (!expired(_dmaDeadlineUs))
+            return kSTkErrBusBusy;
+
+        // Stalled, eg. a device stretching the clock forever. Whatever the
+        // recovery policy, the block must not keep the stale commands
+        abortDma();
+        setBlockBusy(false);
+        classifyFault(kSTkErrBusTimeout, 1);
+        adaptBaudRate();
+        return _stats.record(_dmaReg, 0, kSTkErrBusTimeout, _dmaStartUs);
+    }
+
+    (void)hw->clr_stop_det;
+    setBlockBusy(false);
+    adaptBaudRate();
+
+    readBytes = _dmaLength;
+    return _stats.record(_dmaReg, _dmaLength, kSTkErrOk, _dmaStartUs);
 }